@@ -0,0 +1,195 @@
+// Checks that the steady-state order path never touches the heap
+//
+// Drives the real OmsCore (submit -> risk -> route -> NEW, then poll() for
+// ACK -> FILL and the order's callback) against a loopback venue thread
+// that fills every NEW at once, as core_bench does. Global operator new is
+// replaced by one that counts per thread; after a warm-up, the orders
+// measured on the OMS thread must not allocate at all. Runs once with the
+// event log off and once with it written to /dev/null. Exits 1 if any
+// measured order allocated.
+//
+//   oms_alloc_check [orders] [venue_port]
+#include "common/clock.h"
+#include "common/messages.h"
+#include "common/net.h"
+#include "common/session.h"
+#include "oms/oms_core.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+// ---- Counting hook: every C++ allocation in the process goes through here
+
+// Per thread, so the venue thread's allocations don't count against the OMS
+static thread_local long t_allocs = 0;
+
+void* operator new(size_t n) {
+    t_allocs++;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t n) {
+    return ::operator new(n);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Venue: one session per accepted connection, every NEW filled at once
+static void venue_main(int listen_fd, int connections) {
+    Session::Options o;
+    o.name = "alloc_check_venue";
+    int next_venue_id = 90001;
+    std::string line;
+    for (int c = 0; c < connections; c++) {
+        int fd = tcp_accept(listen_fd);
+        if (fd < 0) return;
+        Session venue(o);
+        venue.attach(std::make_unique<TcpConnection>(fd));
+        while (true) {
+            if (!venue.connection()->has_line() && !venue.connection()->wait_readable(100)) {
+                venue.on_timer(mono_ns());
+                continue;
+            }
+            Session::ReadResult rr = venue.read(line);
+            if (rr == Session::ReadResult::Closed) break;
+            if (rr != Session::ReadResult::Data) continue;
+
+            Msg m = parse_msg(line);
+            if (m.kind != MsgKind::New) continue;
+            Msg ack;
+            ack.kind = MsgKind::Ack;
+            ack.client_id = m.client_id;
+            ack.venue_id = next_venue_id++;
+            Msg fill = ack;
+            fill.kind = MsgKind::Fill;
+            fill.qty = m.qty;
+            fill.price = m.price;
+            fill.liquidity = 'A';
+
+            char buf[2 * kMaxMsgLen];
+            size_t n = encode_msg(ack, buf, sizeof(buf));
+            n += encode_msg(fill, buf + n, sizeof(buf) - n);
+            venue.send(std::string_view(buf, n));
+        }
+    }
+}
+
+static void on_event(void* ctx, const OrderEvent& ev) {
+    if (ev.type == OrderEventType::Fill && ev.state == OrderState::Filled) *static_cast<bool*>(ctx) = true;
+}
+
+// One order through OmsCore until its FILL callback; alternating sides keeps the position flat
+static bool round_trip(OmsCore& oms, long i) {
+    bool filled = false;
+    oms.submit("ABC", (i & 1) ? Side::Sell : Side::Buy, 10, (i & 1) ? 100.75 : 100.25, on_event, &filled);
+    bool ok = true;
+    while (ok && !filled) ok = oms.poll(-1);
+    return ok;
+}
+
+// Returns the allocations of the measured orders, -1 if the run failed
+static long run(bool log_on, long warmup, long orders, int port, const std::string& risk_path) {
+    std::ofstream devnull("/dev/null");
+    OmsOptions opts;
+    opts.venues.emplace_back("127.0.0.1", port);
+    opts.md_port = 0;
+    opts.metrics_port = 0;
+    opts.risk_path = risk_path;
+    opts.ledger_path = "/dev/null";
+    opts.max_orders = (int)(warmup + orders) + 1024;
+    opts.log = log_on ? &devnull : nullptr;
+
+    OmsCore oms(opts);
+    if (!oms.start()) return -1;
+
+    long before = t_allocs;
+    for (long i = 0; i < warmup; i++) {
+        if (!round_trip(oms, i)) {
+            std::fprintf(stderr, "oms_alloc_check: warm-up order %ld failed\n", i);
+            return -1;
+        }
+    }
+    long warm_allocs = t_allocs - before;
+
+    before = t_allocs;
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < orders; i++) {
+        if (!round_trip(oms, warmup + i)) {
+            std::fprintf(stderr, "oms_alloc_check: order %ld failed\n", i);
+            return -1;
+        }
+    }
+    int64_t t1 = mono_ns();
+    long allocs = t_allocs - before;
+
+    std::printf("{\"check\":\"alloc.order_path\",\"log\":\"%s\",\"warmup\":%ld,\"warmup_allocs\":%ld,"
+                "\"orders\":%ld,\"allocs\":%ld,\"ns_per_order\":%.2f}\n",
+                log_on ? "on" : "off", warmup, warm_allocs, orders, allocs, (double)(t1 - t0) / (double)orders);
+    return allocs;
+}
+
+int main(int argc, char** argv) {
+    const long warmup = 10'000;
+    long orders = (argc > 1) ? std::atol(argv[1]) : 100'000;
+    int port = (argc > 2) ? std::atoi(argv[2]) : 9151;
+    if (orders <= 0 || port <= 0) {
+        std::fprintf(stderr, "usage: oms_alloc_check [orders] [venue_port]\n");
+        return 2;
+    }
+
+    // Limits out of the way: the orders go back to back
+    char risk_path[] = "/tmp/alloc_check_risk_XXXXXX";
+    int rfd = ::mkstemp(risk_path);
+    if (rfd < 0) return 2;
+    const std::string conf = "max_order_qty = 1000000\nmax_notional = 1e12\nmax_abs_position = 1000000000\n"
+                             "max_orders_per_sec = 0\n";
+    bool wrote = ::write(rfd, conf.data(), conf.size()) == (ssize_t)conf.size();
+    ::close(rfd);
+
+    int lfd = tcp_listen_loopback(port);
+    if (!wrote || lfd < 0) {
+        std::fprintf(stderr, "oms_alloc_check: setup failed\n");
+        ::unlink(risk_path);
+        return 2;
+    }
+    std::thread venue(venue_main, lfd, 2);
+
+    long quiet = run(false, warmup, orders, port, risk_path);
+    long logged = (quiet >= 0) ? run(true, warmup, orders, port, risk_path) : -1;
+
+    ::shutdown(lfd, SHUT_RDWR); // Unblocks accept() if a run never connected
+    venue.join();
+    ::close(lfd);
+    ::unlink(risk_path);
+
+    if (quiet < 0 || logged < 0) return 2;
+    if (quiet != 0 || logged != 0) {
+        std::fprintf(stderr, "oms_alloc_check: FAIL steady-state order path allocated %ld time(s) with the log off, "
+                             "%ld with it on\n", quiet, logged);
+        return 1;
+    }
+    return 0;
+}
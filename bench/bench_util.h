@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Minimal timing harness shared by the bench targets
+// Each case prints one JSON object per line so runs can be diffed or fed
+// into a regression check.
+
+// Keeps the optimizer from dropping a value we computed only to time it
+template <class T>
+inline void do_not_optimize(const T& v) {
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+// Only cases whose name contains this run (null = all)
+inline const char*& bench_filter() {
+    static const char* f = nullptr;
+    return f;
+}
+
+inline bool bench_selected(const char* name) {
+    return !bench_filter() || std::strstr(name, bench_filter()) != nullptr;
+}
+
+inline int64_t bench_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Prints one result line. param is the case's size knob, -1 if it has none
+inline void bench_report(const char* name, long iters, double ns_per_op, long param = -1) {
+    std::printf("{\"bench\":\"%s\",", name);
+    if (param >= 0) std::printf("\"n\":%ld,", param);
+    std::printf("\"iters\":%ld,\"ns_per_op\":%.2f}\n", iters, ns_per_op);
+    std::fflush(stdout);
+}
+
+// Runs fn(i) for i in [0, iters) after a short warm-up, prints the result
+// Returns ns per call
+template <class Fn>
+double run_bench(const char* name, long iters, Fn&& fn, long param = -1) {
+    if (!bench_selected(name)) return 0.0;
+
+    long warm = iters / 10;
+    for (long i = 0; i < warm; i++) fn(i);
+
+    int64_t t0 = bench_now_ns();
+    for (long i = 0; i < iters; i++) fn(i);
+    int64_t t1 = bench_now_ns();
+
+    double per_op = (double)(t1 - t0) / (double)iters;
+    bench_report(name, iters, per_op, param);
+    return per_op;
+}
@@ -0,0 +1,115 @@
+// Clock reads, and how far the TSC clock strays from CLOCK_MONOTONIC
+//
+//   clock.mono_ns           common/clock.h (TSC when usable)
+//   clock.steady_clock      std::chrono::steady_clock::now()
+//   clock.clock_gettime     clock_gettime(CLOCK_MONOTONIC)
+//   clock.gettimeofday      what the ledger used to stamp fills with
+//   clock.wall_to_mono      a kernel receive stamp moved onto mono_ns()
+//   clock.max_offset        largest |mono_ns() - CLOCK_MONOTONIC| seen over
+//                           n seconds of refits (ns, not a per-call cost)
+//   clock.rx_wait           kernel receive -> read_line returned on a TCP
+//                           loopback line, the part a loop-taken stamp hides
+//
+//   clock_bench [iters] [offset_seconds]
+#include "bench_util.h"
+#include "common/clock.h"
+#include "common/net.h"
+
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1'000'000'000 + ts.tv_nsec;
+}
+
+static void bench_offset(int seconds) {
+    if (!bench_selected("clock.max_offset")) return;
+    int64_t worst = 0;
+    long samples = 0;
+    const int64_t end = monotonic_ns() + (int64_t)seconds * 1'000'000'000;
+    while (monotonic_ns() < end) {
+        // Reference read bracketed by ours; the tightest of a few tries,
+        // a preempted one says nothing about the clock
+        int64_t off = 0;
+        int64_t best = INT64_MAX;
+        for (int k = 0; k < 5; k++) {
+            int64_t a = mono_ns();
+            int64_t m = monotonic_ns();
+            int64_t b = mono_ns();
+            if (b - a < best) {
+                best = b - a;
+                off = (a + b) / 2 - m;
+            }
+        }
+        if (off < 0) off = -off;
+        if (off > worst) worst = off;
+        samples++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    bench_report("clock.max_offset", samples, (double)worst, seconds);
+}
+
+static int bench_rx_wait(long iters) {
+    if (!bench_selected("clock.rx_wait")) return 0;
+    const int port = 9121;
+    int lfd = tcp_listen_loopback(port);
+    if (lfd < 0) return 1;
+    std::unique_ptr<Connection> rx = tcp_connect("127.0.0.1", port);
+    int sfd = tcp_accept(lfd);
+    ::close(lfd);
+    if (!rx || sfd < 0) return 1;
+
+    std::string line;
+    int64_t total = 0;
+    long stamped = 0;
+    for (long i = 0; i < iters; i++) {
+        write_all(sfd, "PING\n");
+        if (!rx->read_line(line)) break;
+        int64_t now = mono_ns();
+        if (rx->rx_wall_ns() == 0) continue;
+        total += now - wall_to_mono_ns(rx->rx_wall_ns());
+        stamped++;
+    }
+    ::close(sfd);
+    if (stamped == 0) {
+        std::fprintf(stderr, "clock_bench: no receive timestamps on the socket\n");
+        return 1;
+    }
+    bench_report("clock.rx_wait", stamped, (double)total / (double)stamped);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    long iters = (argc > 1) ? std::atol(argv[1]) : 10'000'000;
+    int seconds = (argc > 2) ? std::atoi(argv[2]) : 3;
+    if (iters <= 0 || seconds < 0) {
+        std::fprintf(stderr, "usage: clock_bench [iters] [offset_seconds]\n");
+        return 1;
+    }
+    std::fprintf(stderr, "clock_bench: mono_ns source=%s\n", clock_source());
+
+    run_bench("clock.mono_ns", iters, [](long) { do_not_optimize(mono_ns()); });
+    run_bench("clock.steady_clock", iters, [](long) { do_not_optimize(std::chrono::steady_clock::now()); });
+    run_bench("clock.clock_gettime", iters, [](long) { do_not_optimize(monotonic_ns()); });
+    run_bench("clock.gettimeofday", iters, [](long) {
+        timeval tv;
+        gettimeofday(&tv, nullptr);
+        do_not_optimize(tv);
+    });
+    const int64_t stamp = wall_ns();
+    run_bench("clock.wall_to_mono", iters, [&](long) { do_not_optimize(wall_to_mono_ns(stamp)); });
+
+    bench_offset(seconds);
+    return bench_rx_wait(iters / 100);
+}
@@ -0,0 +1,150 @@
+// Schema codec vs the previous ostringstream/istringstream code
+#include "bench_util.h"
+#include "common/messages.h"
+
+#include <sstream>
+#include <string>
+
+namespace legacy {
+
+// Stream-based codec as it was before the schema, kept here as the baseline
+struct NewOrder {
+    int client_id;
+    std::string symbol;
+    std::string side;
+    int qty;
+    double price;
+};
+
+std::string format_new(const NewOrder& o) {
+    std::ostringstream oss;
+    oss << "NEW " << o.client_id << " " << o.symbol << " " << o.side
+        << " " << o.qty << " " << o.price << "\n";
+    return oss.str();
+}
+
+std::string format_cancel(int client_id) {
+    std::ostringstream oss;
+    oss << "CANCEL " << client_id << "\n";
+    return oss.str();
+}
+
+std::string format_fill(int client_id, int venue_id, int qty, double price) {
+    std::ostringstream oss;
+    oss << "FILL " << client_id << " " << venue_id << " " << qty << " " << price << " A\n";
+    return oss.str();
+}
+
+struct Msg {
+    int kind = 0;
+    int client_id = 0;
+    int venue_id = 0;
+    int qty = 0;
+    double price = 0.0;
+    char liquidity = '?';
+    std::string reason;
+};
+
+Msg parse_msg(const std::string& line) {
+    Msg m;
+    std::istringstream iss(line);
+    std::string kind;
+    if (!(iss >> kind)) return m;
+    if (kind == "ACK") {
+        m.kind = 1;
+        iss >> m.client_id >> m.venue_id;
+    } else if (kind == "FILL") {
+        m.kind = 2;
+        iss >> m.client_id >> m.venue_id >> m.qty >> m.price >> m.liquidity;
+    } else if (kind == "REJECT") {
+        m.kind = 3;
+        iss >> m.client_id;
+        std::getline(iss, m.reason);
+        if (!m.reason.empty() && m.reason[0] == ' ') m.reason.erase(0, 1);
+    }
+    return m;
+}
+
+} // namespace legacy
+
+int main() {
+    const long N = 1'000'000;
+
+    run_bench("codec.format_new.stream", N, [](long i) {
+        legacy::NewOrder o{1001 + (int)i, "ABC", "BUY", 10, 101.25};
+        std::string s = legacy::format_new(o);
+        do_not_optimize(s);
+    });
+    run_bench("codec.format_new.schema", N, [](long i) {
+        WireBuf b;
+        encode_msg(make_new(1001 + (int)i, "ABC", "BUY", 10, 101.25), b);
+        do_not_optimize(b);
+    });
+    // Pre-armed per symbol and side: only client_id, qty and price written
+    NewTemplate tmpl;
+    tmpl.arm("ABC", "BUY");
+    run_bench("codec.format_new.template", N, [&](long i) {
+        std::string_view line = tmpl.encode(1001 + (int)i, 10, 101.25);
+        do_not_optimize(line);
+    });
+
+    run_bench("codec.format_cancel.stream", N, [](long i) {
+        std::string s = legacy::format_cancel(1001 + (int)i);
+        do_not_optimize(s);
+    });
+    run_bench("codec.format_cancel.schema", N, [](long i) {
+        WireBuf b;
+        encode_msg(make_cancel(1001 + (int)i), b);
+        do_not_optimize(b);
+    });
+
+    run_bench("codec.format_fill.stream", N, [](long i) {
+        std::string s = legacy::format_fill(1001 + (int)i, 90001, 10, 101.25);
+        do_not_optimize(s);
+    });
+    run_bench("codec.format_fill.schema", N, [](long i) {
+        Msg m;
+        m.kind = MsgKind::Fill;
+        m.client_id = 1001 + (int)i;
+        m.venue_id = 90001;
+        m.qty = 10;
+        m.price = 101.25;
+        m.liquidity = 'A';
+        WireBuf b;
+        encode_msg(m, b);
+        do_not_optimize(b);
+    });
+
+    const std::string fill = "FILL 1001 90001 10 101.25 A";
+    const std::string ack = "ACK 1001 90001";
+    const std::string reject = "REJECT 1001 ALREADY_FILLED";
+
+    run_bench("codec.parse_fill.stream", N, [&](long) {
+        legacy::Msg m = legacy::parse_msg(fill);
+        do_not_optimize(m);
+    });
+    run_bench("codec.parse_fill.schema", N, [&](long) {
+        Msg m = parse_msg(fill);
+        do_not_optimize(m);
+    });
+
+    run_bench("codec.parse_ack.stream", N, [&](long) {
+        legacy::Msg m = legacy::parse_msg(ack);
+        do_not_optimize(m);
+    });
+    run_bench("codec.parse_ack.schema", N, [&](long) {
+        Msg m = parse_msg(ack);
+        do_not_optimize(m);
+    });
+
+    run_bench("codec.parse_reject.stream", N, [&](long) {
+        legacy::Msg m = legacy::parse_msg(reject);
+        do_not_optimize(m);
+    });
+    run_bench("codec.parse_reject.schema", N, [&](long) {
+        Msg m = parse_msg(reject);
+        do_not_optimize(m);
+    });
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+// OmsCore embedded vs driven as a command-line tool
+//
+// Both modes run the same OmsCore against a loopback venue thread that
+// answers every NEW with ACK and FILL. One order at a time, so the numbers
+// are latency, not queueing:
+//
+//   core.submit_api        OmsCore::submit() with the event log off
+//   core.submit_text       "BUY 10 100" through a pipe: poll, read, parse,
+//                          submit, with the event log written like oms's
+//   core.round_trip_api    submit -> NEW -> ACK -> FILL callback
+//   core.round_trip_text
+//   core.submit_to_send_*  submit (or the typed line) -> NEW handed to the
+//                          venue socket, from the order's sent_ns
+//
+//   core_bench [orders] [venue_port]
+#include "bench_util.h"
+#include "common/clock.h"
+#include "common/messages.h"
+#include "common/net.h"
+#include "common/session.h"
+#include "oms/oms_core.h"
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Venue: one session per accepted connection, every NEW filled at once
+static void venue_main(int listen_fd, int connections) {
+    // Lowest priority, so a NEW on one CPU doesn't hand the CPU straight
+    // to the venue in the middle of the submit being timed
+    ::setpriority(PRIO_PROCESS, (id_t)::syscall(SYS_gettid), 19);
+    Session::Options o;
+    o.name = "core_bench_venue";
+    int next_venue_id = 90001;
+    std::string line;
+    for (int c = 0; c < connections; c++) {
+        int fd = tcp_accept(listen_fd);
+        if (fd < 0) return;
+        Session venue(o);
+        venue.attach(std::make_unique<TcpConnection>(fd));
+        while (true) {
+            if (!venue.connection()->has_line() && !venue.connection()->wait_readable(100)) {
+                venue.on_timer(bench_now_ns());
+                continue;
+            }
+            Session::ReadResult rr = venue.read(line);
+            if (rr == Session::ReadResult::Closed) break;
+            if (rr != Session::ReadResult::Data) continue;
+
+            Msg m = parse_msg(line);
+            if (m.kind != MsgKind::New) continue;
+            Msg ack;
+            ack.kind = MsgKind::Ack;
+            ack.client_id = m.client_id;
+            ack.venue_id = next_venue_id++;
+            Msg fill = ack;
+            fill.kind = MsgKind::Fill;
+            fill.qty = m.qty;
+            fill.price = m.price;
+            fill.liquidity = 'A';
+
+            char buf[2 * kMaxMsgLen];
+            size_t n = encode_msg(ack, buf, sizeof(buf));
+            n += encode_msg(fill, buf + n, sizeof(buf) - n);
+            venue.send(std::string_view(buf, n));
+        }
+    }
+}
+
+static void on_event(void* ctx, const OrderEvent& ev) {
+    if (ev.type == OrderEventType::Fill && ev.state == OrderState::Filled) *static_cast<bool*>(ctx) = true;
+}
+
+static double pct(std::vector<int64_t>& v, double q) {
+    size_t k = std::min(v.size() - 1, (size_t)(q * (double)v.size()));
+    std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+    return (double)v[k];
+}
+
+static bool run(bool text, long orders, int port, const std::string& risk_path) {
+    std::ofstream devnull("/dev/null");
+    OmsOptions opts;
+    opts.venues.emplace_back("127.0.0.1", port);
+    opts.md_port = 0;
+    opts.metrics_port = 0;
+    opts.risk_path = risk_path;
+    opts.ledger_path = "/dev/null";
+    opts.max_orders = (int)orders + 1024;
+    opts.log = text ? &devnull : nullptr;
+
+    OmsCore oms(opts);
+    if (!oms.start()) return false;
+
+    int cmd_pipe[2];
+    if (::pipe(cmd_pipe) != 0) return false;
+    // Off-integer prices, as quotes mostly are
+    const std::string cmd_lines[2] = {"BUY 10 100.25\n", "SELL 10 100.75\n"};
+    char rbuf[256];
+
+    std::vector<int64_t> submit_ns;
+    std::vector<int64_t> round_trip_ns;
+    std::vector<int64_t> to_send_ns;
+    submit_ns.reserve((size_t)orders);
+    round_trip_ns.reserve((size_t)orders);
+    to_send_ns.reserve((size_t)orders);
+
+    const long warmup = orders / 10;
+    bool ok = true;
+    for (long i = 0; i < warmup + orders && ok; i++) {
+        bool filled = false;
+        // mono_ns(), the clock sent_ns is on
+        int64_t t0 = mono_ns();
+        int64_t t_submitted = 0;
+        int client_id = 0;
+        if (!text) {
+            client_id = oms.submit("ABC", (i & 1) ? Side::Sell : Side::Buy, 10, (i & 1) ? 100.75 : 100.25,
+                                   on_event, &filled);
+            t_submitted = mono_ns();
+        } else {
+            // What a typed order costs oms before it reaches OmsCore
+            const std::string& cmd = cmd_lines[i & 1];
+            ok = ::write(cmd_pipe[1], cmd.data(), cmd.size()) == (ssize_t)cmd.size();
+            bool ready = false;
+            while (ok && !ready) ok = oms.poll(-1, cmd_pipe[0], ready);
+            ssize_t n = ok ? ::read(cmd_pipe[0], rbuf, sizeof(rbuf)) : -1;
+            std::istringstream iss(std::string(rbuf, n > 0 ? (size_t)n : 0));
+            std::string kind;
+            int qty = 0;
+            double price = 0.0;
+            ok = ok && static_cast<bool>(iss >> kind >> qty >> price);
+            client_id = oms.submit("ABC", parse_side(kind), qty, price, on_event, &filled);
+            t_submitted = mono_ns();
+        }
+        while (ok && !filled) ok = oms.poll(-1);
+        int64_t t1 = mono_ns();
+        if (i < warmup) continue;
+        const Order* o = oms.store().get(client_id);
+        submit_ns.push_back(t_submitted - t0);
+        round_trip_ns.push_back(t1 - t0);
+        if (o && o->sent_ns > 0) to_send_ns.push_back(o->sent_ns - t0);
+    }
+    ::close(cmd_pipe[0]);
+    ::close(cmd_pipe[1]);
+    if (!ok || submit_ns.empty() || to_send_ns.empty()) {
+        std::fprintf(stderr, "core_bench: %s run failed\n", text ? "text" : "api");
+        return false;
+    }
+
+    double mean = 0.0;
+    for (int64_t v : submit_ns) mean += (double)v;
+    mean /= (double)submit_ns.size();
+    bench_report(text ? "core.submit_text" : "core.submit_api", (long)submit_ns.size(), mean);
+    bench_report(text ? "core.round_trip_text_p50" : "core.round_trip_api_p50", (long)round_trip_ns.size(),
+                 pct(round_trip_ns, 0.50));
+    bench_report(text ? "core.round_trip_text_p99" : "core.round_trip_api_p99", (long)round_trip_ns.size(),
+                 pct(round_trip_ns, 0.99));
+    bench_report(text ? "core.submit_to_send_text_p50" : "core.submit_to_send_api_p50", (long)to_send_ns.size(),
+                 pct(to_send_ns, 0.50));
+    bench_report(text ? "core.submit_to_send_text_p99" : "core.submit_to_send_api_p99", (long)to_send_ns.size(),
+                 pct(to_send_ns, 0.99));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    long orders = (argc > 1) ? std::atol(argv[1]) : 20'000;
+    int port = (argc > 2) ? std::atoi(argv[2]) : 9111;
+    if (orders <= 0 || port <= 0) {
+        std::fprintf(stderr, "usage: core_bench [orders] [venue_port]\n");
+        return 1;
+    }
+
+    // Limits out of the way: the orders go back to back
+    char risk_path[] = "/tmp/core_bench_risk_XXXXXX";
+    int rfd = ::mkstemp(risk_path);
+    if (rfd < 0) return 1;
+    const std::string conf = "max_order_qty = 1000000\nmax_notional = 1e12\nmax_abs_position = 1000000000\n"
+                             "max_orders_per_sec = 0\n";
+    bool wrote = ::write(rfd, conf.data(), conf.size()) == (ssize_t)conf.size();
+    ::close(rfd);
+
+    int lfd = tcp_listen_loopback(port);
+    if (!wrote || lfd < 0) {
+        std::fprintf(stderr, "core_bench: setup failed\n");
+        ::unlink(risk_path);
+        return 1;
+    }
+    std::thread venue(venue_main, lfd, 2);
+
+    bool ok = run(false, orders, port, risk_path) && run(true, orders, port, risk_path);
+
+    ::shutdown(lfd, SHUT_RDWR); // Unblocks accept() if a run never connected
+    venue.join();
+    ::close(lfd);
+    ::unlink(risk_path);
+    return ok ? 0 : 1;
+}
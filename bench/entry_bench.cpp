@@ -0,0 +1,151 @@
+// In-process order entry: 1..16 strategy threads submitting into one OMS
+// thread through OrderEntry's MPSC queue.
+//
+// The OMS side runs the real path per order (store, risk gate, encode, one
+// write() to /dev/null as the wire), then answers ACK and FILL at once so
+// every order completes through its callback. For each producer count:
+//
+//   entry.throughput          producers submit flat out (queue mostly full)
+//   entry.submit_to_wire_p50  each producer waits for its fill before the
+//   entry.submit_to_wire_p99  next submit, so this is latency, not queueing
+//
+//   entry_bench [orders]   # total per run, split across producers
+#include "bench_util.h"
+#include "common/messages.h"
+#include "oms/order_entry.h"
+#include "oms/orders.h"
+#include "oms/positions.h"
+#include "oms/risk.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Producer {
+    std::atomic<long> filled{0};
+};
+
+static void on_event(void* ctx, const OrderEvent& ev) {
+    if (ev.type == OrderEventType::Fill && ev.state == OrderState::Filled) {
+        static_cast<Producer*>(ctx)->filled.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void run(int producers, long orders, int wire_fd, bool closed_loop) {
+    const long per = orders / producers;
+    const long total = per * producers;
+
+    OrderEntry entry;
+    OrderStore store;
+    store.reserve((size_t)total);
+    RiskConfig cfg;
+    cfg.defaults.max_order_qty = 1'000'000;
+    cfg.defaults.max_notional = 1e12;
+    cfg.defaults.max_abs_position = 1'000'000'000;
+    cfg.max_orders_per_sec = 0.0;
+    RiskState risk_state;
+    PositionBook positions;
+
+    std::vector<Producer> stats(producers);
+    std::vector<int64_t> latency;
+    latency.reserve((size_t)total);
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            Producer& me = stats[(size_t)p];
+            for (long i = 0; i < per; i++) {
+                Side side = (i & 1) ? Side::Sell : Side::Buy;
+                // Full queue: let the OMS thread catch up
+                while (!entry.submit("ABC", side, 10, 100.0, on_event, &me, (uint64_t)i)) {
+                    std::this_thread::yield();
+                }
+                while (closed_loop && me.filled.load(std::memory_order_relaxed) <= i) std::this_thread::yield();
+            }
+        });
+    }
+
+    int next_id = 1001;
+    int next_venue_id = 90001;
+    long done = 0;
+    go.store(true, std::memory_order_release);
+    int64_t t0 = bench_now_ns();
+    EntryRequest r;
+    while (done < total) {
+        if (!entry.pop(r)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int client_id = next_id++;
+        const std::string sym(r.symbol_view());
+        store.add_pending_new(client_id, sym, r.side, r.qty, r.price);
+        RejectCode rc = check_new_order(cfg, risk_state, store, positions.get(sym), sym, r.side, r.qty, r.price,
+                                        bench_now_ns());
+        if (rc != RejectCode::None) {
+            store.mark_rejected(client_id, rc);
+            entry.reject(client_id, rc, r.cb, r.ctx, r.tag);
+            done++;
+            continue;
+        }
+        entry.watch(client_id, r.cb, r.ctx, r.tag);
+
+        WireBuf wire;
+        encode_msg(make_new(client_id, sym, to_string(r.side), r.qty, r.price), wire);
+        ssize_t n = ::write(wire_fd, wire.data, wire.len);
+        do_not_optimize(n);
+        latency.push_back(bench_now_ns() - r.submit_ns);
+
+        // The venue answers at once
+        int venue_id = next_venue_id++;
+        store.on_ack(client_id, venue_id);
+        entry.on_order_event(store, client_id, OrderEventType::Ack);
+        positions.at(sym).on_fill(r.side, r.qty, r.price);
+        store.on_fill(client_id, venue_id, r.qty, r.price);
+        entry.on_order_event(store, client_id, OrderEventType::Fill, r.qty, r.price);
+        done++;
+    }
+    int64_t t1 = bench_now_ns();
+    for (std::thread& t : threads) t.join();
+
+    long filled = 0;
+    for (const Producer& p : stats) filled += p.filled.load();
+    if (filled != total) std::fprintf(stderr, "entry_bench: only %ld of %ld orders completed\n", filled, total);
+
+    auto pct = [&](double q) {
+        size_t k = std::min(latency.size() - 1, (size_t)(q * (double)latency.size()));
+        std::nth_element(latency.begin(), latency.begin() + (long)k, latency.end());
+        return (double)latency[k];
+    };
+    if (!closed_loop) {
+        bench_report("entry.throughput", total, (double)(t1 - t0) / (double)total, producers);
+        return;
+    }
+    if (latency.empty()) return;
+    bench_report("entry.submit_to_wire_p50", (long)latency.size(), pct(0.50), producers);
+    bench_report("entry.submit_to_wire_p99", (long)latency.size(), pct(0.99), producers);
+}
+
+int main(int argc, char** argv) {
+    long orders = (argc > 1) ? std::atol(argv[1]) : 200'000;
+    if (orders <= 0) {
+        std::fprintf(stderr, "usage: entry_bench [orders]\n");
+        return 1;
+    }
+
+    int wire_fd = ::open("/dev/null", O_WRONLY);
+    if (wire_fd < 0) return 1;
+    for (int producers : {1, 2, 4, 8, 16}) {
+        run(producers, orders, wire_fd, false);
+        run(producers, orders / 4, wire_fd, true);
+    }
+    ::close(wire_fd);
+    return 0;
+}
@@ -0,0 +1,120 @@
+// ledger_query on a synthetic fills.csv
+//
+// Writes N fills over 64 symbols and a trading day to a temp file, then:
+//
+//   ledger.parse        CSV -> columns, per row (no cache)
+//   ledger.pnl          realized_pnl replay, per row
+//   ledger.cache_write  all columns to <csv>.cols, per row
+//   ledger.cache_map    mapping the cache again, per load
+//   ledger.agg_symbol   VWAP/volume/PnL by symbol, per row
+//   ledger.agg_bucket   ... by symbol, side and 1-minute bucket, per row
+//   ledger.trajectory   one symbol's position per minute, per row
+//
+// n is the thread count.
+//
+//   ledger_query_bench [rows] [threads]
+#include "bench_util.h"
+#include "ledger_query/fill_query.h"
+#include "ledger_query/fill_table.h"
+#include "ledger_query/parallel.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Fills as the OMS writes them: time-ordered, position_after per symbol
+static bool write_csv(const std::string& path, long rows) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fputs("ts_us,client_id,venue_id,symbol,side,qty,price,position_after\n", f);
+
+    constexpr int kSymbols = 64;
+    std::vector<int> pos(kSymbols, 0);
+    std::mt19937_64 rng(7);
+    const long long t0 = 1'700'000'000'000'000LL;
+    const long long day_us = 6LL * 3600 * 1'000'000;
+    char line[128];
+    for (long i = 0; i < rows; i++) {
+        uint64_t r = rng();
+        int s = (int)(r % kSymbols);
+        bool buy = ((r >> 8) & 1) != 0;
+        int qty = 1 + (int)((r >> 9) % 500);
+        double price = 50.0 + (double)s + (double)((r >> 20) % 2000) * 0.01;
+        pos[(size_t)s] += buy ? qty : -qty;
+        long long ts = t0 + day_us * i / rows;
+
+        int n = std::snprintf(line, sizeof(line), "%lld,%ld,%ld,S%02d,%s,%d,%.2f,%d\n", ts, 1001 + i, 90001 + i, s,
+                              buy ? "BUY" : "SELL", qty, price, pos[(size_t)s]);
+        std::fwrite(line, 1, (size_t)n, f);
+    }
+    return std::fclose(f) == 0;
+}
+
+int main(int argc, char** argv) {
+    long rows = (argc > 1) ? std::atol(argv[1]) : 5'000'000;
+    int threads = (argc > 2) ? std::atoi(argv[2]) : default_threads();
+    if (rows <= 0 || threads <= 0) {
+        std::fprintf(stderr, "usage: ledger_query_bench [rows] [threads]\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/ledger_query_bench_XXXXXX";
+    if (!::mkdtemp(dir)) return 1;
+    const std::string csv = std::string(dir) + "/fills.csv";
+    const std::string cache = FillTable::cache_path(csv);
+    if (!write_csv(csv, rows)) {
+        std::fprintf(stderr, "ledger_query_bench: cannot write %s\n", csv.c_str());
+        return 1;
+    }
+
+    bool ok = true;
+    {
+        FillTable t;
+        FillTable::LoadStats st;
+        ok = t.load(csv, threads, true, &st) && !st.from_cache && t.rows() == (size_t)rows;
+        if (ok) {
+            bench_report("ledger.parse", rows, (double)st.parse_ns / (double)rows, threads);
+            bench_report("ledger.pnl", rows, (double)st.pnl_ns / (double)rows, threads);
+            bench_report("ledger.cache_write", rows, (double)st.io_ns / (double)rows, threads);
+        }
+    }
+
+    FillTable t;
+    FillTable::LoadStats st;
+    ok = ok && t.load(csv, threads, true, &st) && st.from_cache;
+    if (ok) {
+        bench_report("ledger.cache_map", 1, (double)st.io_ns, threads);
+
+        std::vector<AggRow> out;
+        AggSpec by_symbol;
+        by_symbol.by_symbol = true;
+        int64_t a = bench_now_ns();
+        ok = aggregate(t, by_symbol, threads, out);
+        int64_t b = bench_now_ns();
+        bench_report("ledger.agg_symbol", rows, (double)(b - a) / (double)rows, threads);
+
+        AggSpec by_bucket = by_symbol;
+        by_bucket.by_side = true;
+        by_bucket.bucket_us = 60'000'000;
+        a = bench_now_ns();
+        ok = ok && aggregate(t, by_bucket, threads, out);
+        b = bench_now_ns();
+        bench_report("ledger.agg_bucket", rows, (double)(b - a) / (double)rows, threads);
+
+        std::vector<TrajectoryPoint> pts;
+        a = bench_now_ns();
+        ok = ok && trajectory(t, t.symbol_id("S07"), 60'000'000, threads, pts);
+        b = bench_now_ns();
+        bench_report("ledger.trajectory", rows, (double)(b - a) / (double)rows, threads);
+    }
+    if (!ok) std::fprintf(stderr, "ledger_query_bench: run failed\n");
+
+    ::unlink(csv.c_str());
+    ::unlink(cache.c_str());
+    ::rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// OMS <-> venue_sim over TCP under load: poll() vs io_uring
+//
+// Starts the real venue_sim (next to this binary, or the path given) with
+// --net=<backend> and talks to it as the OMS does, over the same backend:
+// one session, one write per NEW, `window` NEWs unanswered at a time until
+// `orders` have been ACKed. venue_sim runs with --fill-pct=0, so every NEW
+// is answered by exactly one ACK. A message is a NEW or an ACK. Per backend:
+//
+//   net.<backend>.wall        wall ns per message (1e9 / messages per second)
+//   net.<backend>.cpu         user+sys ns per message, both processes
+//   net.<backend>.cpu_oms     ... this process only
+//   net.<backend>.cpu_venue   ... venue_sim only (its stdout, one line per
+//                             message, goes to /dev/null)
+//
+// "n" is the window. With one CPU the two processes take turns, so wall
+// time is roughly the sum of their CPU time.
+//
+//   net_bench [orders] [window] [venue_sim path] [port]
+#include "bench_util.h"
+#include "common/messages.h"
+#include "common/net.h"
+#include "common/session.h"
+#include "common/transport.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+static int64_t cpu_ns(int who) {
+    rusage ru{};
+    ::getrusage(who, &ru);
+    auto ns = [](const timeval& tv) { return (int64_t)tv.tv_sec * 1'000'000'000 + (int64_t)tv.tv_usec * 1000; };
+    return ns(ru.ru_utime) + ns(ru.ru_stime);
+}
+
+static pid_t start_venue(const std::string& path, int port, NetBackend net) {
+    pid_t pid = ::fork();
+    if (pid != 0) return pid;
+    int devnull = ::open("/dev/null", O_WRONLY);
+    if (devnull >= 0) ::dup2(devnull, STDOUT_FILENO);
+    std::string port_arg = "--port=" + std::to_string(port);
+    std::string net_arg = std::string("--net=") + to_string(net);
+    ::execl(path.c_str(), "venue_sim", port_arg.c_str(), "--md-port=0", "--fill-pct=0", net_arg.c_str(),
+            (char*)nullptr);
+    std::perror("exec venue_sim");
+    ::_exit(127);
+}
+
+static bool run(NetBackend net, long orders, long window, const std::string& venue_path, int port) {
+    pid_t venue = start_venue(venue_path, port, net);
+    if (venue < 0) return false;
+
+    // Until it listens
+    int fd = -1;
+    for (int i = 0; i < 50 && fd < 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int status = 0;
+        if (::waitpid(venue, &status, WNOHANG) == venue) return false;
+        fd = tcp_connect_ipv4("127.0.0.1", port);
+    }
+    if (fd < 0) {
+        ::kill(venue, SIGTERM);
+        ::waitpid(venue, nullptr, 0);
+        return false;
+    }
+    enable_rx_timestamps(fd);
+
+    Session::Options o;
+    o.name = "net_bench";
+    Session s(o);
+    s.attach(tcp_connection(fd, net));
+    s.logon();
+
+    const int64_t venue_cpu0 = cpu_ns(RUSAGE_CHILDREN);
+    const int64_t oms_cpu0 = cpu_ns(RUSAGE_SELF);
+    const int64_t t0 = bench_now_ns();
+
+    Msg m;
+    m.kind = MsgKind::New;
+    m.symbol = "ABC";
+    m.side = "BUY";
+    m.qty = 10;
+    m.price = 100.25;
+    char buf[kMaxMsgLen];
+    std::string line;
+    long sent = 0;
+    long acked = 0;
+    bool ok = true;
+    while (ok && acked < orders) {
+        while (sent < orders && sent - acked < window) {
+            m.client_id = (int)++sent;
+            size_t n = encode_msg(m, buf, sizeof(buf));
+            ok = s.send(std::string_view(buf, n));
+        }
+        Connection* c = s.connection();
+        if (!c->has_line() && !c->wait_readable(1000)) {
+            std::fprintf(stderr, "net_bench: venue_sim stopped answering at %ld/%ld\n", acked, orders);
+            ok = false;
+            break;
+        }
+        Session::ReadResult rr = s.read(line);
+        if (rr == Session::ReadResult::Closed) ok = false;
+        if (rr == Session::ReadResult::Data && parse_msg(line).kind == MsgKind::Ack) acked++;
+    }
+
+    const int64_t t1 = bench_now_ns();
+    const int64_t oms_cpu = cpu_ns(RUSAGE_SELF) - oms_cpu0;
+    s.detach();
+    ::kill(venue, SIGTERM);
+    ::waitpid(venue, nullptr, 0);
+    const int64_t venue_cpu = cpu_ns(RUSAGE_CHILDREN) - venue_cpu0;
+    if (!ok) return false;
+
+    const std::string base = std::string("net.") + to_string(net);
+    const long msgs = 2 * orders;
+    bench_report((base + ".wall").c_str(), msgs, (double)(t1 - t0) / (double)msgs, window);
+    bench_report((base + ".cpu").c_str(), msgs, (double)(oms_cpu + venue_cpu) / (double)msgs, window);
+    bench_report((base + ".cpu_oms").c_str(), msgs, (double)oms_cpu / (double)msgs, window);
+    bench_report((base + ".cpu_venue").c_str(), msgs, (double)venue_cpu / (double)msgs, window);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    long orders = (argc > 1) ? std::atol(argv[1]) : 200'000;
+    long window = (argc > 2) ? std::atol(argv[2]) : 64;
+    std::string venue_path;
+    if (argc > 3) {
+        venue_path = argv[3];
+    } else {
+        std::string self = argv[0];
+        size_t slash = self.rfind('/');
+        venue_path = (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/venue_sim";
+    }
+    int port = (argc > 4) ? std::atoi(argv[4]) : 9141;
+    if (orders <= 0 || window <= 0) {
+        std::fprintf(stderr, "usage: net_bench [orders] [window] [venue_sim path] [port]\n");
+        return 1;
+    }
+
+    if (!run(NetBackend::Poll, orders, window, venue_path, port)) return 1;
+    if (!run(NetBackend::Uring, orders, window, venue_path, port)) return 1;
+    return 0;
+}
@@ -0,0 +1,334 @@
+// Hot-path microbenchmarks for the OMS: codec, order store, positions,
+// risk, routing, algos, metrics and ledger. Self-contained, no venue needed.
+//
+//   oms_microbench [filter]   # only cases whose name contains filter
+//
+// Sized cases report the resident size as "n"; ids are visited in a
+// shuffled order so large stores aren't measured from cache.
+#include "bench_util.h"
+#include "common/messages.h"
+#include "common/metrics.h"
+#include "common/timer_queue.h"
+#include "oms/algo.h"
+#include "oms/ledger.h"
+#include "oms/order_templates.h"
+#include "oms/orders.h"
+#include "oms/positions.h"
+#include "oms/risk.h"
+#include "oms/router.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static const int kSizes[] = {1'000, 10'000, 100'000};
+static const int kFirstId = 1001;
+
+static std::vector<int> shuffled_ids(int n) {
+    std::vector<int> ids(n);
+    for (int i = 0; i < n; i++) ids[i] = kFirstId + i;
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+    return ids;
+}
+
+// n live orders, acked, too large to ever fill completely
+static void fill_store(OrderStore& store, int n) {
+    for (int i = 0; i < n; i++) {
+        store.add_pending_new(kFirstId + i, "ABC", (i & 1) ? Side::Sell : Side::Buy, 1'000'000'000, 100.0);
+        store.on_ack(kFirstId + i, 90001 + i);
+    }
+}
+
+static void bench_codec(long iters) {
+    const std::string fill = "FILL 1001 90001 10 101.25 A";
+    const std::string ack = "ACK 1001 90001";
+    const std::string reject = "REJECT 1001 ALREADY_FILLED";
+    const std::string bbo = "BBO ABC 12345 100.25 100 100.26 200";
+
+    run_bench("parse_msg.fill", iters, [&](long) { Msg m = parse_msg(fill); do_not_optimize(m); });
+    run_bench("parse_msg.ack", iters, [&](long) { Msg m = parse_msg(ack); do_not_optimize(m); });
+    run_bench("parse_msg.reject", iters, [&](long) { Msg m = parse_msg(reject); do_not_optimize(m); });
+    run_bench("parse_msg.bbo", iters, [&](long) { Msg m = parse_msg(bbo); do_not_optimize(m); });
+
+    run_bench("format_new", iters, [](long i) {
+        WireBuf b;
+        encode_msg(make_new(kFirstId + (int)i, "ABC", "BUY", 10, 101.25), b);
+        do_not_optimize(b);
+    });
+    // What the OMS sends with: the symbol's pre-armed template
+    OrderTemplates templates;
+    const std::string abc = "ABC";
+    templates.arm(abc);
+    run_bench("format_new.template", iters, [&](long i) {
+        WireBuf fallback;
+        std::string_view line = templates.new_line(abc, Side::Buy, kFirstId + (int)i, 10, 101.25, fallback);
+        do_not_optimize(line);
+    });
+    run_bench("format_cancel", iters, [](long i) {
+        WireBuf b;
+        encode_msg(make_cancel(kFirstId + (int)i), b);
+        do_not_optimize(b);
+    });
+}
+
+static void bench_store(long iters) {
+    for (int n : kSizes) {
+        // Insert: build a store of n orders from empty, averaged per insert
+        if (bench_selected("store.add_pending_new")) {
+            long reps = std::max(1L, iters / n);
+            int64_t total = 0;
+            for (long r = 0; r < reps; r++) {
+                OrderStore store;
+                int64_t t0 = bench_now_ns();
+                for (int i = 0; i < n; i++) store.add_pending_new(kFirstId + i, "ABC", Side::Buy, 10, 100.0);
+                total += bench_now_ns() - t0;
+                do_not_optimize(store);
+            }
+            bench_report("store.add_pending_new", reps * n, (double)total / (double)(reps * n), n);
+        }
+
+        OrderStore store;
+        fill_store(store, n);
+        std::vector<int> ids = shuffled_ids(n);
+
+        // Repeat ACK of a live order: lookup + state check
+        run_bench("store.on_ack", iters, [&](long i) {
+            int id = ids[(size_t)i % ids.size()];
+            store.on_ack(id, 90001 + (id - kFirstId));
+        }, n);
+
+        // Partial fill of a live order: lookup + qty update + state transition
+        run_bench("store.on_fill", iters, [&](long i) {
+            int id = ids[(size_t)i % ids.size()];
+            store.on_fill(id, 90001 + (id - kFirstId), 1, 100.0);
+        }, n);
+
+        run_bench("store.get", iters, [&](long i) {
+            const Order* o = store.get(ids[(size_t)i % ids.size()]);
+            do_not_optimize(o);
+        }, n);
+
+        // Full reconcile pass against a snapshot where every order is live
+        if (bench_selected("store.reconcile")) {
+            std::vector<VenueOrderStatus> snapshot;
+            snapshot.reserve((size_t)n);
+            for (int id : ids) snapshot.push_back({id, 90001 + (id - kFirstId), 1'000'000, 100.0});
+
+            long reps = std::max(1L, iters / n);
+            int64_t t0 = bench_now_ns();
+            for (long r = 0; r < reps; r++) {
+                ReconcileResult res = store.reconcile(0, snapshot, store.request_mark());
+                do_not_optimize(res);
+            }
+            bench_report("store.reconcile", reps, (double)(bench_now_ns() - t0) / (double)reps, n);
+        }
+    }
+}
+
+static void bench_positions(long iters) {
+    PositionTracker pos;
+    run_bench("position.on_fill", iters, [&](long i) {
+        // Alternate sides so the position crosses zero and realizes pnl
+        pos.on_fill((i & 1) ? Side::Sell : Side::Buy, 10 + (int)(i & 7), 100.0 + (double)(i & 15) * 0.01);
+    });
+
+    for (int n : {1, 100, 10'000}) {
+        PositionBook book;
+        std::vector<std::string> symbols;
+        for (int k = 0; k < n; k++) symbols.push_back("S" + std::to_string(k));
+        for (const auto& s : symbols) book.at(s);
+
+        run_bench("position_book.on_fill", iters, [&](long i) {
+            book.at(symbols[(size_t)i % symbols.size()]).on_fill((i & 1) ? Side::Sell : Side::Buy, 10, 100.0);
+        }, n);
+    }
+}
+
+static void bench_risk(long iters) {
+    RiskConfig cfg;
+    cfg.max_open_orders = 1'000'000;
+    cfg.max_orders_per_sec = 0.0; // Throttle off: time the pass path
+    RiskState state;
+    state.ref_px["ABC"] = 100.0;
+    const std::string abc = "ABC";
+    PositionTracker pos;
+
+    for (int n : kSizes) {
+        OrderStore store;
+        fill_store(store, n);
+
+        run_bench("risk.check_new_order", iters, [&](long i) {
+            RejectCode rc = check_new_order(cfg, state, store, pos, abc, Side::Buy, 10, 101.25, (int64_t)i);
+            do_not_optimize(rc);
+        }, n);
+    }
+
+    OrderStore store;
+    run_bench("risk.check_new_order.reject", iters, [&](long i) {
+        RejectCode rc = check_new_order(cfg, state, store, pos, abc, Side::Buy, 1000, 101.25, (int64_t)i);
+        do_not_optimize(rc);
+    });
+}
+
+static void bench_router(long iters) {
+    for (int n : {1, 3, 8}) {
+        SmartRouter router(n, RouterConfig{});
+        for (int v = 0; v < n; v++) {
+            router.set_up(v, true);
+            router.on_ack(v, 20'000 + v * 5'000);
+            router.on_routed(v, 1000);
+            router.on_fill(v, 300 + v * 50);
+        }
+
+        // Split + feedback, as one routed order costs in the loop
+        std::vector<ChildSlice> slices;
+        run_bench("router.route", iters, [&](long i) {
+            router.route(1000 + (int)(i & 255), slices);
+            for (const ChildSlice& c : slices) router.on_routed(c.venue, c.qty);
+            do_not_optimize(slices);
+        }, n);
+
+        OrderStore store;
+        router.route(1000, slices);
+        run_bench("store.split", iters, [&](long i) {
+            int parent = kFirstId + (int)i * (1 + (int)slices.size());
+            store.add_pending_new(parent, "ABC", Side::Buy, 1000, 100.0);
+            store.split(parent, parent + 1, slices);
+        }, n);
+    }
+}
+
+static void bench_algo(long iters) {
+    for (int n : kSizes) {
+        // Steady state with n pending timers: pop the earliest, re-arm it
+        if (bench_selected("timers.pop_schedule")) {
+            TimerQueue q;
+            std::mt19937_64 rng(1);
+            for (int i = 0; i < n; i++) q.schedule((int64_t)(rng() % 1'000'000'000), i, 0);
+            run_bench("timers.pop_schedule", iters, [&](long) {
+                TimerQueue::Timer t;
+                q.pop_due(INT64_MAX, t);
+                q.schedule(t.due_ns + 1'000'000'000 + (t.key & 1023), t.key, t.gen);
+            }, n);
+        }
+
+        // n active TWAP parents, 1ms apart per slice: cost per slice released
+        if (bench_selected("algo.twap_tick")) {
+            OrderStore store;
+            AlgoEngine eng(store);
+            std::vector<SliceRequest> out;
+            AlgoParams p;
+            p.kind = AlgoKind::Twap;
+            p.slices = 1'000'000;
+            p.duration_ns = (int64_t)p.slices * 1'000'000;
+            const int64_t interval = 1'000'000;
+            for (int i = 0; i < n; i++) {
+                store.add_parent(kFirstId + i, "ABC", Side::Buy, 1'000'000'000, 100.0);
+                eng.start(kFirstId + i, p, (int64_t)i * interval / n, out);
+            }
+            out.clear();
+
+            long events = 0;
+            int64_t now = interval;
+            int64_t t0 = bench_now_ns();
+            while (events < iters) {
+                now += interval / n + 1;
+                eng.on_timer(now, out);
+                events += (long)out.size();
+                out.clear();
+            }
+            bench_report("algo.twap_tick", events, (double)(bench_now_ns() - t0) / (double)events, n);
+        }
+
+        // n active icebergs: a child fills, the parent refills with a new one
+        if (bench_selected("algo.iceberg_refill")) {
+            OrderStore store;
+            AlgoEngine eng(store);
+            std::vector<SliceRequest> out;
+            AlgoParams p;
+            p.kind = AlgoKind::Iceberg;
+            p.display_qty = 10;
+
+            int next_id = kFirstId + n;
+            std::vector<int> child_of(n);
+            for (int i = 0; i < n; i++) {
+                store.add_parent(kFirstId + i, "ABC", Side::Buy, 1'000'000'000, 100.0);
+                eng.start(kFirstId + i, p, 0, out);
+                store.add_child(kFirstId + i, next_id, 0, 10);
+                eng.on_slice_sent(kFirstId + i, next_id, 10);
+                child_of[i] = next_id++;
+            }
+            out.clear();
+            std::vector<int> order = shuffled_ids(n);
+
+            run_bench("algo.iceberg_refill", iters, [&](long i) {
+                int k = order[(size_t)i % order.size()] - kFirstId;
+                store.on_fill(child_of[k], 90001, 10, 100.0);
+                eng.on_child_update(child_of[k], 0, out);
+                for (const SliceRequest& r : out) {
+                    store.add_child(r.parent_id, next_id, 0, r.qty);
+                    eng.on_slice_sent(r.parent_id, next_id, r.qty);
+                    child_of[k] = next_id++;
+                }
+                out.clear();
+            }, n);
+        }
+    }
+}
+
+static void bench_metrics(long iters) {
+    metrics::Counter c = metrics::counter("bench_counter");
+    metrics::Gauge g = metrics::gauge("bench_gauge");
+    metrics::Histogram h = metrics::histogram("bench_ns");
+
+    run_bench("metrics.counter_inc", iters, [&](long) { c.inc(); });
+    run_bench("metrics.gauge_set", iters, [&](long i) { g.set((double)i); });
+    run_bench("metrics.histogram_record", iters, [&](long i) { h.record((uint64_t)i); });
+    run_bench("metrics.snapshot", iters / 1000, [](long) {
+        std::string s = metrics::snapshot();
+        do_not_optimize(s);
+    });
+}
+
+static void bench_ledger(long iters) {
+    if (!bench_selected("ledger.on_fill")) return;
+
+    char path[] = "/tmp/oms_microbench_XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0) return;
+    ::close(fd);
+
+    {
+        Ledger ledger;
+        if (ledger.open(path)) {
+            // One flushed CSV line per fill, as in a live run
+            const std::string abc = "ABC";
+            run_bench("ledger.on_fill", iters, [&](long i) {
+                ledger.on_fill(1'700'000'000'000'000LL + i, kFirstId + (int)i, 90001 + (int)i, abc,
+                               Side::Buy, 10, 101.25, (int)i);
+            });
+        }
+    }
+    ::unlink(path);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) bench_filter() = argv[1];
+
+    const long N = 1'000'000;
+
+    bench_codec(N);
+    bench_store(N);
+    bench_positions(N);
+    bench_risk(N);
+    bench_router(N);
+    bench_algo(N);
+    bench_metrics(N);
+    bench_ledger(N / 10);
+    return 0;
+}
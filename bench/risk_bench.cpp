@@ -0,0 +1,106 @@
+// Pre-trade risk latency: each rule on its own, then the full chains
+#include "bench_util.h"
+#include "oms/orders.h"
+#include "oms/positions.h"
+#include "oms/risk.h"
+#include "oms/risk_rules.h"
+
+#include <atomic>
+#include <string>
+
+using namespace risk;
+
+namespace legacy {
+
+// String-returning check as it was before the rule chain, kept as the baseline
+std::string check_new_order(const RiskConfig& cfg, const OrderStore& store, const PositionTracker& pos,
+                            Side side, int qty, double price) {
+    const RiskLimits& lim = cfg.defaults;
+    if (qty <= 0 || price <= 0.0) return "BAD_INPUT";
+    if (qty > lim.max_order_qty) return "MAX_ORDER_QTY";
+    if ((double)qty * price > lim.max_notional) return "MAX_NOTIONAL";
+    if (store.open_orders_count() > cfg.max_open_orders) return "MAX_OPEN_ORDERS";
+    int new_pos = pos.position() + ((side == Side::Buy) ? qty : -qty);
+    if (std::abs(new_pos) > lim.max_abs_position) return "MAX_POSITION";
+    return "";
+}
+
+} // namespace legacy
+
+template <class Rule>
+static void bench_rule(const char* name, long iters, const RiskConfig& cfg, RiskState& state,
+                       const std::string& symbol) {
+    const RiskLimits& lim = cfg.limits(symbol);
+    run_bench(name, iters, [&](long i) {
+        OrderCheck c{cfg, lim, state, symbol, 10, 101.25, 1, 0, 10, (int64_t)i * 1000};
+        RejectCode r = RuleChain<Rule>::check(c);
+        do_not_optimize(r);
+    });
+}
+
+int main() {
+    const long N = 2'000'000;
+
+    RiskConfig cfg;
+    cfg.max_orders_per_sec = 1e9; // Never throttle: time the pass path
+    cfg.order_burst = 1e9;
+    RiskState state;
+    state.ref_px["ABC"] = 100.0;
+
+    const std::string abc = "ABC";
+    OrderStore store;
+    store.add_pending_new(1001, abc, Side::Buy, 10, 101.25);
+    PositionTracker pos;
+
+    bench_rule<ValidInput>("risk.rule.valid_input", N, cfg, state, abc);
+    bench_rule<MaxOrderQty>("risk.rule.max_order_qty", N, cfg, state, abc);
+    bench_rule<MaxNotional>("risk.rule.max_notional", N, cfg, state, abc);
+    bench_rule<MaxOpenOrders>("risk.rule.max_open_orders", N, cfg, state, abc);
+    bench_rule<MaxPosition>("risk.rule.max_position", N, cfg, state, abc);
+    bench_rule<PriceBand>("risk.rule.price_band", N, cfg, state, abc);
+    bench_rule<OrderRate>("risk.rule.order_rate", N, cfg, state, abc);
+
+    // Wired to a flag that is off, as with --state-shm
+    std::atomic<uint32_t> kill{0};
+    state.kill_switch = &kill;
+    bench_rule<KillSwitch>("risk.rule.kill_switch", N, cfg, state, abc);
+    run_bench("risk.check_new_order.chain.kill_switch", N, [&](long i) {
+        RejectCode r = check_new_order(cfg, state, store, pos, abc, Side::Buy, 10, 101.25, (int64_t)i * 1000);
+        do_not_optimize(r);
+    });
+    state.kill_switch = nullptr;
+
+    run_bench("risk.limits_lookup", N, [&](long) {
+        const RiskLimits& lim = cfg.limits(abc);
+        do_not_optimize(lim);
+    });
+
+    run_bench("risk.check_new_order.chain", N, [&](long i) {
+        RejectCode r = check_new_order(cfg, state, store, pos, abc, Side::Buy, 10, 101.25, (int64_t)i * 1000);
+        do_not_optimize(r);
+    });
+
+    // Reject path, including building the text the old code stored on the order
+    run_bench("risk.check_new_order.reject.legacy_string", N, [&](long) {
+        std::string reason = legacy::check_new_order(cfg, store, pos, Side::Buy, 1000, 101.25);
+        if (!reason.empty()) reason = "RISK_" + reason;
+        do_not_optimize(reason);
+    });
+    run_bench("risk.check_new_order.reject.chain", N, [&](long i) {
+        RejectCode r = check_new_order(cfg, state, store, pos, abc, Side::Buy, 1000, 101.25, (int64_t)i * 1000);
+        do_not_optimize(r);
+    });
+
+    // Per-symbol limit lookup cost as the override table grows
+    for (int n : {0, 100, 10000}) {
+        RiskConfig big = cfg;
+        for (int k = 0; k < n; k++) big.per_symbol["S" + std::to_string(k)] = cfg.defaults;
+        big.per_symbol[abc] = cfg.defaults;
+        run_bench("risk.check_new_order.overrides", N, [&](long i) {
+            RejectCode r = check_new_order(big, state, store, pos, abc, Side::Buy, 10, 101.25, (int64_t)i * 1000);
+            do_not_optimize(r);
+        }, n);
+    }
+
+    return 0;
+}
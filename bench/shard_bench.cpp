@@ -0,0 +1,183 @@
+// ShardedCore throughput against the number of shards
+//
+// A loopback venue thread answers every NEW with ACK and FILL. One
+// producer thread per shard submits orders over 256 symbols, each keeping
+// a window of orders in flight; the main thread is the dispatcher. Per
+// shard count n:
+//
+//   shard.throughput   wall time per order, submit to FILL callback, over
+//                      the whole run (lower is better, ideally ~1/n)
+//
+// Only meaningful with more cores than shards + 2 (producers, dispatcher
+// and venue share the rest); on fewer cores it shows the overhead.
+//
+//   shard_bench [orders] [max_shards] [venue_port]
+#include "bench_util.h"
+#include "common/messages.h"
+#include "common/net.h"
+#include "common/session.h"
+#include "oms/sharded_core.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr int kSymbols = 256;
+static constexpr long kWindow = 256; // Orders in flight per producer
+
+// Venue: every NEW filled at once, replies sent once the input is drained
+static void venue_main(int listen_fd, int connections) {
+    Session::Options o;
+    o.name = "shard_bench_venue";
+    int next_venue_id = 90001;
+    std::string line;
+    std::string out;
+    for (int c = 0; c < connections; c++) {
+        int fd = tcp_accept(listen_fd);
+        if (fd < 0) return;
+        Session venue(o);
+        venue.attach(std::make_unique<TcpConnection>(fd));
+        bool open = true;
+        while (open) {
+            if (!venue.connection()->has_line() && !venue.connection()->wait_readable(100)) {
+                venue.on_timer(bench_now_ns());
+                continue;
+            }
+            do {
+                Session::ReadResult rr = venue.read(line);
+                if (rr == Session::ReadResult::Closed) {
+                    open = false;
+                    break;
+                }
+                if (rr != Session::ReadResult::Data) continue;
+                Msg m = parse_msg(line);
+                if (m.kind != MsgKind::New) continue;
+                Msg ack;
+                ack.kind = MsgKind::Ack;
+                ack.client_id = m.client_id;
+                ack.venue_id = next_venue_id++;
+                Msg fill = ack;
+                fill.kind = MsgKind::Fill;
+                fill.qty = m.qty;
+                fill.price = m.price;
+                fill.liquidity = 'A';
+                WireBuf w;
+                encode_msg(ack, w);
+                out.append(w.data, w.len);
+                encode_msg(fill, w);
+                out.append(w.data, w.len);
+            } while (venue.connection()->has_line());
+            if (!out.empty()) {
+                venue.send(out);
+                out.clear();
+            }
+        }
+    }
+}
+
+struct Producer {
+    std::atomic<long> done{0};
+};
+
+static void on_event(void* ctx, const OrderEvent& ev) {
+    if (ev.state == OrderState::Filled || ev.state == OrderState::Rejected) {
+        static_cast<Producer*>(ctx)->done.fetch_add(1, std::memory_order_release);
+    }
+}
+
+static bool run(int shards, long orders, int port, const std::string& risk_path,
+                const std::vector<std::string>& symbols) {
+    ShardedOptions opts;
+    opts.venue_port = port;
+    opts.shards = shards;
+    opts.risk_path = risk_path;
+    opts.max_orders = (int)(orders / shards) + 4096;
+
+    ShardedCore core(opts);
+    if (!core.start()) return false;
+
+    const long per = orders / shards;
+    std::vector<Producer> prod((size_t)shards);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < shards; p++) {
+        threads.emplace_back([&, p] {
+            Producer& me = prod[(size_t)p];
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (long i = 0; i < per; i++) {
+                while (i - me.done.load(std::memory_order_acquire) >= kWindow) std::this_thread::yield();
+                const std::string& sym = symbols[(size_t)((i * 7 + p * 131) % kSymbols)];
+                while (!core.submit(sym, (i & 1) ? Side::Sell : Side::Buy, 10, 100.0, on_event, &me)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    int64_t t0 = bench_now_ns();
+    go.store(true, std::memory_order_release);
+    bool ok = true;
+    while (ok) {
+        long done = 0;
+        for (const Producer& p : prod) done += p.done.load(std::memory_order_acquire);
+        if (done >= per * shards) break;
+        ok = core.poll(1);
+    }
+    int64_t t1 = bench_now_ns();
+    for (std::thread& t : threads) t.join();
+    if (!ok) {
+        std::fprintf(stderr, "shard_bench: run with %d shard(s) failed\n", shards);
+        return false;
+    }
+    bench_report("shard.throughput", per * shards, (double)(t1 - t0) / (double)(per * shards), shards);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    long orders = (argc > 1) ? std::atol(argv[1]) : 200'000;
+    int max_shards = (argc > 2) ? std::atoi(argv[2]) : 4;
+    int port = (argc > 3) ? std::atoi(argv[3]) : 9131;
+    if (orders <= 0 || max_shards <= 0 || port <= 0) {
+        std::fprintf(stderr, "usage: shard_bench [orders] [max_shards] [venue_port]\n");
+        return 1;
+    }
+
+    // Limits out of the way, except the firm-wide open order count
+    char risk_path[] = "/tmp/shard_bench_risk_XXXXXX";
+    int rfd = ::mkstemp(risk_path);
+    if (rfd < 0) return 1;
+    const std::string conf = "max_order_qty = 1000000\nmax_notional = 1e12\nmax_abs_position = 1000000000\n"
+                             "max_open_orders = 100000\nmax_orders_per_sec = 0\n";
+    bool wrote = ::write(rfd, conf.data(), conf.size()) == (ssize_t)conf.size();
+    ::close(rfd);
+
+    int lfd = tcp_listen_loopback(port);
+    if (!wrote || lfd < 0) {
+        std::fprintf(stderr, "shard_bench: setup failed\n");
+        ::unlink(risk_path);
+        return 1;
+    }
+
+    std::vector<std::string> symbols;
+    for (int i = 0; i < kSymbols; i++) symbols.push_back("S" + std::to_string(i));
+
+    int runs = 0;
+    for (int n = 1; n <= max_shards; n *= 2) runs++;
+    std::thread venue(venue_main, lfd, runs);
+
+    bool ok = true;
+    for (int n = 1; n <= max_shards && ok; n *= 2) ok = run(n, orders, port, risk_path, symbols);
+
+    ::shutdown(lfd, SHUT_RDWR);
+    venue.join();
+    ::close(lfd);
+    ::unlink(risk_path);
+    return ok ? 0 : 1;
+}
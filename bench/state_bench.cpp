@@ -0,0 +1,78 @@
+// Cost of publishing OMS state to shared memory, and of reading it
+//
+//   state.publish_firm       one summary store under its seqlock (every loop pass)
+//   state.publish_symbol     one symbol record (every fill)
+//   state.read_firm          a monitor's copy of the summary
+//   state.publish_firm.read  the store again with a reader thread copying
+//                            the summary in a loop; the writer never waits,
+//                            only the cache line moves (needs 2+ cores)
+//
+//   state_bench [iters]
+#include "bench_util.h"
+#include "oms/state_shm.h"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+static const char* kBenchShm = "/mini_oms_state_bench";
+
+int main(int argc, char** argv) {
+    long iters = (argc > 1) ? std::atol(argv[1]) : 2'000'000;
+    if (iters <= 0) {
+        std::fprintf(stderr, "usage: state_bench [iters]\n");
+        return 1;
+    }
+
+    ::shm_unlink(kBenchShm);
+    StatePublisher pub;
+    StateReader reader;
+    if (!pub.open(kBenchShm) || !reader.open(kBenchShm)) return 1;
+
+    FirmSummary f;
+    f.max_open_orders = 50;
+    f.order_burst = 1000.0;
+    f.orders_per_sec = 500.0;
+    run_bench("state.publish_firm", iters, [&](long i) {
+        f.ts_ns = i;
+        f.open_orders = (int)(i & 63);
+        pub.publish_firm(f);
+    });
+
+    const std::string abc = "ABC";
+    SymbolState s;
+    s.max_abs_position = 200;
+    pub.publish_symbol(abc, s);
+    run_bench("state.publish_symbol", iters, [&](long i) {
+        s.position = (int)(i & 127);
+        s.avg_cost = 100.0 + (double)(i & 7);
+        pub.publish_symbol(abc, s);
+    });
+
+    run_bench("state.read_firm", iters, [&](long) {
+        FirmSummary out;
+        bool ok = reader.firm(out);
+        do_not_optimize(ok);
+        do_not_optimize(out);
+    });
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> reads{0};
+    std::thread monitor([&] {
+        long n = 0;
+        FirmSummary out;
+        while (!stop.load(std::memory_order_relaxed)) n += reader.firm(out) ? 1 : 0;
+        reads.store(n);
+    });
+    run_bench("state.publish_firm.read", iters, [&](long i) {
+        f.ts_ns = i;
+        pub.publish_firm(f);
+    });
+    stop.store(true);
+    monitor.join();
+
+    ::shm_unlink(kBenchShm);
+    return reads.load() > 0 ? 0 : 1;
+}
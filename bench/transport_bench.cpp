@@ -0,0 +1,91 @@
+// Round-trip latency: TCP loopback (poll or io_uring) vs the shared-memory rings
+// A forked child echoes every line back; the parent times PING -> echo.
+#include "bench_util.h"
+#include "common/net.h"
+#include "common/shm_transport.h"
+#include "common/transport.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+static void echo_loop(Connection& conn) {
+    std::string line;
+    while (conn.read_line(line)) {
+        line.push_back('\n');
+        if (!conn.write_all(line)) break;
+    }
+}
+
+static void ping_pong(const char* name, Connection& conn, long iters) {
+    std::string reply;
+    run_bench(name, iters, [&](long i) {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), "PING %ld\n", i);
+        conn.write_all(std::string_view(buf, (size_t)n));
+        conn.read_line(reply);
+        do_not_optimize(reply);
+    });
+}
+
+static int bench_tcp(const char* name, NetBackend net, long iters) {
+    const int port = 9101;
+    int lfd = tcp_listen_loopback(port);
+    if (lfd < 0) return 1;
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        ::close(lfd);
+        int fd = tcp_connect_ipv4("127.0.0.1", port);
+        if (fd >= 0) {
+            enable_rx_timestamps(fd);
+            echo_loop(*tcp_connection(fd, net));
+        }
+        ::_exit(0);
+    }
+
+    int cfd = tcp_accept(lfd);
+    ::close(lfd);
+    if (cfd < 0) return 1;
+    ping_pong(name, *tcp_connection(cfd, net), iters);
+    ::waitpid(pid, nullptr, 0);
+    return 0;
+}
+
+static int bench_shm(const char* name, ShmWait wait, long iters) {
+    const char* seg = "/mini_oms_bench";
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        // Give the parent time to create the segment
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::unique_ptr<Connection> c = shm_connect(seg, wait);
+        if (c) echo_loop(*c);
+        ::_exit(0);
+    }
+
+    {
+        std::unique_ptr<Connection> conn = shm_accept(seg, wait);
+        if (!conn) return 1;
+        ping_pong(name, *conn, iters);
+    }
+    ::waitpid(pid, nullptr, 0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    long iters = (argc > 1) ? std::atol(argv[1]) : 20000;
+
+    if (bench_tcp("transport.rtt.tcp_loopback", NetBackend::Poll, iters) != 0) return 1;
+    if (bench_tcp("transport.rtt.tcp_uring", NetBackend::Uring, iters) != 0) return 1;
+    if (bench_shm("transport.rtt.shm_futex", ShmWait::Futex, iters) != 0) return 1;
+    if (bench_shm("transport.rtt.shm_spin", ShmWait::Spin, iters) != 0) return 1;
+    return 0;
+}
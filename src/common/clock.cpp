@@ -0,0 +1,185 @@
+#include "common/clock.h"
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define OMS_HAVE_TSC 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+
+static int64_t sys_ns(clockid_t id) {
+    timespec ts;
+    clock_gettime(id, &ts);
+    return (int64_t)ts.tv_sec * 1'000'000'000 + ts.tv_nsec;
+}
+
+#ifdef OMS_HAVE_TSC
+
+namespace {
+
+// ns per tick in fixed point, mult / 2^kShift
+constexpr int kShift = 24;
+
+constexpr int64_t kCalibrateNs = 2'000'000;  // First fit, taken on first use
+constexpr int64_t kRefitNs = 1'000'000'000;
+constexpr double kMaxSlew = 500e-6;          // Rate change used to slew an offset out
+constexpr int64_t kStepNs = 1'000'000;       // Further behind than this is stepped
+
+// ticks * mult >> kShift, split so it cannot overflow for any sane delta
+int64_t scale(uint64_t ticks, uint64_t mult) {
+    return (int64_t)((((ticks >> 32) * mult) << (32 - kShift)) + (((ticks & 0xffffffffu) * mult) >> kShift));
+}
+
+// CLOCK_MONOTONIC and the TSC at (nearly) the same instant: the tightest
+// bracket of a few tries
+void sample(uint64_t& tsc, int64_t& ns) {
+    uint64_t best = ~uint64_t(0);
+    for (int i = 0; i < 5; i++) {
+        uint64_t a = __rdtsc();
+        int64_t t = sys_ns(CLOCK_MONOTONIC);
+        uint64_t b = __rdtsc();
+        if (b - a < best) {
+            best = b - a;
+            tsc = a + (b - a) / 2;
+            ns = t;
+        }
+    }
+}
+
+// Invariant TSC, and the kernel agrees: under a hypervisor it often runs
+// kvm-clock instead because the TSC can't be trusted there
+bool tsc_usable() {
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if (!__get_cpuid(0x80000007, &a, &b, &c, &d) || !(d & (1u << 8))) return false;
+    std::ifstream f("/sys/devices/system/clocksource/clocksource0/current_clocksource");
+    std::string cs;
+    return !(f >> cs) || cs == "tsc";
+}
+
+struct TscClock {
+    bool usable = false;
+
+    // Current fit, published under a seqlock (odd = being rewritten)
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint64_t> tsc0{0};
+    std::atomic<int64_t> ns0{0};
+    std::atomic<uint64_t> mult{0};
+
+    std::atomic<uint64_t> next_refit{0}; // TSC value
+    std::atomic_flag refitting = ATOMIC_FLAG_INIT;
+
+    // Refit only: the first sample, the rate is fitted from there
+    uint64_t first_tsc = 0;
+    int64_t first_ns = 0;
+    uint64_t refit_ticks = 0;
+
+    TscClock() {
+        if (!tsc_usable()) return;
+        uint64_t t1 = 0;
+        int64_t n1 = 0;
+        sample(first_tsc, first_ns);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(kCalibrateNs));
+        sample(t1, n1);
+        if (t1 <= first_tsc || n1 <= first_ns) return;
+
+        const double ticks_per_ns = (double)(t1 - first_tsc) / (double)(n1 - first_ns);
+        refit_ticks = (uint64_t)(ticks_per_ns * (double)kRefitNs);
+        tsc0.store(t1, std::memory_order_relaxed);
+        ns0.store(n1, std::memory_order_relaxed);
+        mult.store(((uint64_t)(n1 - first_ns) << kShift) / (t1 - first_tsc), std::memory_order_relaxed);
+        next_refit.store(t1 + refit_ticks, std::memory_order_relaxed);
+        usable = true;
+    }
+
+    int64_t eval(uint64_t now) const {
+        while (true) {
+            uint32_t s = seq.load(std::memory_order_acquire);
+            uint64_t t0 = tsc0.load(std::memory_order_relaxed);
+            int64_t n0 = ns0.load(std::memory_order_relaxed);
+            uint64_t m = mult.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((s & 1) || seq.load(std::memory_order_relaxed) != s) continue;
+            // A refit on another thread can sample after our rdtsc
+            return now >= t0 ? n0 + scale(now - t0, m) : n0 - scale(t0 - now, m);
+        }
+    }
+
+    // Re-fits the rate from the first sample to now, tilted to slew the
+    // current offset out over the next period. Continuous at the switch,
+    // so the clock never jumps back
+    void refit() {
+        if (refitting.test_and_set(std::memory_order_acquire)) return;
+        uint64_t t = 0;
+        int64_t n = 0;
+        sample(t, n);
+        if (t >= next_refit.load(std::memory_order_relaxed)) {
+            int64_t cur = eval(t);
+            int64_t err = n - cur; // > 0: we are behind CLOCK_MONOTONIC
+            double slew = (double)err / (double)kRefitNs;
+            if (slew > kMaxSlew) slew = kMaxSlew;
+            if (slew < -kMaxSlew) slew = -kMaxSlew;
+            if (err > kStepNs) {
+                cur = n;
+                slew = 0.0;
+            }
+            const double ns_per_tick = (double)(n - first_ns) / (double)(t - first_tsc);
+            const uint64_t m = (uint64_t)(ns_per_tick * (1.0 + slew) * (double)(uint64_t(1) << kShift) + 0.5);
+
+            uint32_t s = seq.load(std::memory_order_relaxed);
+            seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            tsc0.store(t, std::memory_order_relaxed);
+            ns0.store(cur, std::memory_order_relaxed);
+            mult.store(m, std::memory_order_relaxed);
+            seq.store(s + 2, std::memory_order_release);
+            next_refit.store(t + refit_ticks, std::memory_order_relaxed);
+        }
+        refitting.clear(std::memory_order_release);
+    }
+};
+
+TscClock& tsc_clock() {
+    static TscClock c;
+    return c;
+}
+
+} // namespace
+
+int64_t mono_ns() {
+    TscClock& c = tsc_clock();
+    if (!c.usable) return sys_ns(CLOCK_MONOTONIC);
+    uint64_t now = __rdtsc();
+    if (now >= c.next_refit.load(std::memory_order_relaxed)) c.refit();
+    return c.eval(now);
+}
+
+const char* clock_source() {
+    return tsc_clock().usable ? "tsc" : "clock_gettime";
+}
+
+#else
+
+int64_t mono_ns() {
+    return sys_ns(CLOCK_MONOTONIC);
+}
+
+const char* clock_source() {
+    return "clock_gettime";
+}
+
+#endif
+
+int64_t wall_ns() {
+    return sys_ns(CLOCK_REALTIME);
+}
+
+int64_t wall_to_mono_ns(int64_t wall) {
+    return mono_ns() - (wall_ns() - wall);
+}
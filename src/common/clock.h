@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Process-wide clocks, safe to call from any thread.
+//
+// mono_ns() reads the TSC when the CPU has an invariant one and the kernel
+// itself uses it as its clocksource; ticks are scaled to nanoseconds by a
+// rate fitted against CLOCK_MONOTONIC. The fit is redone about once a
+// second (by whichever caller crosses the deadline) and any offset that
+// built up is slewed out, so values track CLOCK_MONOTONIC closely and
+// never go backwards. The first call takes the initial fit (2 ms).
+// Without a usable TSC it is clock_gettime.
+
+// Nanoseconds on the CLOCK_MONOTONIC timeline
+int64_t mono_ns();
+
+// CLOCK_REALTIME, for timestamps that leave the process (ledger rows)
+int64_t wall_ns();
+inline int64_t wall_us() { return wall_ns() / 1000; }
+
+// A CLOCK_REALTIME time in the recent past (a kernel receive timestamp)
+// moved onto the mono_ns() timeline
+int64_t wall_to_mono_ns(int64_t wall);
+
+// "tsc" or "clock_gettime"
+const char* clock_source();
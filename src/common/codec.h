@@ -0,0 +1,181 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+// Compile-time line codec
+// A schema is a tag plus a FieldList of pointers to members; encode/decode
+// are generated from it. Tokens are space separated, one message per line.
+// Nothing allocates: encode writes into a caller buffer and decode returns
+// string_views into the input line.
+namespace codec {
+
+// One space-separated token bound to a member (int, uint64_t, double, char, string_view)
+template <auto Member> struct Field {};
+// Everything to end of line, may contain spaces (must be the last field)
+template <auto Member> struct Rest {};
+
+template <class... Fs> struct FieldList {};
+
+// ---- Writers: return the new end, nullptr if the value doesn't fit
+
+inline char* put(char* p, char* end, int v) {
+    auto r = std::to_chars(p, end, v);
+    return (r.ec == std::errc()) ? r.ptr : nullptr;
+}
+
+inline char* put(char* p, char* end, uint64_t v) {
+    auto r = std::to_chars(p, end, v);
+    return (r.ec == std::errc()) ? r.ptr : nullptr;
+}
+
+inline char* put(char* p, char* end, double v) {
+    // Shortest round-trip form, so the reader gets back the exact double
+    auto r = std::to_chars(p, end, v);
+    return (r.ec == std::errc()) ? r.ptr : nullptr;
+}
+
+// Prices on a 1/10000 grid (any tick in use) as fixed point, several times
+// cheaper than the shortest form; anything else goes through put(double).
+// n / 10000.0 is the double nearest the decimal n/10000, so when it equals
+// v the reader's from_chars gives back exactly v
+inline char* put_price(char* p, char* end, double v) {
+    if (!(v > 0.0 && v < 1e11)) return put(p, end, v);
+    const int64_t n = (int64_t)(v * 10000.0 + 0.5);
+    if ((double)n / 10000.0 != v) return put(p, end, v);
+
+    auto r = std::to_chars(p, end, n / 10000);
+    if (r.ec != std::errc()) return nullptr;
+    p = r.ptr;
+    int frac = (int)(n % 10000);
+    if (frac == 0) return p;
+    int digits = 4;
+    while (frac % 10 == 0) {
+        frac /= 10;
+        digits--;
+    }
+    if (end - p < digits + 1) return nullptr;
+    *p++ = '.';
+    for (int i = digits - 1; i >= 0; i--) {
+        p[i] = (char)('0' + frac % 10);
+        frac /= 10;
+    }
+    return p + digits;
+}
+
+inline char* put(char* p, char* end, char v) {
+    if (p == end) return nullptr;
+    *p++ = v;
+    return p;
+}
+
+inline char* put(char* p, char* end, std::string_view v) {
+    if ((size_t)(end - p) < v.size()) return nullptr;
+    std::memcpy(p, v.data(), v.size());
+    return p + v.size();
+}
+
+// ---- Readers: false if the token is missing or doesn't parse fully
+
+inline bool get(std::string_view tok, int& v) {
+    auto r = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    return !tok.empty() && r.ec == std::errc() && r.ptr == tok.data() + tok.size();
+}
+
+inline bool get(std::string_view tok, uint64_t& v) {
+    auto r = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    return !tok.empty() && r.ec == std::errc() && r.ptr == tok.data() + tok.size();
+}
+
+inline bool get(std::string_view tok, double& v) {
+    auto r = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    return !tok.empty() && r.ec == std::errc() && r.ptr == tok.data() + tok.size();
+}
+
+inline bool get(std::string_view tok, char& v) {
+    if (tok.size() != 1) return false;
+    v = tok[0];
+    return true;
+}
+
+inline bool get(std::string_view tok, std::string_view& v) {
+    if (tok.empty()) return false;
+    v = tok;
+    return true;
+}
+
+// Pops the next space-separated token off the front of `in`
+inline std::string_view next_token(std::string_view& in) {
+    size_t b = 0;
+    while (b < in.size() && in[b] == ' ') b++;
+    size_t e = b;
+    while (e < in.size() && in[e] != ' ') e++;
+    std::string_view tok = in.substr(b, e - b);
+    in.remove_prefix(e);
+    return tok;
+}
+
+// ---- Per-field glue
+
+template <auto M, class T>
+char* encode_field(Field<M>, const T& obj, char* p, char* end) {
+    if (!p || p == end) return nullptr;
+    *p++ = ' ';
+    return put(p, end, obj.*M);
+}
+
+template <auto M, class T>
+char* encode_field(Rest<M>, const T& obj, char* p, char* end) {
+    if (!p || p == end) return nullptr;
+    *p++ = ' ';
+    return put(p, end, obj.*M);
+}
+
+template <auto M, class T>
+bool decode_field(Field<M>, T& obj, std::string_view& in) {
+    return get(next_token(in), obj.*M);
+}
+
+template <auto M, class T>
+bool decode_field(Rest<M>, T& obj, std::string_view& in) {
+    if (!in.empty() && in[0] == ' ') in.remove_prefix(1);
+    obj.*M = in;
+    in = {};
+    return true;
+}
+
+// ---- Whole message
+
+// Writes "<tag> <f1> <f2> ...\n" into buf. Returns bytes written, 0 if it doesn't fit
+template <class Schema, class T, class... Fs>
+size_t encode(const T& obj, char* buf, size_t cap, FieldList<Fs...>) {
+    char* end = buf + cap;
+    char* p = put(buf, end, Schema::tag);
+    ((p = encode_field(Fs{}, obj, p, end)), ...);
+    if (!p || p == end) return 0;
+    *p++ = '\n';
+    return (size_t)(p - buf);
+}
+
+template <class Schema, class T>
+size_t encode(const T& obj, char* buf, size_t cap) {
+    return encode<Schema>(obj, buf, cap, typename Schema::fields{});
+}
+
+// Parses the fields after the tag. Every field must be present, no trailing tokens
+template <class Schema, class T, class... Fs>
+bool decode(T& obj, std::string_view in, FieldList<Fs...>) {
+    if (!(decode_field(Fs{}, obj, in) && ...)) return false;
+    return next_token(in).empty();
+}
+
+template <class Schema, class T>
+bool decode(T& obj, std::string_view in) {
+    return decode<Schema>(obj, in, typename Schema::fields{});
+}
+
+} // namespace codec
@@ -1,59 +1,147 @@
 #include "messages.h"
 
-#include <sstream>
+#include <type_traits>
 
-std::string format_new(const NewOrder& o) {
-    std::ostringstream oss;
-    // Trailing newline = one message per line
-    oss << "NEW " << o.client_id << " " << o.symbol << " " << o.side
-        << " " << o.qty << " " << o.price << "\n";
-    return oss.str();
+namespace {
+
+template <MsgKind... Ks> struct KindList {};
+
+// Every kind with a schema; encode/decode dispatch is generated from this
+using AllKinds = KindList<
+    MsgKind::New, MsgKind::Cancel, MsgKind::MassCancel, MsgKind::Replace, MsgKind::OrderStatusAll,
+    MsgKind::Ack, MsgKind::Fill, MsgKind::Cancelled, MsgKind::Replaced, MsgKind::Reject,
+    MsgKind::OrderStatus, MsgKind::OrderStatusEnd,
+    MsgKind::Bbo, MsgKind::Trade>;
+
+template <MsgKind... Ks>
+size_t encode_dispatch(const Msg& m, char* buf, size_t cap, KindList<Ks...>) {
+    size_t n = 0;
+    (void)((m.kind == Ks && ((n = codec::encode<MsgSchema<Ks>>(m, buf, cap)), true)) || ...);
+    return n;
 }
 
-std::string format_cancel(int client_id) {
-    std::ostringstream oss;
-    oss << "CANCEL " << client_id << "\n";
-    return oss.str();
+template <MsgKind K>
+bool decode_one(std::string_view tag, std::string_view rest, Msg& m) {
+    if (tag != MsgSchema<K>::tag) return false;
+    m.kind = codec::decode<MsgSchema<K>>(m, rest) ? K : MsgKind::Malformed;
+    return true;
 }
 
-Msg parse_msg(const std::string& line) {
+template <MsgKind... Ks>
+void decode_dispatch(std::string_view tag, std::string_view rest, Msg& m, KindList<Ks...>) {
+    (void)(decode_one<Ks>(tag, rest, m) || ...);
+}
+
+} // namespace
+
+size_t encode_msg(const Msg& m, char* buf, size_t cap) {
+    return encode_dispatch(m, buf, cap, AllKinds{});
+}
+
+bool encode_msg(const Msg& m, WireBuf& b) {
+    b.len = encode_msg(m, b.data, sizeof(b.data));
+    return b.len != 0;
+}
+
+Msg parse_msg(std::string_view line) {
     Msg m;
 
-    std::istringstream iss(line);
-    std::string kind;
-    if (!(iss >> kind)) {
+    std::string_view tag = codec::next_token(line);
+    if (tag.empty()) {
         // If we can't read a kind, treat as Unknown
-        return m; // Unknown
-    }
-
-    if (kind == "ACK") {
-        m.kind = MsgKind::Ack;
-        iss >> m.client_id >> m.venue_id;
         return m;
     }
 
-    if (kind == "FILL") {
-        m.kind = MsgKind::Fill;
-        iss >> m.client_id >> m.venue_id >> m.qty >> m.price >> m.liquidity;
-        return m;
-    }
+    // Unrecognized tags stay Unknown
+    decode_dispatch(tag, line, m, AllKinds{});
+    return m;
+}
 
-    if (kind == "CANCELLED") {
-        m.kind = MsgKind::Cancelled;
-        iss >> m.client_id >> m.venue_id;
-        return m;
-    }
+Msg make_new(int client_id, std::string_view symbol, std::string_view side, int qty, double price) {
+    Msg m;
+    m.kind = MsgKind::New;
+    m.client_id = client_id;
+    m.symbol = symbol;
+    m.side = side;
+    m.qty = qty;
+    m.price = price;
+    return m;
+}
 
-    if (kind == "REJECT") {
-        m.kind = MsgKind::Reject;
-        iss >> m.client_id;
-        std::getline(iss, m.reason);
-        if (!m.reason.empty() && m.reason[0] == ' ') {
-            m.reason.erase(0, 1);
-        }
-        return m;
-    }
+Msg make_cancel(int client_id) {
+    Msg m;
+    m.kind = MsgKind::Cancel;
+    m.client_id = client_id;
+    return m;
+}
 
-    // Unrecognized message kind
+Msg make_mass_cancel(std::string_view symbol, std::string_view side) {
+    Msg m;
+    m.kind = MsgKind::MassCancel;
+    m.symbol = symbol.empty() ? "*" : symbol;
+    m.side = side.empty() ? "*" : side;
     return m;
 }
+
+Msg make_replace(int client_id, int qty, double price) {
+    Msg m;
+    m.kind = MsgKind::Replace;
+    m.client_id = client_id;
+    m.qty = qty;
+    m.price = price;
+    return m;
+}
+
+Msg make_order_status_all() {
+    Msg m;
+    m.kind = MsgKind::OrderStatusAll;
+    return m;
+}
+
+// NewTemplate writes this layout by hand
+static_assert(std::is_same<MsgSchema<MsgKind::New>::fields,
+                           codec::FieldList<codec::Field<&Msg::client_id>, codec::Field<&Msg::symbol>,
+                                            codec::Field<&Msg::side>, codec::Field<&Msg::qty>,
+                                            codec::Field<&Msg::price>>>::value,
+              "NewTemplate is out of step with the NEW schema");
+
+// Tag, space, sign and 10 digits
+static_assert(MsgSchema<MsgKind::New>::tag.size() + 12 <= 16, "NewTemplate head too small");
+
+bool NewTemplate::arm(std::string_view symbol, std::string_view side) {
+    fixed_len_ = 0;
+    // Widest qty, space, price and newline after it
+    constexpr size_t kTail = 11 + 1 + 32 + 1;
+    char* p = buf_ + kHead;
+    char* end = buf_ + sizeof(buf_) - kTail;
+    p = codec::put(p, end, ' ');
+    if (p) p = codec::put(p, end, symbol);
+    if (p) p = codec::put(p, end, ' ');
+    if (p) p = codec::put(p, end, side);
+    if (p) p = codec::put(p, end, ' ');
+    if (!p || symbol.empty() || side.empty()) return false;
+    fixed_len_ = (size_t)(p - (buf_ + kHead));
+    return true;
+}
+
+std::string_view NewTemplate::encode(int client_id, int qty, double price) {
+    if (!fixed_len_) return {};
+    constexpr std::string_view tag = MsgSchema<MsgKind::New>::tag;
+
+    // client_id right-aligned against the fixed part, the tag before it
+    char id[12];
+    auto r = std::to_chars(id, id + sizeof(id), client_id);
+    const size_t id_len = (size_t)(r.ptr - id);
+    char* start = buf_ + kHead - id_len - tag.size() - 1;
+    std::memcpy(start, tag.data(), tag.size());
+    start[tag.size()] = ' ';
+    std::memcpy(buf_ + kHead - id_len, id, id_len);
+
+    char* end = buf_ + sizeof(buf_);
+    char* p = codec::put(buf_ + kHead + fixed_len_, end, qty);
+    if (p) p = codec::put(p, end, ' ');
+    if (p) p = codec::put_price(p, end, price);
+    if (!p || p == end) return {};
+    *p++ = '\n';
+    return std::string_view(start, (size_t)(p - start));
+}
@@ -1,43 +1,208 @@
 #pragma once
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
-// Outgoing order from OMS -> venue (line-based text protocol)
-struct NewOrder {
-    int client_id;
-    std::string symbol;
-    std::string side; // "BUY" or "SELL"
-    int qty;
-    double price;
-};
-
-std::string format_new(const NewOrder& o);
-std::string format_cancel(int client_id);
+#include "common/codec.h"
 
-// Incoming message from venue -> OMS
+// Line-based text protocol shared by oms and venue_sim
 enum class MsgKind {
+    // OMS -> venue
+    New,
+    Cancel,
+    MassCancel,
+    Replace,
+    OrderStatusAll, // Snapshot request
+
+    // Venue -> OMS
     Ack,
     Fill,
     Cancelled,
+    Replaced,
     Reject,
+    OrderStatus,    // One live order in a snapshot
+    OrderStatusEnd, // Closes a snapshot
+
+    // Venue market data feed (UDP)
+    Bbo,
+    Trade,
+
+    Malformed, // Known tag, bad or missing fields
     Unknown
 };
 
-// Parsed message (which fields are meaningful depends on MsgKind)
+// One message of any kind (which fields are meaningful depends on MsgKind)
+// String fields are views: into the parsed line, or into caller storage
+// when encoding. They must outlive the Msg.
 struct Msg {
     MsgKind kind = MsgKind::Unknown;
 
     int client_id = 0;
     int venue_id = 0;
 
-    // Fill fields
+    // New / MassCancel ('*' = any on MassCancel)
+    std::string_view symbol;
+    std::string_view side; // "BUY" or "SELL"
+
+    // New / Replace / Replaced / Fill / OrderStatus (leaves qty)
     int qty = 0;
     double price = 0.0;
     char liquidity = '?';
 
     // Reject fields
-    std::string reason;
+    std::string_view reason;
+
+    // OrderStatusEnd: number of OrderStatus lines before it
+    int count = 0;
+
+    // Market data (Bbo / Trade also use symbol, and Trade uses qty/price)
+    uint64_t seq = 0; // Feed sequence number, increasing across all symbols
+    double bid_px = 0.0;
+    int bid_qty = 0;
+    double ask_px = 0.0;
+    int ask_qty = 0;
+};
+
+// ---- Schema: the single definition of every message on the wire
+
+template <MsgKind K> struct MsgSchema;
+
+template <> struct MsgSchema<MsgKind::New> {
+    static constexpr std::string_view tag = "NEW";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::client_id>, codec::Field<&Msg::symbol>, codec::Field<&Msg::side>,
+        codec::Field<&Msg::qty>, codec::Field<&Msg::price>>;
+};
+
+template <> struct MsgSchema<MsgKind::Cancel> {
+    static constexpr std::string_view tag = "CANCEL";
+    using fields = codec::FieldList<codec::Field<&Msg::client_id>>;
+};
+
+template <> struct MsgSchema<MsgKind::MassCancel> {
+    static constexpr std::string_view tag = "MASS_CANCEL";
+    using fields = codec::FieldList<codec::Field<&Msg::symbol>, codec::Field<&Msg::side>>;
+};
+
+template <> struct MsgSchema<MsgKind::Replace> {
+    static constexpr std::string_view tag = "REPLACE";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::client_id>, codec::Field<&Msg::qty>, codec::Field<&Msg::price>>;
+};
+
+template <> struct MsgSchema<MsgKind::OrderStatusAll> {
+    static constexpr std::string_view tag = "ORDER_STATUS_ALL";
+    using fields = codec::FieldList<>;
+};
+
+template <> struct MsgSchema<MsgKind::Ack> {
+    static constexpr std::string_view tag = "ACK";
+    using fields = codec::FieldList<codec::Field<&Msg::client_id>, codec::Field<&Msg::venue_id>>;
+};
+
+template <> struct MsgSchema<MsgKind::Fill> {
+    static constexpr std::string_view tag = "FILL";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::client_id>, codec::Field<&Msg::venue_id>,
+        codec::Field<&Msg::qty>, codec::Field<&Msg::price>, codec::Field<&Msg::liquidity>>;
+};
+
+template <> struct MsgSchema<MsgKind::Cancelled> {
+    static constexpr std::string_view tag = "CANCELLED";
+    using fields = codec::FieldList<codec::Field<&Msg::client_id>, codec::Field<&Msg::venue_id>>;
 };
 
-// Parse a single line (without '\n') into a Msg
-Msg parse_msg(const std::string& line);
+template <> struct MsgSchema<MsgKind::Replaced> {
+    static constexpr std::string_view tag = "REPLACED";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::client_id>, codec::Field<&Msg::venue_id>,
+        codec::Field<&Msg::qty>, codec::Field<&Msg::price>>;
+};
+
+template <> struct MsgSchema<MsgKind::Reject> {
+    static constexpr std::string_view tag = "REJECT";
+    using fields = codec::FieldList<codec::Field<&Msg::client_id>, codec::Rest<&Msg::reason>>;
+};
+
+template <> struct MsgSchema<MsgKind::OrderStatus> {
+    static constexpr std::string_view tag = "ORDER_STATUS";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::client_id>, codec::Field<&Msg::venue_id>,
+        codec::Field<&Msg::qty>, codec::Field<&Msg::price>>;
+};
+
+template <> struct MsgSchema<MsgKind::OrderStatusEnd> {
+    static constexpr std::string_view tag = "ORDER_STATUS_END";
+    using fields = codec::FieldList<codec::Field<&Msg::count>>;
+};
+
+template <> struct MsgSchema<MsgKind::Bbo> {
+    static constexpr std::string_view tag = "BBO";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::symbol>, codec::Field<&Msg::seq>,
+        codec::Field<&Msg::bid_px>, codec::Field<&Msg::bid_qty>,
+        codec::Field<&Msg::ask_px>, codec::Field<&Msg::ask_qty>>;
+};
+
+template <> struct MsgSchema<MsgKind::Trade> {
+    static constexpr std::string_view tag = "TRADE";
+    using fields = codec::FieldList<
+        codec::Field<&Msg::symbol>, codec::Field<&Msg::seq>,
+        codec::Field<&Msg::qty>, codec::Field<&Msg::price>>;
+};
+
+// ---- Encode / decode
+
+// Longest line we ever produce (symbols and reject reasons are short)
+constexpr size_t kMaxMsgLen = 256;
+
+// Writes one line (with trailing '\n') for m.kind into buf
+// Returns bytes written, 0 if it doesn't fit or the kind has no schema
+size_t encode_msg(const Msg& m, char* buf, size_t cap);
+
+// Stack buffer for one encoded line
+struct WireBuf {
+    char data[kMaxMsgLen];
+    size_t len = 0;
+
+    std::string_view view() const { return std::string_view(data, len); }
+};
+
+// Encodes into b, replacing its contents. False if it didn't fit
+bool encode_msg(const Msg& m, WireBuf& b);
+
+// Parse a single line (without '\n') into a Msg; views point into `line`
+Msg parse_msg(std::string_view line);
+
+// Builders for the OMS -> venue messages
+Msg make_new(int client_id, std::string_view symbol, std::string_view side, int qty, double price);
+Msg make_cancel(int client_id);
+// Empty symbol/side means "any" and goes on the wire as '*'
+Msg make_mass_cancel(std::string_view symbol, std::string_view side);
+// Amend qty/price of a live order in place
+Msg make_replace(int client_id, int qty, double price);
+// Ask for every live order; answered by ORDER_STATUS lines + ORDER_STATUS_END
+Msg make_order_status_all();
+
+// A NEW line for one symbol and side, armed once with everything but the
+// client_id, qty and price. encode() writes just those three around the
+// fixed part, with no Msg and no per-field dispatch, and the price goes
+// through codec::put_price. The line is the one encode_msg(make_new(...))
+// writes, except a price may be spelled differently (it parses back the same)
+class NewTemplate {
+public:
+    // False if the symbol and side don't leave room for the numbers
+    bool arm(std::string_view symbol, std::string_view side);
+    bool armed() const { return fixed_len_ != 0; }
+
+    // The finished line, valid until the next encode(); empty if not armed
+    std::string_view encode(int client_id, int qty, double price);
+
+private:
+    // Room for the tag, a space and the widest client_id before the fixed part
+    static constexpr size_t kHead = 16;
+
+    char buf_[kMaxMsgLen];
+    size_t fixed_len_ = 0; // " <symbol> <side> " at buf_ + kHead
+};
@@ -0,0 +1,288 @@
+#include "common/metrics.h"
+#include "common/net.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace metrics {
+
+namespace {
+
+enum class Type : uint8_t { Counter, Gauge, Histogram };
+
+// Registered series; ready is set once name/labels are written
+struct Desc {
+    std::atomic<uint8_t> ready{0};
+    Type type = Type::Counter;
+    char name[64] = {};
+    char labels[96] = {};
+};
+
+Desc g_series[kMaxSeries];
+std::atomic<uint32_t> g_series_count{0};
+Desc g_hists[kMaxHistograms];
+std::atomic<uint32_t> g_hist_count{0};
+
+std::atomic<double> g_gauges[kMaxSeries];
+
+// Serializes registration only; snapshot() reads the tables without it
+std::mutex g_register_mu;
+// Registrations refused because their table was full
+std::atomic<uint64_t> g_dropped_series{0};
+
+struct HistCells {
+    std::atomic<uint64_t> buckets[kHistBuckets];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+};
+
+// One per thread that has recorded anything; never freed, so counts from
+// threads that have exited still add up
+struct Slab {
+    std::atomic<uint64_t> counters[kMaxSeries];
+    HistCells hists[kMaxHistograms];
+    Slab* next = nullptr;
+};
+
+std::atomic<Slab*> g_slabs{nullptr};
+thread_local Slab* t_slab = nullptr;
+
+__attribute__((noinline)) Slab* new_slab() {
+    Slab* s = new Slab(); // Value-init: every cell starts at zero
+    s->next = g_slabs.load(std::memory_order_relaxed);
+    while (!g_slabs.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    t_slab = s;
+    return s;
+}
+
+inline Slab& local_slab() {
+    Slab* s = t_slab;
+    return s ? *s : *new_slab();
+}
+
+// Single writer per cell, so no read-modify-write needed
+inline void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Returns the id, or cap if the table is full. An identical series that is
+// already registered is reused. Under a lock, so two threads registering the
+// same series get one id, not two copies of it
+uint32_t register_in(Desc* table, std::atomic<uint32_t>& count, uint32_t cap, Type type,
+                     const char* name, const char* labels) {
+    std::lock_guard<std::mutex> lock(g_register_mu);
+    uint32_t n = count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; i++) {
+        const Desc& d = table[i];
+        if (d.type == type && std::strcmp(d.name, name) == 0 && std::strcmp(d.labels, labels) == 0) return i;
+    }
+
+    if (n >= cap) {
+        if (g_dropped_series.fetch_add(1, std::memory_order_relaxed) == 0) {
+            std::fprintf(stderr, "metrics: table full (%u), dropping %s{%s} and any series after it\n", cap, name,
+                         labels);
+        }
+        return cap;
+    }
+
+    uint32_t id = n;
+    Desc& d = table[id];
+    d.type = type;
+    std::snprintf(d.name, sizeof(d.name), "%s", name);
+    std::snprintf(d.labels, sizeof(d.labels), "%s", labels);
+    d.ready.store(1, std::memory_order_release);
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+uint32_t bucket_of(uint64_t v) {
+    uint32_t b = (v == 0) ? 0 : 64 - (uint32_t)__builtin_clzll(v); // Bit width
+    return (b < kHistBuckets) ? b : kHistBuckets - 1;
+}
+
+bool same_name(const Desc& a, const Desc& b) {
+    return std::strcmp(a.name, b.name) == 0;
+}
+
+void append_series(std::string& out, const char* name, const char* suffix, const char* labels,
+                   const char* extra_label, double value) {
+    char buf[256];
+    const bool has_labels = labels[0] || extra_label[0];
+    const char* sep = (labels[0] && extra_label[0]) ? "," : "";
+    int n = std::snprintf(buf, sizeof(buf), "%s%s%s%s%s%s%s %.17g\n", name, suffix,
+                          has_labels ? "{" : "", labels, sep, extra_label, has_labels ? "}" : "", value);
+    if (n > 0) out.append(buf, (size_t)std::min(n, (int)sizeof(buf) - 1));
+}
+
+void append_type(std::string& out, const char* name, const char* type) {
+    out += "# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+}
+
+} // namespace
+
+void Counter::inc(uint64_t n) const {
+    if (id_ >= kMaxSeries) return;
+    bump(local_slab().counters[id_], n);
+}
+
+void Gauge::set(double v) const {
+    if (id_ >= kMaxSeries) return;
+    g_gauges[id_].store(v, std::memory_order_relaxed);
+}
+
+void Histogram::record(uint64_t v) const {
+    if (id_ >= kMaxHistograms) return;
+    HistCells& h = local_slab().hists[id_];
+    bump(h.buckets[bucket_of(v)], 1);
+    bump(h.count, 1);
+    bump(h.sum, v);
+}
+
+Counter counter(const char* name, const char* labels) {
+    Counter c;
+    c.id_ = register_in(g_series, g_series_count, kMaxSeries, Type::Counter, name, labels);
+    return c;
+}
+
+Gauge gauge(const char* name, const char* labels) {
+    Gauge g;
+    g.id_ = register_in(g_series, g_series_count, kMaxSeries, Type::Gauge, name, labels);
+    return g;
+}
+
+Histogram histogram(const char* name, const char* labels) {
+    Histogram h;
+    h.id_ = register_in(g_hists, g_hist_count, kMaxHistograms, Type::Histogram, name, labels);
+    return h;
+}
+
+std::string snapshot() {
+    std::string out;
+    out.reserve(16 * 1024);
+
+    const Slab* head = g_slabs.load(std::memory_order_acquire);
+
+    // Series sharing a name have to be listed together under one TYPE line,
+    // wherever they were registered
+    uint32_t n = std::min(g_series_count.load(std::memory_order_acquire), kMaxSeries);
+    std::vector<bool> done(n, false);
+    for (uint32_t i = 0; i < n; i++) {
+        const Desc& first = g_series[i];
+        if (done[i] || !first.ready.load(std::memory_order_acquire)) continue;
+        append_type(out, first.name, (first.type == Type::Gauge) ? "gauge" : "counter");
+
+        for (uint32_t j = i; j < n; j++) {
+            const Desc& d = g_series[j];
+            if (done[j] || !d.ready.load(std::memory_order_acquire) || !same_name(d, first)) continue;
+            done[j] = true;
+
+            if (d.type == Type::Gauge) {
+                append_series(out, d.name, "", d.labels, "", g_gauges[j].load(std::memory_order_relaxed));
+                continue;
+            }
+            uint64_t total = 0;
+            for (const Slab* s = head; s; s = s->next) total += s->counters[j].load(std::memory_order_relaxed);
+            append_series(out, d.name, "", d.labels, "", (double)total);
+        }
+    }
+
+    uint32_t nh = std::min(g_hist_count.load(std::memory_order_acquire), kMaxHistograms);
+    for (uint32_t i = 0; i < nh; i++) {
+        const Desc& d = g_hists[i];
+        if (!d.ready.load(std::memory_order_acquire)) continue;
+
+        uint64_t buckets[kHistBuckets] = {};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        for (const Slab* s = head; s; s = s->next) {
+            const HistCells& h = s->hists[i];
+            for (uint32_t b = 0; b < kHistBuckets; b++) buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+            count += h.count.load(std::memory_order_relaxed);
+            sum += h.sum.load(std::memory_order_relaxed);
+        }
+
+        // Bucket b holds values of bit width b, i.e. <= 2^b - 1. Cumulative,
+        // and only up to the highest non-empty bucket to keep scrapes short
+        uint32_t top = 0;
+        for (uint32_t b = 0; b < kHistBuckets - 1; b++) {
+            if (buckets[b]) top = b;
+        }
+
+        append_type(out, d.name, "histogram");
+        uint64_t cum = 0;
+        char le[48];
+        for (uint32_t b = 0; b <= top; b++) {
+            cum += buckets[b];
+            std::snprintf(le, sizeof(le), "le=\"%llu\"", (unsigned long long)((1ULL << b) - 1));
+            append_series(out, d.name, "_bucket", d.labels, le, (double)cum);
+        }
+        append_series(out, d.name, "_bucket", d.labels, "le=\"+Inf\"", (double)count);
+        append_series(out, d.name, "_sum", d.labels, "", (double)sum);
+        append_series(out, d.name, "_count", d.labels, "", (double)count);
+    }
+
+    append_type(out, "metrics_dropped_series", "counter");
+    append_series(out, "metrics_dropped_series", "", "", "", (double)g_dropped_series.load(std::memory_order_relaxed));
+    return out;
+}
+
+bool StatsServer::start(int port) {
+    listen_fd_ = tcp_listen_loopback(port);
+    if (listen_fd_ < 0) return false;
+
+    stop_.store(false);
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void StatsServer::stop() {
+    stop_.store(true);
+    if (thread_.joinable()) thread_.join();
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void StatsServer::run() {
+    while (!stop_.load(std::memory_order_relaxed)) {
+        // Wake up now and then to notice stop()
+        pollfd p{listen_fd_, POLLIN, 0};
+        if (::poll(&p, 1, 200) <= 0) continue;
+
+        int fd = tcp_accept(listen_fd_);
+        if (fd < 0) continue;
+
+        // Read (and ignore) the request so the client sees a clean close
+        timeval tv{0, 200 * 1000};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char req[2048];
+        (void)::recv(fd, req, sizeof(req), 0);
+
+        std::string body = snapshot();
+        char head[160];
+        int hn = std::snprintf(head, sizeof(head),
+                               "HTTP/1.0 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: %zu\r\n"
+                               "Connection: close\r\n\r\n",
+                               body.size());
+        if (write_all(fd, std::string_view(head, (size_t)hn))) write_all(fd, body);
+        ::close(fd);
+    }
+}
+
+} // namespace metrics
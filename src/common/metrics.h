@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Process-wide metrics: counters, gauges and latency histograms
+//
+// Recording never locks or allocates. Counters and histograms are kept per
+// thread (each thread only writes its own slab, with plain relaxed stores)
+// and summed when a snapshot is taken. Gauges are single atomics, last
+// write wins. Registration takes a short lock, once per series; a full
+// table drops the series and counts it in metrics_dropped_series.
+namespace metrics {
+
+constexpr uint32_t kMaxSeries = 512;      // Counters + gauges
+constexpr uint32_t kMaxHistograms = 32;
+constexpr uint32_t kHistBuckets = 48;     // Power-of-two buckets, up to ~2^47
+
+class Counter {
+public:
+    Counter() = default;
+    void inc(uint64_t n = 1) const;
+
+private:
+    friend Counter counter(const char*, const char*);
+    uint32_t id_ = kMaxSeries; // kMaxSeries = registry full, records are dropped
+};
+
+class Gauge {
+public:
+    Gauge() = default;
+    void set(double v) const;
+
+private:
+    friend Gauge gauge(const char*, const char*);
+    uint32_t id_ = kMaxSeries;
+};
+
+class Histogram {
+public:
+    Histogram() = default;
+    // One observation, typically a latency in ns
+    void record(uint64_t v) const;
+
+private:
+    friend Histogram histogram(const char*, const char*);
+    uint32_t id_ = kMaxHistograms;
+};
+
+// name is a Prometheus metric name, labels the inside of {...} without the
+// braces (e.g. "kind=\"ACK\""), or empty. Both are copied
+Counter counter(const char* name, const char* labels = "");
+Gauge gauge(const char* name, const char* labels = "");
+Histogram histogram(const char* name, const char* labels = "");
+
+// Sums every thread's slab into Prometheus text exposition format
+std::string snapshot();
+
+// Serves snapshot() over HTTP on 127.0.0.1:port from its own thread
+// Any GET gets the metrics; one request per connection
+class StatsServer {
+public:
+    ~StatsServer() { stop(); }
+
+    bool start(int port);
+    void stop();
+
+private:
+    void run();
+
+    int listen_fd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+};
+
+} // namespace metrics
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free multi-producer / single-consumer queue
+//
+// A ring of cells, each with a sequence number that says whose turn it is:
+// a producer claims a slot with one CAS on the tail and publishes by bumping
+// the cell's sequence, and the single consumer reads the head without any
+// atomic read-modify-write. Producers never wait on each other beyond a
+// retried CAS, and a full queue is reported, not waited on.
+template <class T>
+class MpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap *= 2;
+        mask_ = cap - 1;
+        cells_.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Any thread. False if the queue is full
+    bool push(const T& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // The consumer hasn't freed this cell yet
+            } else {
+                pos = tail_.load(std::memory_order_relaxed); // Lost the race, retry
+            }
+        }
+    }
+
+    // Consumer thread only. False if the queue is empty
+    bool pop(T& out) {
+        Cell& c = cells_[head_ & mask_];
+        if (c.seq.load(std::memory_order_acquire) != head_ + 1) return false;
+        out = c.value;
+        c.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        head_++;
+        return true;
+    }
+
+    // Consumer thread only
+    bool empty() const {
+        return cells_[head_ & mask_].seq.load(std::memory_order_acquire) != head_ + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+
+    // Apart, so producers hammering the tail don't slow the consumer's head
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+};
@@ -1,6 +1,9 @@
 #include "net.h"
 
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -80,36 +83,154 @@ int tcp_connect_ipv4(const char* ip, int port) {
     return fd;
 }
 
-bool read_line(int fd, std::string& out) {
-    out.clear();
-    char ch;
-    while (true) {
-        // Read until newline to get one complete message
-        ssize_t n = ::recv(fd, &ch, 1, 0);
-        if (n == 0) return false;
+bool write_all(int fd, std::string_view s) {
+    const char* p = s.data();
+    size_t left = s.size();
+    while (left > 0) {
+        // A peer that went away is an error here, not a SIGPIPE that kills the process
+        ssize_t n = ::send(fd, p, left, MSG_NOSIGNAL);
         if (n < 0) {
             if (errno == EINTR) continue;
-            std::cerr << "recv() failed: " << std::strerror(errno) << "\n";
+            std::cerr << "send() failed: " << std::strerror(errno) << "\n";
             return false;
         }
-        if (ch == '\n') break;
-        out.push_back(ch);
+        p += n;
+        left -= static_cast<size_t>(n);
     }
     return true;
 }
 
-bool write_all(int fd, const std::string& s) {
-    const char* p = s.data();
-    size_t left = s.size();
-    while (left > 0) {
-        ssize_t n = ::send(fd, p, left, 0);
+bool enable_rx_timestamps(int fd) {
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        std::cerr << "setsockopt(SO_TIMESTAMPING) failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+int udp_socket() {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::cerr << "socket() failed: " << std::strerror(errno) << "\n";
+    }
+    return fd;
+}
+
+bool udp_send_loopback(int fd, int port, std::string_view datagram) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    ssize_t n = ::sendto(fd, datagram.data(), datagram.size(), 0,
+                         reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    return n == (ssize_t)datagram.size();
+}
+
+int udp_bind_loopback(int port, int timeout_ms) {
+    int fd = udp_socket();
+    if (fd < 0) return -1;
+
+    int yes = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    // Bounded recv so the reader thread can notice a stop request
+    timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "bind() failed: " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+TcpConnection::~TcpConnection() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool TcpConnection::has_line() const {
+    return rbuf_.find('\n', rpos_) != std::string::npos;
+}
+
+bool TcpConnection::read_line(std::string& out) {
+    out.clear();
+    while (true) {
+        size_t nl = rbuf_.find('\n', rpos_);
+        if (nl != std::string::npos) {
+            out.assign(rbuf_, rpos_, nl - rpos_);
+            rpos_ = nl + 1;
+            return true;
+        }
+
+        // Drop consumed bytes only when we need to read more
+        rbuf_.erase(0, rpos_);
+        rpos_ = 0;
+
+        // Read in chunks; extra lines stay buffered for the next call.
+        // Complete lines are all returned before the next read, so every
+        // line comes out of the latest read and shares its timestamp
+        char chunk[kReadChunk];
+        alignas(cmsghdr) char ctl[CMSG_SPACE(sizeof(scm_timestamping))];
+        iovec iov{chunk, sizeof(chunk)};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctl;
+        msg.msg_controllen = sizeof(ctl);
+        ssize_t n = ::recvmsg(fd_, &msg, 0);
+        if (n == 0) return false;
         if (n < 0) {
             if (errno == EINTR) continue;
-            std::cerr << "send() failed: " << std::strerror(errno) << "\n";
+            std::cerr << "recv() failed: " << std::strerror(errno) << "\n";
             return false;
         }
-        p += n;
-        left -= static_cast<size_t>(n);
+        rbuf_.append(chunk, (size_t)n);
+
+        // Software stamp of the newest segment in the read
+        rx_wall_ns_ = 0;
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING) continue;
+            scm_timestamping ts;
+            std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            rx_wall_ns_ = (int64_t)ts.ts[0].tv_sec * 1'000'000'000 + ts.ts[0].tv_nsec;
+        }
     }
-    return true;
+}
+
+bool TcpConnection::write_all(std::string_view s) {
+    return ::write_all(fd_, s);
+}
+
+bool TcpConnection::wait_readable(int timeout_ms) {
+    if (has_line()) return true;
+
+    pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    while (true) {
+        int rc = ::poll(&pfd, 1, timeout_ms);
+        if (rc < 0 && errno == EINTR) continue;
+        // Errors count as readable so read_line reports them
+        return rc != 0;
+    }
+}
+
+std::unique_ptr<Connection> tcp_connect(const char* ip, int port) {
+    int fd = tcp_connect_ipv4(ip, port);
+    if (fd < 0) return nullptr;
+    auto conn = std::make_unique<TcpConnection>(fd);
+    conn->enable_rx_timestamps();
+    return conn;
 }
@@ -1,11 +1,81 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 
 int tcp_listen_loopback(int port);
 int tcp_accept(int listen_fd);
 int tcp_connect_ipv4(const char* ip, int port);
 
-// Reads from the socket until '\n', returns false on EOF or error
-bool read_line(int fd, std::string& out);
-bool write_all(int fd, const std::string& s);
+bool write_all(int fd, std::string_view s);
+
+// Asks the kernel for software receive timestamps (SO_TIMESTAMPING) on a
+// TCP socket; false if it refuses, reads then carry no timestamp
+bool enable_rx_timestamps(int fd);
+
+// UDP on loopback (market data). Sender is unconnected, so a missing
+// receiver never produces errors on later sends
+int udp_socket();
+bool udp_send_loopback(int fd, int port, std::string_view datagram);
+// Receiver bound to 127.0.0.1:port; recv times out after timeout_ms
+int udp_bind_loopback(int port, int timeout_ms);
+
+// Line-oriented connection to the peer, independent of the transport
+class Connection {
+public:
+    virtual ~Connection() = default;
+
+    // Reads until '\n' (returned without it), false on EOF or error
+    virtual bool read_line(std::string& out) = 0;
+    virtual bool write_all(std::string_view s) = 0;
+
+    // Pushes out writes the transport holds back to batch them (see
+    // UringConnection). Call before waiting on fd() with your own poll();
+    // wait_readable does it itself. False if the write failed
+    virtual bool flush() { return true; }
+
+    // A complete line is already buffered, read_line won't block
+    virtual bool has_line() const = 0;
+
+    // Waits up to timeout_ms (-1 = forever) until read_line can make
+    // progress (data, EOF or error). False on timeout
+    virtual bool wait_readable(int timeout_ms) = 0;
+
+    // Pollable fd, or -1 if the transport has none (shared memory)
+    virtual int fd() const = 0;
+
+    // When the kernel received the line read_line last returned
+    // (CLOCK_REALTIME ns), 0 if the transport doesn't timestamp
+    virtual int64_t rx_wall_ns() const { return 0; }
+};
+
+// TCP socket connection with a read buffer (takes ownership of fd)
+class TcpConnection : public Connection {
+public:
+    // The read buffer holds a partial line plus one read, so it is sized
+    // once here and a long run of reads never regrows it
+    explicit TcpConnection(int fd) : fd_(fd) { rbuf_.reserve(2 * kReadChunk); }
+    ~TcpConnection() override;
+
+    bool read_line(std::string& out) override;
+    bool write_all(std::string_view s) override;
+    bool has_line() const override;
+    bool wait_readable(int timeout_ms) override;
+    int fd() const override { return fd_; }
+    int64_t rx_wall_ns() const override { return rx_wall_ns_; }
+
+    // See ::enable_rx_timestamps()
+    bool enable_rx_timestamps() { return ::enable_rx_timestamps(fd_); }
+
+private:
+    static constexpr size_t kReadChunk = 4096; // Bytes asked for per recvmsg()
+
+    int fd_ = -1;
+    std::string rbuf_; // Received bytes, lines before rpos_ already returned
+    size_t rpos_ = 0;
+    int64_t rx_wall_ns_ = 0;
+};
+
+std::unique_ptr<Connection> tcp_connect(const char* ip, int port);
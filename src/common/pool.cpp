@@ -0,0 +1,31 @@
+#include "common/pool.h"
+
+BlockPool::BlockPool(size_t block_size, size_t blocks_per_chunk)
+    : block_size_(block_size), per_chunk_(blocks_per_chunk) {}
+
+void BlockPool::grow() {
+    // Thread the new chunk's blocks onto the free list, lowest address first
+    char* chunk = static_cast<char*>(::operator new(block_size_ * per_chunk_));
+    for (size_t i = per_chunk_; i-- > 0;) {
+        FreeBlock* b = reinterpret_cast<FreeBlock*>(chunk + i * block_size_);
+        b->next = free_;
+        free_ = b;
+    }
+    chunks_++;
+}
+
+void* BlockPool::alloc() {
+    if (!free_) grow();
+    FreeBlock* b = free_;
+    free_ = b->next;
+    in_use_++;
+    return b;
+}
+
+void BlockPool::free(void* p) {
+    if (!p) return;
+    FreeBlock* b = static_cast<FreeBlock*>(p);
+    b->next = free_;
+    free_ = b;
+    in_use_--;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+// Fixed-size block pool: blocks are carved out of large chunks and freed
+// blocks go on an intrusive free list, so once a pool has grown to its
+// working set, alloc/free never touch the heap. Chunks are never returned:
+// a pool only grows, and its memory lives until the process exits.
+class BlockPool {
+public:
+    BlockPool(size_t block_size, size_t blocks_per_chunk);
+
+    void* alloc();
+    void free(void* p);
+
+    size_t block_size() const { return block_size_; }
+    size_t chunks() const { return chunks_; }
+    size_t in_use() const { return in_use_; }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    void grow();
+
+    size_t block_size_;
+    size_t per_chunk_;
+    FreeBlock* free_ = nullptr;
+    size_t chunks_ = 0;
+    size_t in_use_ = 0;
+};
+
+// std allocator over one BlockPool per node type and thread
+//
+// Node containers (unordered_map/set, list, map) allocate one node at a
+// time, which comes from the pool; anything bigger (bucket arrays) goes to
+// the heap as usual, and is rare once a container is reserved. The pools
+// are thread_local, so a container must be used (and destroyed) on the
+// thread that filled it, which is how every OMS structure is owned.
+template <class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    static constexpr size_t kBlocksPerChunk = 4096;
+
+    PoolAllocator() noexcept = default;
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n == 1) return static_cast<T*>(pool().alloc());
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (n == 1) pool().free(p);
+        else ::operator delete(p);
+    }
+
+    // The pool every PoolAllocator<T> on this thread shares
+    static BlockPool& pool() {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not pooled");
+        // Intentionally leaked: nodes may outlive thread_local destruction
+        thread_local BlockPool* p = new BlockPool(block_size(), kBlocksPerChunk);
+        return *p;
+    }
+
+private:
+    // Room for the free list link, rounded up so every block stays aligned
+    static constexpr size_t block_size() {
+        size_t s = sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+        size_t a = alignof(T) < alignof(void*) ? alignof(void*) : alignof(T);
+        return (s + a - 1) / a * a;
+    }
+};
+
+template <class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return true; }
+template <class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return false; }
+
+// Hash containers with pooled nodes
+template <class K, class V>
+using PooledMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, PoolAllocator<std::pair<const K, V>>>;
+template <class K>
+using PooledSet = std::unordered_set<K, std::hash<K>, std::equal_to<K>, PoolAllocator<K>>;
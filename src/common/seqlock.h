@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// One writer, any number of readers that never block it
+//
+// The writer makes the sequence odd, stores the value, and makes it even
+// again; a reader copies the value out and keeps it only if the sequence
+// was the same even number before and after. The value is kept as atomic
+// words so a torn read is merely discarded, not a data race, and so the
+// whole thing can live in memory shared between processes.
+template <class T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock copies T as raw words");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm seqlocks need address-free atomics");
+
+public:
+    // Writer only (one thread at a time)
+    void store(const T& v) {
+        uint64_t w[kWords] = {};
+        std::memcpy(w, &v, sizeof(T));
+        const uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) words_[i].store(w[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // A consistent copy, or false after `tries` attempts that all overlapped
+    // a store (a writer that died mid-store leaves the sequence odd for good)
+    bool load(T& out, int tries = 1000) const {
+        uint64_t w[kWords];
+        for (int t = 0; t < tries; t++) {
+            const uint64_t s0 = seq_.load(std::memory_order_acquire);
+            if (s0 & 1) {
+                relax();
+                continue;
+            }
+            for (size_t i = 0; i < kWords; i++) w[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s0) {
+                std::memcpy(&out, w, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stores so far (0 = never written)
+    uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    static void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> words_[kWords] = {};
+};
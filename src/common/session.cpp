@@ -0,0 +1,254 @@
+#include "common/session.h"
+#include "common/clock.h"
+#include "common/codec.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Session control lines, encoded with the same codec as the protocol
+struct Ctl {
+    uint64_t a = 0;
+    uint64_t b = 0;
+};
+
+struct LogonSchema {
+    static constexpr std::string_view tag = "LOGON";
+    using fields = codec::FieldList<codec::Field<&Ctl::a>, codec::Field<&Ctl::b>>;
+};
+
+template <const std::string_view& Tag>
+struct OneSeqSchema {
+    static constexpr std::string_view tag = Tag;
+    using fields = codec::FieldList<codec::Field<&Ctl::a>>;
+};
+
+constexpr std::string_view kHeartbeat = "HEARTBEAT";
+constexpr std::string_view kResend = "RESEND";
+constexpr std::string_view kSeqReset = "SEQ_RESET";
+
+using HeartbeatSchema = OneSeqSchema<kHeartbeat>;
+using ResendSchema = OneSeqSchema<kResend>;
+using SeqResetSchema = OneSeqSchema<kSeqReset>;
+
+// One encoded control line on the stack
+template <class Schema>
+struct CtlLine {
+    char buf[64];
+    size_t len;
+
+    explicit CtlLine(uint64_t a, uint64_t b = 0) {
+        Ctl c;
+        c.a = a;
+        c.b = b;
+        len = codec::encode<Schema>(c, buf, sizeof(buf));
+    }
+
+    std::string_view view() const { return std::string_view(buf, len); }
+};
+
+} // namespace
+
+Session::Session(const Options& opts) : opts_(opts), ring_(opts.resend_capacity) {
+    // Unique enough across restarts on one host
+    session_id_ = ((uint64_t)mono_ns() ^ ((uint64_t)::getpid() << 40)) | 1;
+}
+
+void Session::attach(std::unique_ptr<Connection> conn) {
+    conn_ = std::move(conn);
+    sent_logon_ = false;
+    logged_on_ = false;
+    resend_requested_ = false;
+    unwritten_ = next_out_;
+    last_send_ns_ = last_recv_ns_ = mono_ns();
+}
+
+void Session::detach() {
+    conn_.reset();
+    logged_on_ = false;
+}
+
+bool Session::write_raw(std::string_view s) {
+    if (!conn_) return false;
+    last_send_ns_ = mono_ns();
+    return conn_->write_all(s);
+}
+
+bool Session::logon() {
+    sent_logon_ = true;
+    return write_raw(CtlLine<LogonSchema>(session_id_, next_in_).view());
+}
+
+bool Session::send(std::string_view lines) {
+    wbuf_.clear();
+    while (!lines.empty()) {
+        size_t nl = lines.find('\n');
+        std::string_view line = lines.substr(0, nl == std::string_view::npos ? lines.size() : nl + 1);
+        lines.remove_prefix(line.size());
+        if (line.back() != '\n') continue; // Not a complete line
+
+        Slot& s = ring_[next_out_ % ring_.size()];
+        char* end = s.data + sizeof(s.data);
+        char* p = codec::put(s.data, end, next_out_);
+        if (p) p = codec::put(p, end, ' ');
+        if (p) p = codec::put(p, end, line);
+        if (!p) {
+            std::cerr << opts_.name << ": session line too long, not sent\n";
+            continue;
+        }
+
+        s.seq = next_out_++;
+        s.len = (uint16_t)(p - s.data);
+        wbuf_.append(s.data, s.len);
+    }
+
+    // Before LOGON the peer's position is unknown; the replay on LOGON sends these
+    if (!logged_on_ || wbuf_.empty()) return true;
+    unwritten_ = next_out_;
+    return write_raw(wbuf_);
+}
+
+bool Session::resend_from(uint64_t seq) {
+    if (seq >= next_out_) return true;
+
+    const uint64_t cap = ring_.size();
+    uint64_t oldest = (next_out_ > cap) ? next_out_ - cap : 1;
+    if (seq < oldest) {
+        std::cerr << opts_.name << ": session cannot resend " << seq << ".." << (oldest - 1)
+                  << ", no longer buffered\n";
+        if (!write_raw(CtlLine<SeqResetSchema>(oldest).view())) return false;
+        seq = oldest;
+    }
+
+    wbuf_.clear();
+    for (uint64_t s = seq; s < next_out_; s++) {
+        const Slot& slot = ring_[s % cap];
+        if (slot.seq != s) continue; // Was too long to buffer
+        wbuf_.append(slot.data, slot.len);
+    }
+
+    // Lines held back until LOGON go out here too; only count real repeats
+    if (seq < unwritten_) {
+        uint64_t last = std::min(unwritten_, next_out_) - 1;
+        resent_ += last - seq + 1;
+        std::cerr << opts_.name << ": session resending " << seq << ".." << last << "\n";
+    }
+    unwritten_ = next_out_;
+    return write_raw(wbuf_);
+}
+
+void Session::reset_sequences() {
+    next_out_ = 1;
+    unwritten_ = 1;
+    next_in_ = 1;
+    resend_requested_ = false;
+    for (Slot& s : ring_) s.seq = 0;
+}
+
+Session::ReadResult Session::on_control(std::string_view tag, std::string_view rest) {
+    Ctl c;
+
+    if (tag == LogonSchema::tag && codec::decode<LogonSchema>(c, rest)) {
+        uint64_t peer = c.a;
+        uint64_t peer_next_in = c.b;
+
+        bool reset = (peer_session_ != 0 && peer != peer_session_);
+        if (reset) {
+            std::cerr << opts_.name << ": session peer restarted, sequence numbers reset\n";
+            reset_sequences();
+            peer_next_in = 1;
+        }
+        peer_session_ = peer;
+
+        if (!sent_logon_) logon();
+        logged_on_ = true;
+        resend_from(peer_next_in);
+        return reset ? ReadResult::Reset : ReadResult::Control;
+    }
+
+    if (tag == kHeartbeat && codec::decode<HeartbeatSchema>(c, rest)) {
+        // Peer has sent more than we've seen: the tail of the stream got lost
+        if (c.a >= next_in_ && !resend_requested_) {
+            gaps_++;
+            resend_requested_ = true;
+            write_raw(CtlLine<ResendSchema>(next_in_).view());
+        }
+        return ReadResult::Control;
+    }
+
+    if (tag == kResend && codec::decode<ResendSchema>(c, rest)) {
+        resend_from(c.a);
+        return ReadResult::Control;
+    }
+
+    if (tag == kSeqReset && codec::decode<SeqResetSchema>(c, rest)) {
+        if (c.a > next_in_) {
+            std::cerr << opts_.name << ": session lost " << (c.a - next_in_) << " line(s) "
+                      << next_in_ << ".." << (c.a - 1) << "\n";
+            next_in_ = c.a;
+        }
+        return ReadResult::Control;
+    }
+
+    std::cerr << opts_.name << ": session bad control line: " << tag << rest << "\n";
+    return ReadResult::Control;
+}
+
+Session::ReadResult Session::read(std::string& out) {
+    if (!conn_ || !conn_->read_line(out)) return ReadResult::Closed;
+    last_recv_ns_ = mono_ns();
+
+    std::string_view line(out);
+    std::string_view first = codec::next_token(line);
+
+    uint64_t seq = 0;
+    if (!codec::get(first, seq)) return on_control(first, line);
+
+    if (seq < next_in_) {
+        dups_++;
+        return ReadResult::Control;
+    }
+    if (seq > next_in_) {
+        // Go-back-N: drop it, the replay from next_in_ includes it again
+        if (!resend_requested_) {
+            gaps_++;
+            resend_requested_ = true;
+            std::cerr << opts_.name << ": session gap expected=" << next_in_ << " got=" << seq
+                      << ", requesting resend\n";
+            write_raw(CtlLine<ResendSchema>(next_in_).view());
+        }
+        return ReadResult::Control;
+    }
+
+    next_in_++;
+    resend_requested_ = false;
+
+    // Strip "<seq> " in place
+    size_t skip = first.size() + 1;
+    out.erase(0, skip <= out.size() ? skip : out.size());
+    return ReadResult::Data;
+}
+
+bool Session::on_timer(int64_t now_ns) {
+    if (!conn_) return true;
+
+    if (logged_on_ && now_ns - last_send_ns_ >= (int64_t)opts_.heartbeat_ms * 1'000'000) {
+        write_raw(CtlLine<HeartbeatSchema>(next_out_ - 1).view());
+    }
+    return now_ns - last_recv_ns_ <= (int64_t)opts_.timeout_ms * 1'000'000;
+}
+
+int Session::timer_ms(int64_t now_ns) const {
+    if (!conn_) return -1;
+
+    int64_t due = last_recv_ns_ + (int64_t)opts_.timeout_ms * 1'000'000;
+    if (logged_on_) {
+        int64_t hb = last_send_ns_ + (int64_t)opts_.heartbeat_ms * 1'000'000;
+        if (hb < due) due = hb;
+    }
+    int64_t ms = (due - now_ns + 999'999) / 1'000'000;
+    return ms < 0 ? 0 : (int)ms;
+}
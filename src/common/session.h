@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/net.h"
+
+// Sequenced session under the line protocol
+//
+// Every application line goes out as "<seq> <line>", seq counting up from 1
+// per direction. Session control lines are unsequenced:
+//
+//   LOGON <session_id> <next_expected>   both ways, right after connecting
+//   HEARTBEAT <last_sent_seq>            when idle; also reveals a lost tail
+//   RESEND <from_seq>                    gap seen: resend from_seq onwards
+//   SEQ_RESET <seq>                      from_seq is no longer buffered
+//
+// Each side keeps its recently sent lines in a fixed ring. On LOGON (a
+// reconnect) and on RESEND the peer's missing lines are replayed from it,
+// so the receiver only sees what it missed. Lines at or below what was
+// already delivered are dropped as duplicates; a line past a gap is dropped
+// and a resend requested (go-back-N: the replay includes it again).
+//
+// A LOGON with a different session_id means the peer restarted: sequence
+// numbers start over and the buffer is cleared.
+class Session {
+public:
+    struct Options {
+        const char* name = "session"; // Log prefix
+        int heartbeat_ms = 1000;       // Idle time before a HEARTBEAT
+        int timeout_ms = 3500;         // Silence before the peer counts as gone
+        size_t resend_capacity = 16384; // Lines kept for replay (~300 bytes each)
+    };
+
+    enum class ReadResult {
+        Data,    // out holds one application line (without seq or '\n')
+        Control, // Session-level line handled internally, nothing for the caller
+        Reset,   // Peer started a new session; its old state is gone
+        Closed   // EOF or error on the connection
+    };
+
+    explicit Session(const Options& opts);
+
+    // Takes over a freshly connected transport (first connect or reconnect)
+    // Sequence numbers and the resend buffer carry over
+    void attach(std::unique_ptr<Connection> conn);
+    // Drops the transport, keeping all sequence state
+    void detach();
+    Connection* connection() const { return conn_.get(); }
+
+    // Connecting side: announces itself; the peer answers with its own LOGON
+    // and both replay what the other is missing
+    bool logon();
+    bool logged_on() const { return logged_on_; }
+
+    // Sequences and sends one or more '\n'-terminated lines in one write
+    // Lines are buffered for resend even when they can't be written yet
+    // (before LOGON, or while detached) and go out on the next LOGON.
+    // False only if a write on the live connection failed
+    bool send(std::string_view lines);
+
+    ReadResult read(std::string& out);
+
+    // Timers: heartbeats out, peer timeout in. Returns false if the peer has
+    // been silent for longer than timeout_ms
+    bool on_timer(int64_t now_ns);
+    // How long the caller may block before on_timer is due again
+    int timer_ms(int64_t now_ns) const;
+
+    uint64_t session_id() const { return session_id_; }
+    uint64_t next_out_seq() const { return next_out_; }
+    uint64_t next_in_seq() const { return next_in_; }
+
+    uint64_t resent() const { return resent_; }   // Lines replayed to the peer
+    uint64_t gaps() const { return gaps_; }       // Gaps seen on input
+    uint64_t dup_drops() const { return dups_; }  // Duplicate lines dropped
+
+private:
+    struct Slot {
+        uint64_t seq = 0; // 0 = empty
+        uint16_t len = 0;
+        char data[288];   // "<seq> " + one protocol line
+    };
+
+    bool write_raw(std::string_view s);
+    // Replays every buffered line from seq onwards. Asks the peer to skip
+    // ahead first if seq has already fallen out of the ring
+    bool resend_from(uint64_t seq);
+    void reset_sequences();
+    ReadResult on_control(std::string_view tag, std::string_view rest);
+
+    Options opts_;
+    std::unique_ptr<Connection> conn_;
+
+    uint64_t session_id_ = 0;      // Ours
+    uint64_t peer_session_ = 0;    // 0 until the first LOGON from the peer
+    bool sent_logon_ = false;      // On this connection
+    bool logged_on_ = false;       // LOGON exchanged on this connection
+
+    uint64_t next_out_ = 1;
+    uint64_t next_in_ = 1;
+    bool resend_requested_ = false; // Until the gap closes
+    uint64_t unwritten_ = 1;        // First seq not yet written on this connection
+
+    std::vector<Slot> ring_;        // Indexed by seq % capacity
+    std::string wbuf_;              // Reused for batched sends
+
+    int64_t last_send_ns_ = 0;
+    int64_t last_recv_ns_ = 0;
+
+    uint64_t resent_ = 0;
+    uint64_t gaps_ = 0;
+    uint64_t dups_ = 0;
+};
@@ -0,0 +1,286 @@
+#include "common/shm_transport.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4f4d5331; // "OMS1"
+constexpr size_t kRingBytes = 1 << 20;  // Per direction, power of two
+constexpr int kFutexSpins = 500;        // Spin this long before sleeping
+
+// Single-producer single-consumer byte ring. head/tail count bytes ever
+// written/read, so head - tail is the fill level and never wraps in practice.
+struct Ring {
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    // Futex word: bumped after every write so a sleeping reader sees a change
+    alignas(64) std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> sleeping{0};
+    alignas(64) char data[kRingBytes];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm rings need address-free atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm rings need address-free atomics");
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+long futex(std::atomic<uint32_t>* addr, int op, uint32_t val, const timespec* ts) {
+    // Shared (not PRIVATE) futex: the word lives in memory mapped by two processes
+    return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), op, val, ts, nullptr, 0);
+}
+
+void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected, int timeout_ms) {
+    timespec ts;
+    timespec* tsp = nullptr;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+    futex(addr, FUTEX_WAIT, expected, tsp);
+}
+
+void futex_wake(std::atomic<uint32_t>* addr) {
+    futex(addr, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+// Called by the writer after publishing head
+void notify(Ring& r) {
+    r.seq.fetch_add(1);
+    if (r.sleeping.load()) futex_wake(&r.seq);
+}
+
+} // namespace
+
+struct ShmSegment {
+    std::atomic<uint32_t> magic{0};
+    std::atomic<uint32_t> attached{0}; // Futex word, set once the OMS maps in
+    std::atomic<uint32_t> closed[2] = {{0}, {0}}; // [0] venue, [1] oms
+    Ring to_venue;
+    Ring to_oms;
+};
+
+ShmConnection::ShmConnection(ShmSegment* seg, bool is_venue, ShmWait wait, const std::string& unlink_name)
+    : seg_(seg), is_venue_(is_venue), wait_(wait), unlink_name_(unlink_name) {}
+
+ShmConnection::~ShmConnection() {
+    if (!seg_) return;
+
+    seg_->closed[is_venue_ ? 0 : 1].store(1);
+    // Wake the peer so a blocked read sees EOF
+    notify(is_venue_ ? seg_->to_oms : seg_->to_venue);
+
+    ::munmap(seg_, sizeof(ShmSegment));
+    if (!unlink_name_.empty()) ::shm_unlink(unlink_name_.c_str());
+}
+
+bool ShmConnection::peer_closed() const {
+    return seg_->closed[is_venue_ ? 1 : 0].load(std::memory_order_acquire) != 0;
+}
+
+bool ShmConnection::has_line() const {
+    return rbuf_.find('\n', rpos_) != std::string::npos;
+}
+
+size_t ShmConnection::drain() {
+    Ring& r = is_venue_ ? seg_->to_venue : seg_->to_oms;
+
+    uint64_t tail = r.tail.load(std::memory_order_relaxed);
+    uint64_t head = r.head.load(std::memory_order_acquire);
+    size_t n = (size_t)(head - tail);
+    if (n == 0) return 0;
+
+    rbuf_.erase(0, rpos_);
+    rpos_ = 0;
+
+    size_t pos = (size_t)(tail & (kRingBytes - 1));
+    size_t first = std::min(n, kRingBytes - pos);
+    rbuf_.append(r.data + pos, first);
+    rbuf_.append(r.data, n - first);
+
+    r.tail.store(head, std::memory_order_release);
+    return n;
+}
+
+bool ShmConnection::read_line(std::string& out) {
+    out.clear();
+    while (true) {
+        size_t nl = rbuf_.find('\n', rpos_);
+        if (nl != std::string::npos) {
+            out.assign(rbuf_, rpos_, nl - rpos_);
+            rpos_ = nl + 1;
+            return true;
+        }
+
+        if (drain() > 0) continue;
+        // Peer may have written its last bytes just before closing
+        if (peer_closed()) {
+            if (drain() > 0) continue;
+            return false;
+        }
+        wait_readable(-1);
+    }
+}
+
+bool ShmConnection::write_all(std::string_view s) {
+    Ring& r = is_venue_ ? seg_->to_oms : seg_->to_venue;
+
+    size_t off = 0;
+    int spins = 0;
+    while (off < s.size()) {
+        if (peer_closed()) return false;
+
+        uint64_t head = r.head.load(std::memory_order_relaxed);
+        uint64_t tail = r.tail.load(std::memory_order_acquire);
+        size_t space = kRingBytes - (size_t)(head - tail);
+        if (space == 0) {
+            // Ring full: the reader doesn't signal us, so back off politely
+            if (++spins % 64 == 0) sched_yield();
+            else cpu_relax();
+            continue;
+        }
+
+        size_t n = std::min(space, s.size() - off);
+        size_t pos = (size_t)(head & (kRingBytes - 1));
+        size_t first = std::min(n, kRingBytes - pos);
+        std::memcpy(r.data + pos, s.data() + off, first);
+        std::memcpy(r.data, s.data() + off + first, n - first);
+
+        r.head.store(head + n, std::memory_order_release);
+        notify(r);
+        off += n;
+    }
+    return true;
+}
+
+bool ShmConnection::wait_readable(int timeout_ms) {
+    if (has_line()) return true;
+
+    Ring& r = is_venue_ ? seg_->to_venue : seg_->to_oms;
+    auto ready = [&] {
+        return r.head.load(std::memory_order_acquire) != r.tail.load(std::memory_order_relaxed)
+            || peer_closed();
+    };
+
+    using Clock = std::chrono::steady_clock;
+    const bool forever = timeout_ms < 0;
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(forever ? 0 : timeout_ms);
+
+    // Spin phase (the whole wait in Spin mode). On a single core spinning
+    // only delays the writer, so futex mode goes straight to sleep there
+    static const int futex_spins = (std::thread::hardware_concurrency() > 1) ? kFutexSpins : 0;
+    for (long i = 0; wait_ == ShmWait::Spin || i < futex_spins; i++) {
+        if (ready()) return true;
+        cpu_relax();
+        if ((i & 63) == 63) {
+            if (!forever && Clock::now() >= deadline) return false;
+            // Keeps an oversubscribed box (fewer cores than spinners) moving
+            if (wait_ == ShmWait::Spin) sched_yield();
+        }
+    }
+
+    while (true) {
+        int left_ms = -1;
+        if (!forever) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+            if (left.count() <= 0) return ready();
+            left_ms = (int)left.count();
+        }
+
+        // Announce we're sleeping, then re-check so a write in between isn't missed
+        r.sleeping.store(1);
+        uint32_t seen = r.seq.load();
+        if (ready()) {
+            r.sleeping.store(0);
+            return true;
+        }
+        futex_wait(&r.seq, seen, left_ms);
+        r.sleeping.store(0);
+
+        if (ready()) return true;
+    }
+}
+
+std::unique_ptr<Connection> shm_accept(const char* name, ShmWait wait) {
+    // Start from a fresh zeroed segment even if a previous run left one behind
+    ::shm_unlink(name);
+    int fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    if (::ftruncate(fd, sizeof(ShmSegment)) < 0) {
+        std::cerr << "ftruncate() failed: " << std::strerror(errno) << "\n";
+        ::close(fd);
+        ::shm_unlink(name);
+        return nullptr;
+    }
+
+    void* mem = ::mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "mmap() failed: " << std::strerror(errno) << "\n";
+        ::shm_unlink(name);
+        return nullptr;
+    }
+
+    ShmSegment* seg = new (mem) ShmSegment();
+    seg->magic.store(kMagic, std::memory_order_release);
+
+    // Block until the OMS maps the segment in
+    while (seg->attached.load() == 0) futex_wait(&seg->attached, 0, -1);
+
+    return std::unique_ptr<Connection>(new ShmConnection(seg, true, wait, name));
+}
+
+std::unique_ptr<Connection> shm_connect(const char* name, ShmWait wait) {
+    int fd = ::shm_open(name, O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+
+    void* mem = ::mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "mmap() failed: " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+
+    ShmSegment* seg = static_cast<ShmSegment*>(mem);
+
+    // The venue may still be initializing the segment
+    for (int i = 0; seg->magic.load(std::memory_order_acquire) != kMagic; i++) {
+        if (i == 1000) {
+            std::cerr << "shm segment " << name << " not initialized\n";
+            ::munmap(mem, sizeof(ShmSegment));
+            return nullptr;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    seg->attached.store(1);
+    futex_wake(&seg->attached);
+
+    return std::unique_ptr<Connection>(new ShmConnection(seg, false, wait, ""));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "common/net.h"
+
+// Same-host transport: two lock-free SPSC byte rings in a /dev/shm segment
+// (one per direction). The venue creates the segment, the OMS attaches.
+// Carries the same line protocol as TCP, behind the Connection interface.
+
+constexpr const char* kDefaultShmName = "/mini_oms_venue";
+
+// How a reader waits for data
+enum class ShmWait {
+    Futex, // Spin briefly, then sleep on a futex the writer wakes
+    Spin   // Busy-spin only (lowest latency, burns a core)
+};
+
+struct ShmSegment;
+
+class ShmConnection : public Connection {
+public:
+    ~ShmConnection() override;
+
+    bool read_line(std::string& out) override;
+    bool write_all(std::string_view s) override;
+    bool has_line() const override;
+    bool wait_readable(int timeout_ms) override;
+    int fd() const override { return -1; }
+
+private:
+    friend std::unique_ptr<Connection> shm_accept(const char* name, ShmWait wait);
+    friend std::unique_ptr<Connection> shm_connect(const char* name, ShmWait wait);
+
+    ShmConnection(ShmSegment* seg, bool is_venue, ShmWait wait, const std::string& unlink_name);
+
+    // Moves whatever the peer has written into rbuf_. Returns bytes moved
+    size_t drain();
+    bool peer_closed() const;
+
+    ShmSegment* seg_ = nullptr;
+    bool is_venue_ = false;
+    ShmWait wait_ = ShmWait::Futex;
+    std::string unlink_name_; // Set on the creating side
+
+    std::string rbuf_;
+    size_t rpos_ = 0;
+};
+
+// Venue side: creates (or resets) the segment and blocks until the OMS attaches
+std::unique_ptr<Connection> shm_accept(const char* name, ShmWait wait);
+
+// OMS side: attaches to a segment created by shm_accept
+std::unique_ptr<Connection> shm_connect(const char* name, ShmWait wait);
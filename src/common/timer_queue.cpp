@@ -0,0 +1,27 @@
+#include "common/timer_queue.h"
+
+#include <algorithm>
+
+// std heaps are max-heaps; order by "later" to keep the earliest on top
+static bool later(const TimerQueue::Timer& a, const TimerQueue::Timer& b) {
+    return a.due_ns > b.due_ns;
+}
+
+void TimerQueue::schedule(int64_t due_ns, int key, uint32_t gen) {
+    heap_.push_back({due_ns, key, gen});
+    std::push_heap(heap_.begin(), heap_.end(), later);
+}
+
+bool TimerQueue::pop_due(int64_t now_ns, Timer& out) {
+    if (heap_.empty() || heap_.front().due_ns > now_ns) return false;
+    std::pop_heap(heap_.begin(), heap_.end(), later);
+    out = heap_.back();
+    heap_.pop_back();
+    return true;
+}
+
+int TimerQueue::wait_ms(int64_t now_ns) const {
+    if (heap_.empty()) return -1;
+    int64_t due = heap_.front().due_ns;
+    return (due <= now_ns) ? 0 : (int)((due - now_ns + 999'999) / 1'000'000);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deadlines for a poll loop, kept in a binary min-heap
+// Timers are never removed when their owner cancels or reschedules: each
+// carries the owner's generation from when it was set, and the owner skips
+// stale ones as they pop. Schedule and pop are O(log n), and nothing is
+// scanned, however many timers are pending.
+class TimerQueue {
+public:
+    struct Timer {
+        int64_t due_ns = 0;
+        int key = 0;      // Owner, e.g. a parent client_id
+        uint32_t gen = 0; // Owner's generation when scheduled
+    };
+
+    void schedule(int64_t due_ns, int key, uint32_t gen);
+
+    // Pops the earliest timer if it is due by now_ns
+    bool pop_due(int64_t now_ns, Timer& out);
+
+    // ms until the earliest timer (rounded up), -1 if there is none
+    int wait_ms(int64_t now_ns) const;
+
+    size_t size() const { return heap_.size(); }
+
+private:
+    std::vector<Timer> heap_;
+};
@@ -0,0 +1,70 @@
+#include "common/transport.h"
+
+#include "common/uring_transport.h"
+
+#include <iostream>
+
+static bool take_value(const std::string& arg, const char* prefix, std::string& value) {
+    std::string p(prefix);
+    if (arg.compare(0, p.size(), p) != 0) return false;
+    value = arg.substr(p.size());
+    return true;
+}
+
+bool parse_transport_arg(const std::string& arg, TransportOptions& opts, bool& ok) {
+    std::string v;
+
+    if (take_value(arg, "--transport=", v)) {
+        if (v == "tcp") opts.kind = TransportKind::Tcp;
+        else if (v == "shm") opts.kind = TransportKind::Shm;
+        else ok = false;
+        return true;
+    }
+
+    if (take_value(arg, "--shm-wait=", v)) {
+        if (v == "futex") opts.shm_wait = ShmWait::Futex;
+        else if (v == "spin") opts.shm_wait = ShmWait::Spin;
+        else ok = false;
+        return true;
+    }
+
+    if (take_value(arg, "--shm-name=", v)) {
+        // shm_open names must start with '/'
+        if (v.empty() || v[0] != '/') ok = false;
+        else opts.shm_name = v;
+        return true;
+    }
+
+    if (take_value(arg, "--net=", v)) {
+        if (v == "poll") opts.net = NetBackend::Poll;
+        else if (v == "uring") opts.net = NetBackend::Uring;
+        else ok = false;
+        return true;
+    }
+
+    return false;
+}
+
+const char* to_string(TransportKind k) {
+    return (k == TransportKind::Shm) ? "shm" : "tcp";
+}
+
+const char* to_string(NetBackend b) {
+    return (b == NetBackend::Uring) ? "uring" : "poll";
+}
+
+std::unique_ptr<Connection> tcp_connection(int fd, NetBackend net) {
+    if (net == NetBackend::Uring) {
+        if (std::unique_ptr<UringConnection> c = uring_connection(fd)) return c;
+        std::cerr << "io_uring unavailable, using poll\n";
+    }
+    return std::make_unique<TcpConnection>(fd);
+}
+
+std::unique_ptr<Connection> connect_transport(const TransportOptions& opts, const char* ip, int port) {
+    if (opts.kind == TransportKind::Shm) return shm_connect(opts.shm_name.c_str(), opts.shm_wait);
+    int fd = tcp_connect_ipv4(ip, port);
+    if (fd < 0) return nullptr;
+    enable_rx_timestamps(fd);
+    return tcp_connection(fd, opts.net);
+}
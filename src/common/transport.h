@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "common/net.h"
+#include "common/shm_transport.h"
+
+// Startup choice of how oms and venue_sim talk to each other
+enum class TransportKind { Tcp, Shm };
+
+// How a TCP connection waits and does its I/O; see common/uring_transport.h
+enum class NetBackend {
+    Poll, // poll(), recvmsg(), send() per write
+    Uring // io_uring, falling back to Poll where the kernel won't have it
+};
+
+struct TransportOptions {
+    TransportKind kind = TransportKind::Tcp;
+    ShmWait shm_wait = ShmWait::Futex;
+    std::string shm_name = kDefaultShmName;
+    NetBackend net = NetBackend::Poll;
+};
+
+// Consumes --transport=tcp|shm, --shm-wait=futex|spin, --shm-name=<name>,
+// --net=poll|uring
+// Returns false if arg isn't one of ours; sets ok=false on a bad value
+bool parse_transport_arg(const std::string& arg, TransportOptions& opts, bool& ok);
+
+const char* to_string(TransportKind k);
+const char* to_string(NetBackend b);
+
+// Wraps a connected TCP socket (taking ownership) in the chosen backend
+std::unique_ptr<Connection> tcp_connection(int fd, NetBackend net);
+
+// OMS side: TCP connect to ip:port, or attach to the shm segment
+std::unique_ptr<Connection> connect_transport(const TransportOptions& opts, const char* ip, int port);
@@ -0,0 +1,415 @@
+#include "common/uring_transport.h"
+
+#include <linux/errqueue.h>
+#include <linux/io_uring.h>
+#include <linux/net_tstamp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr unsigned kSqEntries = 8;   // A receive to re-arm and a send, at most
+constexpr unsigned kBufs = 64;       // Receive buffers in the ring, power of two
+constexpr unsigned kBufSize = 4096;  // Header, control and payload of one receive
+constexpr uint16_t kBufGroup = 0;
+// Every receive completion holds a buffer until reaped, so completions
+// can't outnumber buffers plus the odd send: the CQ never overflows
+constexpr unsigned kCqEntries = 2 * kBufs;
+constexpr size_t kCtlLen = CMSG_SPACE(sizeof(scm_timestamping));
+
+constexpr uint64_t kRecvTag = 1;
+constexpr uint64_t kSendTag = 2;
+
+inline unsigned load_acquire(const unsigned* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+inline void store_release(unsigned* p, unsigned v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+} // namespace
+
+// The rings mapped from the kernel, plus the registered receive buffers
+struct UringRing {
+    int fd = -1;
+
+    void* sq_mem = MAP_FAILED; // Both rings, one mapping
+    size_t sq_len = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_len = 0;
+
+    unsigned* sq_head = nullptr; // Written by the kernel
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    unsigned sq_local_tail = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr; // Written by the kernel
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    void* buf_mem = MAP_FAILED;   // kBufs buffers of kBufSize
+    io_uring_buf* br = static_cast<io_uring_buf*>(MAP_FAILED); // Page-aligned ring of them
+    uint16_t br_tail = 0;
+
+    msghdr msg{};      // Shape of every receive; the kernel reads it once per arm
+    bool armed = false; // A multishot receive is live
+
+    // One send in flight, from its own buffer so writes can queue behind it
+    std::string sending;
+    size_t send_off = 0;      // Bytes of it the kernel has taken
+    bool send_pending = false;
+    bool send_failed = false; // For good: the stream has a hole in it
+
+    ~UringRing() {
+        if (fd >= 0) ::close(fd);
+        if (br != MAP_FAILED) ::munmap(br, kBufs * sizeof(io_uring_buf));
+        if (buf_mem != MAP_FAILED) ::munmap(buf_mem, (size_t)kBufs * kBufSize);
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqes_len);
+        if (sq_mem != MAP_FAILED) ::munmap(sq_mem, sq_len);
+    }
+
+    bool open();
+
+    char* buf(unsigned bid) { return static_cast<char*>(buf_mem) + (size_t)bid * kBufSize; }
+
+    // Hands a buffer back to the kernel for later receives
+    void recycle(uint16_t bid) {
+        io_uring_buf& b = br[br_tail & (kBufs - 1)];
+        b.addr = reinterpret_cast<uint64_t>(buf(bid));
+        b.len = kBufSize;
+        b.bid = bid;
+        br_tail++;
+        // The ring's tail overlays the reserved field of its first entry
+        __atomic_store_n(&br[0].resv, br_tail, __ATOMIC_RELEASE);
+    }
+
+    io_uring_sqe* next_sqe() {
+        const unsigned idx = sq_local_tail & sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[idx] = idx;
+        sq_local_tail++;
+        store_release(sq_tail, sq_local_tail);
+        return sqe;
+    }
+
+    void prep_recv(int sock) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = sock;
+        sqe->addr = reinterpret_cast<uint64_t>(&msg);
+        sqe->len = 1;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufGroup;
+        sqe->user_data = kRecvTag;
+        armed = true;
+    }
+
+    // The rest of `sending`
+    void prep_send(int sock) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = sock;
+        sqe->addr = reinterpret_cast<uint64_t>(sending.data() + send_off);
+        sqe->len = (uint32_t)(sending.size() - send_off);
+        sqe->msg_flags = MSG_NOSIGNAL; // EPIPE in the CQE, not a SIGPIPE
+        sqe->user_data = kSendTag;
+        send_pending = true;
+    }
+
+    bool cq_empty() const { return *cq_head == load_acquire(cq_tail); }
+
+    // Submits what's queued and waits for min_complete completions, at most
+    // timeout_ms (-1 = forever). 0, or -errno (-ETIME on timeout)
+    int enter(unsigned min_complete, int timeout_ms) {
+        const unsigned to_submit = sq_local_tail - load_acquire(sq_head);
+        unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        const void* argp = nullptr;
+        size_t argsz = 0;
+        if (min_complete > 0 && timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL;
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            argp = &arg;
+            argsz = sizeof(arg);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+        long rc = ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, argp, argsz);
+        return rc < 0 ? -errno : 0;
+    }
+};
+
+bool UringRing::open() {
+    io_uring_params p{};
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = kCqEntries;
+    fd = (int)::syscall(__NR_io_uring_setup, kSqEntries, &p);
+    if (fd < 0) {
+        std::cerr << "io_uring_setup() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    // One mapping for both rings (5.4) and timed waits (5.11)
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG)) {
+        std::cerr << "io_uring on this kernel is too old (features 0x" << std::hex << p.features << std::dec << ")\n";
+        return false;
+    }
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    const size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (cq_len > sq_len) sq_len = cq_len;
+    sq_mem = ::mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_mem == MAP_FAILED) {
+        std::cerr << "mmap(io_uring rings) failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes_mem = ::mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes_mem == MAP_FAILED) {
+        std::cerr << "mmap(io_uring sqes) failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_mem);
+
+    char* sq = static_cast<char*>(sq_mem);
+    sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sq_local_tail = *sq_tail;
+    cq_head = reinterpret_cast<unsigned*>(sq + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(sq + p.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(sq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(sq + p.cq_off.cqes);
+
+    // Receive buffers, registered as a provided-buffer ring (5.19)
+    buf_mem = ::mmap(nullptr, (size_t)kBufs * kBufSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* br_mem = ::mmap(nullptr, kBufs * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf_mem == MAP_FAILED || br_mem == MAP_FAILED) {
+        std::cerr << "mmap(receive buffers) failed: " << std::strerror(errno) << "\n";
+        if (br_mem != MAP_FAILED) ::munmap(br_mem, kBufs * sizeof(io_uring_buf));
+        return false;
+    }
+    br = static_cast<io_uring_buf*>(br_mem);
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(br);
+    reg.ring_entries = kBufs;
+    reg.bgid = kBufGroup;
+    if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        std::cerr << "io_uring_register(PBUF_RING) failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    for (unsigned i = 0; i < kBufs; i++) recycle((uint16_t)i);
+
+    msg.msg_controllen = kCtlLen;
+    return true;
+}
+
+UringConnection::UringConnection(int fd, std::unique_ptr<UringRing> ring) : sock_(fd), ring_(std::move(ring)) {
+    ring_->prep_recv(sock_);
+    int rc = ring_->enter(0, -1);
+    if (rc < 0) {
+        std::cerr << "io_uring_enter() failed: " << std::strerror(-rc) << "\n";
+        eof_ = true;
+    }
+}
+
+UringConnection::~UringConnection() {
+    flush(); // Best effort, the peer may be gone
+    ring_.reset(); // Cancels the receive before the socket goes
+    ::close(sock_);
+}
+
+int UringConnection::fd() const {
+    return ring_->fd;
+}
+
+void UringConnection::reap() const {
+    UringRing& r = *ring_;
+    unsigned head = *r.cq_head;
+    const unsigned tail = load_acquire(r.cq_tail);
+    for (; head != tail; head++) {
+        const io_uring_cqe& c = r.cqes[head & r.cq_mask];
+        if (c.user_data == kSendTag) {
+            if (c.res <= 0) {
+                std::cerr << "send() failed: " << std::strerror(c.res < 0 ? -c.res : EPIPE) << "\n";
+                r.send_failed = true;
+                r.send_pending = false;
+                continue;
+            }
+            // A short send goes again with the next enter
+            r.send_off += (size_t)c.res;
+            if (r.send_off < r.sending.size()) {
+                r.prep_send(sock_);
+            } else {
+                r.send_pending = false;
+                r.sending.clear();
+            }
+            continue;
+        }
+
+        if (!(c.flags & IORING_CQE_F_MORE)) r.armed = false;
+        if (c.res < 0) {
+            // Out of buffers only pauses the receive; we re-arm below
+            if (c.res != -ENOBUFS && !eof_) {
+                std::cerr << "recv() failed: " << std::strerror(-c.res) << "\n";
+                eof_ = true;
+            }
+            continue;
+        }
+        if (!(c.flags & IORING_CQE_F_BUFFER)) continue;
+
+        const uint16_t bid = (uint16_t)(c.flags >> IORING_CQE_BUFFER_SHIFT);
+        char* b = r.buf(bid);
+        io_uring_recvmsg_out out;
+        std::memcpy(&out, b, sizeof(out));
+        char* ctl = b + sizeof(out) + r.msg.msg_namelen;
+        if (out.payloadlen == 0) eof_ = true;
+        rbuf_.append(ctl + r.msg.msg_controllen, out.payloadlen);
+
+        // Software stamp of the newest segment, as TcpConnection does
+        msghdr m{};
+        m.msg_control = ctl;
+        m.msg_controllen = out.controllen;
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&m); cm; cm = CMSG_NXTHDR(&m, cm)) {
+            if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMPING) continue;
+            scm_timestamping ts;
+            std::memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+            rx_wall_ns_ = (int64_t)ts.ts[0].tv_sec * 1'000'000'000 + ts.ts[0].tv_nsec;
+        }
+        r.recycle(bid);
+    }
+    store_release(r.cq_head, head);
+
+    if (!r.armed && !eof_) {
+        r.prep_recv(sock_);
+        int rc = r.enter(0, -1);
+        if (rc < 0) {
+            std::cerr << "io_uring_enter() failed: " << std::strerror(-rc) << "\n";
+            eof_ = true;
+        }
+    }
+}
+
+bool UringConnection::wait_cqe(unsigned want, int timeout_ms) const {
+    if (want == 1 && !ring_->cq_empty()) return true;
+    int rc = ring_->enter(want, timeout_ms);
+    if (rc < 0 && rc != -ETIME && rc != -EINTR) {
+        std::cerr << "io_uring_enter() failed: " << std::strerror(-rc) << "\n";
+        eof_ = true;
+        return true;
+    }
+    return !ring_->cq_empty();
+}
+
+bool UringConnection::queue_send() {
+    UringRing& r = *ring_;
+    if (r.send_failed) return false;
+    if (r.send_pending || wbuf_.empty()) return true;
+    r.sending.swap(wbuf_);
+    wbuf_.clear();
+    r.send_off = 0;
+    r.prep_send(sock_);
+    return true;
+}
+
+unsigned UringConnection::wait_want() const {
+    // A send queued with the wait completes on its own, usually inside the
+    // enter; asking for one more completion keeps us waiting for the peer
+    return ring_->send_pending ? 2 : 1;
+}
+
+bool UringConnection::has_line() const {
+    if (rbuf_.find('\n', rpos_) != std::string::npos) return true;
+    reap();
+    return rbuf_.find('\n', rpos_) != std::string::npos;
+}
+
+bool UringConnection::read_line(std::string& out) {
+    out.clear();
+    while (true) {
+        size_t nl = rbuf_.find('\n', rpos_);
+        if (nl != std::string::npos) {
+            out.assign(rbuf_, rpos_, nl - rpos_);
+            rpos_ = nl + 1;
+            return true;
+        }
+        if (eof_) return false;
+
+        // Drop consumed bytes only when we need more
+        rbuf_.erase(0, rpos_);
+        rpos_ = 0;
+
+        const size_t had = rbuf_.size();
+        reap();
+        if (rbuf_.size() != had || eof_) continue;
+        // About to block: whatever we owe the peer goes in the same enter
+        if (!queue_send()) return false;
+        wait_cqe(wait_want(), -1);
+    }
+}
+
+bool UringConnection::write_all(std::string_view s) {
+    if (ring_->send_failed) return false;
+    wbuf_.append(s.data(), s.size());
+    // Don't sit on more than a socket buffer's worth
+    if (wbuf_.size() >= 64 * 1024) return flush();
+    return true;
+}
+
+bool UringConnection::flush() {
+    while (true) {
+        if (!queue_send()) return false;
+        if (!ring_->send_pending) return true;
+        int rc = ring_->enter(1, -1);
+        if (rc < 0 && rc != -EINTR) {
+            std::cerr << "io_uring_enter() failed: " << std::strerror(-rc) << "\n";
+            ring_->send_failed = true;
+            return false;
+        }
+        reap();
+    }
+}
+
+bool UringConnection::wait_readable(int timeout_ms) {
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+    while (true) {
+        if (has_line() || eof_) return true;
+        if (!queue_send()) return true; // read_line reports it
+
+        int left = -1;
+        if (timeout_ms >= 0) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+            left = ns <= 0 ? 0 : (int)((ns + 999'999) / 1'000'000);
+        }
+        const size_t had = rbuf_.size() - rpos_;
+        bool got = wait_cqe(wait_want(), left);
+        reap();
+        // Partial lines count, as poll() would see them
+        if (rbuf_.size() - rpos_ != had || eof_) return true;
+        // Nothing from the peer, maybe only our send finished
+        if (!got && left >= 0) return false;
+        if (timeout_ms >= 0 && Clock::now() >= deadline) return false;
+    }
+}
+
+std::unique_ptr<UringConnection> uring_connection(int fd) {
+    auto ring = std::make_unique<UringRing>();
+    if (!ring->open()) return nullptr;
+    return std::unique_ptr<UringConnection>(new UringConnection(fd, std::move(ring)));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "common/net.h"
+
+// TCP through io_uring instead of poll() + recvmsg() + send()
+//
+// One multishot RECVMSG stays armed on the socket and lands data, with its
+// kernel receive timestamp, in a ring of buffers registered with the
+// kernel: while data keeps arriving, reading it is a look at the
+// completion ring (shared memory), no syscall. Writes are held back and
+// leave as one SEND when the owner is about to wait (wait_readable, or
+// flush() before its own poll()), so the replies to a burst of lines cost
+// one syscall between them.
+//
+// fd() is the ring's fd, which polls readable once a completion waits.
+// Everything runs on the thread that uses the connection; nothing here is
+// thread-safe.
+
+struct UringRing;
+
+class UringConnection : public Connection {
+public:
+    ~UringConnection() override;
+
+    bool read_line(std::string& out) override;
+    bool write_all(std::string_view s) override;
+    bool flush() override;
+    bool has_line() const override;
+    bool wait_readable(int timeout_ms) override;
+    int fd() const override;
+    int64_t rx_wall_ns() const override { return rx_wall_ns_; }
+
+private:
+    friend std::unique_ptr<UringConnection> uring_connection(int fd);
+
+    UringConnection(int fd, std::unique_ptr<UringRing> ring);
+
+    // Moves finished receives into rbuf_ and re-arms the receive if the
+    // kernel ended it. No syscall unless it re-arms. Const so has_line()
+    // sees data that has landed; the buffers it fills are mutable
+    void reap() const;
+    // Submits what's queued and blocks until `want` completions are
+    // waiting, at most timeout_ms; false if none is
+    bool wait_cqe(unsigned want, int timeout_ms) const;
+    // Hands wbuf_ to the kernel unless a send is still in flight (then it
+    // waits its turn); false once a send has failed
+    bool queue_send();
+    unsigned wait_want() const;
+
+    int sock_ = -1;
+    std::unique_ptr<UringRing> ring_;
+
+    mutable std::string rbuf_; // Received bytes, lines before rpos_ already returned
+    mutable size_t rpos_ = 0;
+    mutable int64_t rx_wall_ns_ = 0;
+    mutable bool eof_ = false; // EOF or a failed receive; rbuf_ still drains
+
+    std::string wbuf_; // Held back until flush() or a wait
+};
+
+// Takes over a connected TCP socket. Null, and the fd left open, if this
+// kernel won't give us a ring (too old, io_uring_disabled, seccomp); the
+// message on stderr says why
+std::unique_ptr<UringConnection> uring_connection(int fd);
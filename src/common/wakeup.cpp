@@ -0,0 +1,27 @@
+#include "common/wakeup.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+Wakeup::Wakeup() {
+    efd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+Wakeup::~Wakeup() {
+    if (efd_ >= 0) ::close(efd_);
+}
+
+void Wakeup::signal() {
+    uint64_t one = 1;
+    ssize_t n = ::write(efd_, &one, sizeof(one));
+    (void)n; // Only fails if the counter is saturated, i.e. already readable
+}
+
+void Wakeup::clear() {
+    sleeping_.store(false, std::memory_order_relaxed);
+    uint64_t v = 0;
+    ssize_t n = ::read(efd_, &v, sizeof(v));
+    (void)n; // EAGAIN when nobody had to wake us
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+
+// Sleep/wake handshake between producers filling a lock-free queue and the
+// one consumer that blocks in poll() once it has drained it
+//
+// The consumer announces it is about to sleep, then looks at the queue
+// once more; a producer that pushed looks at the flag after pushing. One
+// of the two always sees the other, so an item is never stranded, and the
+// eventfd is written once per sleep rather than once per item.
+class Wakeup {
+public:
+    Wakeup();
+    ~Wakeup();
+
+    Wakeup(const Wakeup&) = delete;
+    Wakeup& operator=(const Wakeup&) = delete;
+
+    // Readable once notify() found the consumer asleep
+    int fd() const { return efd_; }
+
+    // Producer, after publishing
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) signal();
+    }
+
+    // Consumer, right before blocking. False if pending() already has work,
+    // so the caller must not block; otherwise the next notify() wakes fd()
+    template <class Pending>
+    bool prepare_wait(Pending&& pending) {
+        sleeping_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!pending()) return true;
+        sleeping_.store(false, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Consumer, after waking (or deciding not to sleep after all)
+    void clear();
+
+private:
+    void signal();
+
+    std::atomic<bool> sleeping_{false};
+    int efd_ = -1; // eventfd
+};
@@ -0,0 +1,206 @@
+#include "ledger_query/fill_query.h"
+
+#include "ledger_query/parallel.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+// Rows per block: the keys of a block stay in L1
+static constexpr size_t kBlock = 1024;
+
+// Groups (or buckets) summed over every thread's accumulators, ~256 MB
+static constexpr uint64_t kMaxGroupSlots = uint64_t(1) << 23;
+
+// Earliest and latest ts_us over [b, e)
+static void ts_range(const int64_t* ts, size_t b, size_t e, int64_t& lo, int64_t& hi) {
+    int64_t mn = std::numeric_limits<int64_t>::max();
+    int64_t mx = std::numeric_limits<int64_t>::min();
+    for (size_t i = b; i < e; i++) {
+        mn = std::min(mn, ts[i]);
+        mx = std::max(mx, ts[i]);
+    }
+    lo = mn;
+    hi = mx;
+}
+
+// First bucket start and bucket count covering every row
+static void bucket_span(const FillTable& t, int64_t bucket_us, int threads, int64_t& base, uint64_t& buckets) {
+    std::vector<int64_t> lo((size_t)threads), hi((size_t)threads);
+    parallel_for(threads, [&](int th) {
+        size_t b = 0, e = 0;
+        split_range(t.rows(), threads, th, b, e);
+        ts_range(t.ts_us(), b, e, lo[(size_t)th], hi[(size_t)th]);
+    });
+    int64_t mn = *std::min_element(lo.begin(), lo.end());
+    int64_t mx = *std::max_element(hi.begin(), hi.end());
+    if (t.rows() == 0) mn = mx = 0;
+    base = (mn >= 0) ? mn / bucket_us * bucket_us : -((-mn + bucket_us - 1) / bucket_us) * bucket_us;
+    buckets = (uint64_t)((mx - base) / bucket_us) + 1;
+}
+
+// One thread's groups, structure of arrays
+struct Accum {
+    std::vector<uint64_t> fills;
+    std::vector<int64_t> volume;
+    std::vector<double> notional;
+    std::vector<double> pnl;
+
+    explicit Accum(size_t groups) : fills(groups), volume(groups), notional(groups), pnl(groups) {}
+};
+
+bool aggregate(const FillTable& t, const AggSpec& spec, int threads, std::vector<AggRow>& out) {
+    out.clear();
+    if (threads <= 0) threads = default_threads();
+    threads = (int)std::max<size_t>(1, std::min<size_t>((size_t)threads, t.rows() / kBlock + 1));
+
+    int64_t base = 0;
+    uint64_t nb = 1;
+    if (spec.bucket_us > 0) bucket_span(t, spec.bucket_us, threads, base, nb);
+    const uint64_t nsym = spec.by_symbol ? std::max<size_t>(1, t.symbols().size()) : 1;
+    const uint64_t nside = spec.by_side ? 2 : 1;
+    const uint64_t groups = nsym * nside * nb;
+    if (groups * (uint64_t)threads > kMaxGroupSlots) {
+        std::cerr << "ledger_query: " << groups << " groups is too many, use a coarser bucket\n";
+        return false;
+    }
+
+    // One extra slot takes the rows the symbol filter drops
+    const uint64_t drop = groups;
+    std::vector<Accum> acc;
+    acc.reserve((size_t)threads);
+    for (int th = 0; th < threads; th++) acc.emplace_back((size_t)groups + 1);
+
+    const int64_t* ts = t.ts_us();
+    const uint16_t* sym = t.symbol();
+    const uint8_t* side = t.side();
+    const int32_t* qty = t.qty();
+    const double* price = t.price();
+    const double* pnl = t.realized_pnl();
+    const uint64_t side_mul = spec.by_side ? 1 : 0;
+    const uint64_t sym_mul = spec.by_symbol ? 1 : 0;
+    const int64_t bucket_us = spec.bucket_us > 0 ? spec.bucket_us : 1;
+    const bool bucketed = spec.bucket_us > 0;
+
+    parallel_for(threads, [&](int th) {
+        Accum& a = acc[(size_t)th];
+        size_t b = 0, e = 0;
+        split_range(t.rows(), threads, th, b, e);
+        uint32_t key[kBlock];
+        for (size_t blk = b; blk < e; blk += kBlock) {
+            const size_t n = std::min(kBlock, e - blk);
+            for (size_t j = 0; j < n; j++) {
+                const size_t i = blk + j;
+                uint64_t k = (uint64_t)sym[i] * sym_mul * nside + side[i] * side_mul;
+                if (bucketed) k = k * nb + (uint64_t)((ts[i] - base) / bucket_us);
+                key[j] = (uint32_t)k;
+            }
+            if (spec.symbol >= 0) {
+                for (size_t j = 0; j < n; j++) key[j] = (sym[blk + j] == spec.symbol) ? key[j] : (uint32_t)drop;
+            }
+            for (size_t j = 0; j < n; j++) {
+                const size_t i = blk + j;
+                a.fills[key[j]]++;
+                a.volume[key[j]] += qty[i];
+                a.notional[key[j]] += (double)qty[i] * price[i];
+                a.pnl[key[j]] += pnl[i];
+            }
+        }
+    });
+
+    // Merge into the first thread's accumulators, each thread a range of groups
+    parallel_for(threads, [&](int th) {
+        size_t b = 0, e = 0;
+        split_range((size_t)groups, threads, th, b, e);
+        Accum& dst = acc[0];
+        for (size_t k = 1; k < acc.size(); k++) {
+            const Accum& src = acc[k];
+            for (size_t g = b; g < e; g++) {
+                dst.fills[g] += src.fills[g];
+                dst.volume[g] += src.volume[g];
+                dst.notional[g] += src.notional[g];
+                dst.pnl[g] += src.pnl[g];
+            }
+        }
+    });
+
+    const Accum& a = acc[0];
+    for (uint64_t g = 0; g < groups; g++) {
+        if (a.fills[g] == 0) continue;
+        AggRow r;
+        uint64_t rest = g;
+        if (bucketed) {
+            r.bucket_start_us = base + (int64_t)(rest % nb) * spec.bucket_us;
+            rest /= nb;
+        }
+        if (spec.by_side) r.side = (int)(rest % nside);
+        rest /= nside;
+        if (spec.by_symbol) r.symbol = (int)rest;
+        else if (spec.symbol >= 0) r.symbol = spec.symbol;
+        r.fills = a.fills[g];
+        r.volume = a.volume[g];
+        r.notional = a.notional[g];
+        r.realized_pnl = a.pnl[g];
+        out.push_back(r);
+    }
+    return true;
+}
+
+bool trajectory(const FillTable& t, int symbol, int64_t bucket_us, int threads, std::vector<TrajectoryPoint>& out) {
+    out.clear();
+    if (threads <= 0) threads = default_threads();
+    threads = (int)std::max<size_t>(1, std::min<size_t>((size_t)threads, t.rows() / kBlock + 1));
+    if (bucket_us <= 0) bucket_us = 1;
+
+    int64_t base = 0;
+    uint64_t nb = 1;
+    bucket_span(t, bucket_us, threads, base, nb);
+    if (nb * (uint64_t)threads > kMaxGroupSlots) {
+        std::cerr << "ledger_query: " << nb << " buckets is too many, use a coarser bucket\n";
+        return false;
+    }
+
+    // Each thread's points for its own rows; merged in row order below
+    std::vector<std::vector<TrajectoryPoint>> parts((size_t)threads, std::vector<TrajectoryPoint>((size_t)nb));
+    const int64_t* ts = t.ts_us();
+    const uint16_t* sym = t.symbol();
+    const int32_t* pos = t.position_after();
+    parallel_for(threads, [&](int th) {
+        std::vector<TrajectoryPoint>& pts = parts[(size_t)th];
+        size_t b = 0, e = 0;
+        split_range(t.rows(), threads, th, b, e);
+        for (size_t i = b; i < e; i++) {
+            if (sym[i] != symbol) continue;
+            TrajectoryPoint& p = pts[(size_t)((ts[i] - base) / bucket_us)];
+            const int32_t v = pos[i];
+            if (p.fills++ == 0) {
+                p.first = p.min = p.max = v;
+            } else {
+                p.min = std::min(p.min, v);
+                p.max = std::max(p.max, v);
+            }
+            p.last = v;
+        }
+    });
+
+    for (uint64_t k = 0; k < nb; k++) {
+        TrajectoryPoint m;
+        m.bucket_start_us = base + (int64_t)k * bucket_us;
+        for (const std::vector<TrajectoryPoint>& pts : parts) {
+            const TrajectoryPoint& p = pts[(size_t)k];
+            if (p.fills == 0) continue;
+            if (m.fills == 0) {
+                m.first = p.first;
+                m.min = p.min;
+                m.max = p.max;
+            } else {
+                m.min = std::min(m.min, p.min);
+                m.max = std::max(m.max, p.max);
+            }
+            m.last = p.last;
+            m.fills += p.fills;
+        }
+        if (m.fills > 0) out.push_back(m);
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ledger_query/fill_table.h"
+
+// Aggregations over a FillTable, run in parallel: each thread scans a
+// contiguous range of rows into its own accumulators, which are merged at
+// the end. Rows go through in blocks, the group keys of a block computed
+// in one tight loop before its values are added up.
+
+// Group by any of symbol, side and time bucket; no dimension = one total
+struct AggSpec {
+    bool by_symbol = false;
+    bool by_side = false;
+    int64_t bucket_us = 0; // 0 = no time buckets
+    int symbol = -1;       // Only this symbol id, -1 = all
+};
+
+struct AggRow {
+    int symbol = -1;             // -1 = all
+    int side = -1;               // (int)Side, -1 = both
+    int64_t bucket_start_us = 0; // Bucketed queries only
+    uint64_t fills = 0;
+    int64_t volume = 0;
+    double notional = 0.0;       // Sum of qty * price
+    double realized_pnl = 0.0;   // Booked by the fills in the group
+
+    double vwap() const { return volume ? notional / (double)volume : 0.0; }
+};
+
+// Rows in group order (symbol, side, bucket); empty groups left out.
+// False (with a message on stderr) if the grouping has too many groups
+bool aggregate(const FillTable& t, const AggSpec& spec, int threads, std::vector<AggRow>& out);
+
+// One symbol's position over time, from the position_after column
+struct TrajectoryPoint {
+    int64_t bucket_start_us = 0;
+    uint64_t fills = 0;
+    int32_t first = 0; // position_after of the bucket's first fill
+    int32_t min = 0;
+    int32_t max = 0;
+    int32_t last = 0;
+};
+
+// Buckets with no fill of the symbol are left out
+bool trajectory(const FillTable& t, int symbol, int64_t bucket_us, int threads, std::vector<TrajectoryPoint>& out);
@@ -0,0 +1,519 @@
+#include "ledger_query/fill_table.h"
+
+#include "common/clock.h"
+#include "ledger_query/parallel.h"
+#include "oms/orders.h"
+#include "oms/positions.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+// ---- Cache file: header, then each column 64-byte aligned, then the
+// symbol names (u16 length + bytes each)
+
+static constexpr char kCacheMagic[8] = {'F', 'I', 'L', 'L', 'C', 'O', 'L', 'S'};
+static constexpr uint32_t kCacheVersion = 1;
+
+enum Column { kTs, kClientId, kVenueId, kSymbol, kSide, kQty, kPrice, kPosAfter, kRealized, kColumns };
+
+static constexpr size_t kColumnSize[kColumns] = {
+    sizeof(int64_t), sizeof(int32_t), sizeof(int32_t), sizeof(uint16_t), sizeof(uint8_t),
+    sizeof(int32_t), sizeof(double), sizeof(int32_t), sizeof(double)};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t symbols;
+    uint64_t rows;
+    uint64_t csv_size;     // The CSV this was built from
+    int64_t csv_mtime_ns;
+    uint64_t col_offset[kColumns];
+    uint64_t symbols_offset;
+    uint64_t symbols_len;
+};
+
+static uint64_t align64(uint64_t v) {
+    return (v + 63) & ~uint64_t(63);
+}
+
+// Columns parsed in this process, filled without zeroing first
+struct FillTable::Owned {
+    std::unique_ptr<int64_t[]> ts_us;
+    std::unique_ptr<int32_t[]> client_id;
+    std::unique_ptr<int32_t[]> venue_id;
+    std::unique_ptr<uint16_t[]> symbol;
+    std::unique_ptr<uint8_t[]> side;
+    std::unique_ptr<int32_t[]> qty;
+    std::unique_ptr<double[]> price;
+    std::unique_ptr<int32_t[]> position_after;
+    std::unique_ptr<double[]> realized_pnl;
+
+    explicit Owned(size_t n)
+        : ts_us(new int64_t[n]), client_id(new int32_t[n]), venue_id(new int32_t[n]), symbol(new uint16_t[n]),
+          side(new uint8_t[n]), qty(new int32_t[n]), price(new double[n]), position_after(new int32_t[n]),
+          realized_pnl(new double[n]) {}
+
+    const void* column(int c) const {
+        switch (c) {
+            case kTs: return ts_us.get();
+            case kClientId: return client_id.get();
+            case kVenueId: return venue_id.get();
+            case kSymbol: return symbol.get();
+            case kSide: return side.get();
+            case kQty: return qty.get();
+            case kPrice: return price.get();
+            case kPosAfter: return position_after.get();
+            default: return realized_pnl.get();
+        }
+    }
+};
+
+FillTable::FillTable() = default;
+
+FillTable::~FillTable() {
+    unmap();
+}
+
+void FillTable::unmap() {
+    if (map_) ::munmap(map_, map_len_);
+    map_ = nullptr;
+    map_len_ = 0;
+}
+
+int FillTable::symbol_id(const std::string& name) const {
+    auto it = std::lower_bound(symbols_.begin(), symbols_.end(), name);
+    return (it != symbols_.end() && *it == name) ? (int)(it - symbols_.begin()) : -1;
+}
+
+void FillTable::point_at_owned() {
+    ts_us_ = owned_->ts_us.get();
+    client_id_ = owned_->client_id.get();
+    venue_id_ = owned_->venue_id.get();
+    symbol_ = owned_->symbol.get();
+    side_ = owned_->side.get();
+    qty_ = owned_->qty.get();
+    price_ = owned_->price.get();
+    position_after_ = owned_->position_after.get();
+    realized_pnl_ = owned_->realized_pnl.get();
+}
+
+// ---- CSV parsing
+
+template <class T>
+static bool take_number(const char*& p, const char* end, T& out) {
+    auto r = std::from_chars(p, end, out);
+    if (r.ec != std::errc()) return false;
+    p = r.ptr;
+    return true;
+}
+
+static bool take_comma(const char*& p, const char* end) {
+    if (p == end || *p != ',') return false;
+    p++;
+    return true;
+}
+
+// One row without its '\n': ts_us,client_id,venue_id,symbol,side,qty,price,position_after
+struct CsvRow {
+    int64_t ts_us = 0;
+    int32_t client_id = 0;
+    int32_t venue_id = 0;
+    std::string_view symbol;
+    Side side = Side::Buy;
+    int32_t qty = 0;
+    double price = 0.0;
+    int32_t position_after = 0;
+};
+
+static bool parse_row(const char* p, const char* end, CsvRow& r) {
+    if (end > p && end[-1] == '\r') end--;
+    if (!take_number(p, end, r.ts_us) || !take_comma(p, end)) return false;
+    if (!take_number(p, end, r.client_id) || !take_comma(p, end)) return false;
+    if (!take_number(p, end, r.venue_id) || !take_comma(p, end)) return false;
+
+    const char* sym = p;
+    while (p != end && *p != ',') p++;
+    r.symbol = std::string_view(sym, (size_t)(p - sym));
+    if (r.symbol.empty() || !take_comma(p, end)) return false;
+
+    if (end - p >= 4 && std::memcmp(p, "BUY,", 4) == 0) {
+        r.side = Side::Buy;
+        p += 4;
+    } else if (end - p >= 5 && std::memcmp(p, "SELL,", 5) == 0) {
+        r.side = Side::Sell;
+        p += 5;
+    } else {
+        return false;
+    }
+
+    if (!take_number(p, end, r.qty) || !take_comma(p, end)) return false;
+    if (!take_number(p, end, r.price) || !take_comma(p, end)) return false;
+    if (!take_number(p, end, r.position_after)) return false;
+    return p == end && r.qty > 0;
+}
+
+// One thread's share of the CSV: whole lines in [begin, end)
+struct CsvChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    size_t first_row = 0; // Where its rows go
+    size_t lines = 0;
+    size_t rows = 0;      // Parsed; lines - rows were malformed
+    std::vector<std::string_view> symbols;   // Local id -> name (in the mapped CSV)
+    std::vector<uint16_t> to_global;         // Local id -> global id
+};
+
+static size_t count_lines(const char* p, const char* end) {
+    size_t n = 0;
+    while (p < end) {
+        const void* nl = std::memchr(p, '\n', (size_t)(end - p));
+        if (!nl) break;
+        p = static_cast<const char*>(nl) + 1;
+        n++;
+    }
+    return n;
+}
+
+bool FillTable::parse_csv(const std::string& path, int threads, LoadStats& st) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "ledger_query: cannot open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    struct stat sb {};
+    ::fstat(fd, &sb);
+    size_t len = (size_t)sb.st_size;
+    const char* data = nullptr;
+    void* mem = nullptr;
+    if (len > 0) {
+        mem = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED) {
+            std::cerr << "ledger_query: mmap() failed: " << std::strerror(errno) << "\n";
+            ::close(fd);
+            return false;
+        }
+        ::madvise(mem, len, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mem);
+    }
+    ::close(fd);
+
+    // Header line, if any; a trailing line without '\n' is still being written
+    const char* p = data;
+    const char* end = data + len;
+    if (len >= 5 && std::memcmp(p, "ts_us", 5) == 0) {
+        const void* nl = std::memchr(p, '\n', len);
+        p = nl ? static_cast<const char*>(nl) + 1 : end;
+    }
+    while (end > p && end[-1] != '\n') end--;
+
+    // Chunks start on line boundaries
+    std::vector<CsvChunk> chunks((size_t)threads);
+    const char* at = p;
+    for (int t = 0; t < threads; t++) {
+        CsvChunk& c = chunks[(size_t)t];
+        c.begin = at;
+        const char* cut = p + (size_t)(end - p) * (size_t)(t + 1) / (size_t)threads;
+        if (cut < at) cut = at;
+        if (t + 1 < threads && cut < end) {
+            const void* nl = std::memchr(cut, '\n', (size_t)(end - cut));
+            cut = nl ? static_cast<const char*>(nl) + 1 : end;
+        } else {
+            cut = end;
+        }
+        c.end = cut;
+        at = cut;
+    }
+
+    int64_t t0 = mono_ns();
+    parallel_for(threads, [&](int t) {
+        CsvChunk& c = chunks[(size_t)t];
+        c.lines = count_lines(c.begin, c.end);
+    });
+    size_t total = 0;
+    for (CsvChunk& c : chunks) {
+        c.first_row = total;
+        total += c.lines;
+    }
+
+    owned_ = std::make_unique<Owned>(total ? total : 1);
+    Owned& o = *owned_;
+
+    bool too_many_symbols = false;
+    parallel_for(threads, [&](int t) {
+        CsvChunk& c = chunks[(size_t)t];
+        std::unordered_map<std::string_view, uint16_t> local;
+        size_t row = c.first_row;
+        CsvRow r;
+        for (const char* q = c.begin; q < c.end;) {
+            const char* nl = static_cast<const char*>(std::memchr(q, '\n', (size_t)(c.end - q)));
+            if (!parse_row(q, nl, r)) {
+                q = nl + 1;
+                continue;
+            }
+            q = nl + 1;
+
+            auto it = local.find(r.symbol);
+            if (it == local.end()) {
+                if (c.symbols.size() > 0xffff) {
+                    too_many_symbols = true;
+                    break;
+                }
+                it = local.emplace(r.symbol, (uint16_t)c.symbols.size()).first;
+                c.symbols.push_back(r.symbol);
+            }
+            o.ts_us[row] = r.ts_us;
+            o.client_id[row] = r.client_id;
+            o.venue_id[row] = r.venue_id;
+            o.symbol[row] = it->second;
+            o.side[row] = (uint8_t)r.side;
+            o.qty[row] = r.qty;
+            o.price[row] = r.price;
+            o.position_after[row] = r.position_after;
+            row++;
+        }
+        c.rows = row - c.first_row;
+    });
+    if (too_many_symbols) {
+        std::cerr << "ledger_query: more than 65536 symbols\n";
+        if (mem) ::munmap(mem, len);
+        return false;
+    }
+
+    // One dictionary, sorted by name, and every chunk's ids remapped to it
+    std::vector<std::string> names;
+    for (const CsvChunk& c : chunks) {
+        for (std::string_view s : c.symbols) names.emplace_back(s);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    for (CsvChunk& c : chunks) {
+        for (std::string_view s : c.symbols) {
+            auto it = std::lower_bound(names.begin(), names.end(), s);
+            c.to_global.push_back((uint16_t)(it - names.begin()));
+        }
+    }
+    if (mem) ::munmap(mem, len); // The chunk dictionaries pointed into it
+    if (names.size() > 0x10000) {
+        std::cerr << "ledger_query: more than 65536 symbols\n";
+        return false;
+    }
+    symbols_ = std::move(names);
+    parallel_for(threads, [&](int t) {
+        const CsvChunk& c = chunks[(size_t)t];
+        uint16_t* sym = o.symbol.get() + c.first_row;
+        for (size_t i = 0; i < c.rows; i++) sym[i] = c.to_global[sym[i]];
+    });
+
+    // Malformed lines left gaps at the end of their chunk
+    rows_ = 0;
+    for (const CsvChunk& c : chunks) {
+        st.skipped += c.lines - c.rows;
+        if (c.first_row != rows_ && c.rows > 0) {
+            for (int col = 0; col < kColumns; col++) {
+                char* base = static_cast<char*>(const_cast<void*>(o.column(col)));
+                std::memmove(base + rows_ * kColumnSize[col], base + c.first_row * kColumnSize[col],
+                             c.rows * kColumnSize[col]);
+            }
+        }
+        rows_ += c.rows;
+    }
+    int64_t t1 = mono_ns();
+    st.parse_ns = t1 - t0;
+
+    // realized_pnl: every symbol's fills replayed in ledger order. Each
+    // thread takes a range of rows, so first the tracker of every symbol at
+    // each range start is found, each thread replaying only its own symbols
+    // over all rows; then the ranges are replayed in parallel from there
+    const size_t nsym = symbols_.size();
+    std::vector<PositionTracker> at_start((size_t)threads * nsym);
+    if (threads > 1) {
+        parallel_for(threads, [&](int t) {
+            std::vector<PositionTracker> tr(nsym);
+            int next = 1;
+            size_t next_begin = 0, unused = 0;
+            split_range(rows_, threads, next, next_begin, unused);
+            for (size_t i = 0; i < rows_; i++) {
+                while (next < threads && i == next_begin) {
+                    for (size_t s = (size_t)t; s < nsym; s += (size_t)threads) {
+                        at_start[(size_t)next * nsym + s] = tr[s];
+                    }
+                    if (++next < threads) split_range(rows_, threads, next, next_begin, unused);
+                }
+                const uint16_t s = o.symbol[i];
+                if (s % threads != t) continue;
+                tr[s].on_fill((Side)o.side[i], o.qty[i], o.price[i]);
+            }
+        });
+    }
+    parallel_for(threads, [&](int t) {
+        std::vector<PositionTracker> tr(at_start.begin() + (long)((size_t)t * nsym),
+                                        at_start.begin() + (long)((size_t)(t + 1) * nsym));
+        size_t b = 0, e = 0;
+        split_range(rows_, threads, t, b, e);
+        for (size_t i = b; i < e; i++) {
+            o.realized_pnl[i] = tr[o.symbol[i]].on_fill((Side)o.side[i], o.qty[i], o.price[i]);
+        }
+    });
+    st.pnl_ns = mono_ns() - t1;
+
+    point_at_owned();
+    return true;
+}
+
+// ---- Cache
+
+bool FillTable::write_cache(const std::string& path, uint64_t csv_size, int64_t csv_mtime_ns) const {
+    CacheHeader h {};
+    std::memcpy(h.magic, kCacheMagic, sizeof(h.magic));
+    h.version = kCacheVersion;
+    h.symbols = (uint32_t)symbols_.size();
+    h.rows = rows_;
+    h.csv_size = csv_size;
+    h.csv_mtime_ns = csv_mtime_ns;
+    uint64_t off = align64(sizeof(CacheHeader));
+    for (int c = 0; c < kColumns; c++) {
+        h.col_offset[c] = off;
+        off = align64(off + rows_ * kColumnSize[c]);
+    }
+    std::string names;
+    for (const std::string& s : symbols_) {
+        uint16_t n = (uint16_t)s.size();
+        names.append(reinterpret_cast<const char*>(&n), sizeof(n));
+        names.append(s);
+    }
+    h.symbols_offset = off;
+    h.symbols_len = names.size();
+
+    // Written aside and renamed into place, so readers never see half a cache
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "ledger_query: cannot write cache " << tmp << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    auto put = [&](uint64_t at, const void* p, size_t n) {
+        const char* b = static_cast<const char*>(p);
+        while (n > 0) {
+            ssize_t w = ::pwrite(fd, b, n, (off_t)at);
+            if (w <= 0) return false;
+            b += w;
+            at += (uint64_t)w;
+            n -= (size_t)w;
+        }
+        return true;
+    };
+    bool ok = put(0, &h, sizeof(h));
+    for (int c = 0; ok && c < kColumns; c++) ok = put(h.col_offset[c], owned_->column(c), rows_ * kColumnSize[c]);
+    ok = ok && put(h.symbols_offset, names.data(), names.size());
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "ledger_query: cache write failed: " << std::strerror(errno) << "\n";
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FillTable::map_cache(const std::string& path, uint64_t csv_size, int64_t csv_mtime_ns) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat sb {};
+    ::fstat(fd, &sb);
+    size_t len = (size_t)sb.st_size;
+    if (len < sizeof(CacheHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* mem = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) return false;
+
+    // Stale or foreign caches are rebuilt, never trusted
+    const CacheHeader& h = *static_cast<const CacheHeader*>(mem);
+    bool ok = std::memcmp(h.magic, kCacheMagic, sizeof(h.magic)) == 0 && h.version == kCacheVersion
+              && h.csv_size == csv_size && h.csv_mtime_ns == csv_mtime_ns
+              && h.symbols_offset + h.symbols_len <= len;
+    for (int c = 0; ok && c < kColumns; c++) {
+        ok = h.col_offset[c] % 64 == 0 && h.col_offset[c] + h.rows * kColumnSize[c] <= len;
+    }
+    std::vector<std::string> names;
+    const char* base = static_cast<const char*>(mem);
+    for (uint64_t at = h.symbols_offset, i = 0; ok && i < h.symbols; i++) {
+        uint16_t n = 0;
+        ok = at + sizeof(n) <= h.symbols_offset + h.symbols_len;
+        if (!ok) break;
+        std::memcpy(&n, base + at, sizeof(n));
+        at += sizeof(n);
+        ok = at + n <= h.symbols_offset + h.symbols_len;
+        if (ok) names.emplace_back(base + at, n);
+        at += n;
+    }
+    if (!ok) {
+        ::munmap(mem, len);
+        return false;
+    }
+
+    map_ = mem;
+    map_len_ = len;
+    rows_ = h.rows;
+    symbols_ = std::move(names);
+    ts_us_ = reinterpret_cast<const int64_t*>(base + h.col_offset[kTs]);
+    client_id_ = reinterpret_cast<const int32_t*>(base + h.col_offset[kClientId]);
+    venue_id_ = reinterpret_cast<const int32_t*>(base + h.col_offset[kVenueId]);
+    symbol_ = reinterpret_cast<const uint16_t*>(base + h.col_offset[kSymbol]);
+    side_ = reinterpret_cast<const uint8_t*>(base + h.col_offset[kSide]);
+    qty_ = reinterpret_cast<const int32_t*>(base + h.col_offset[kQty]);
+    price_ = reinterpret_cast<const double*>(base + h.col_offset[kPrice]);
+    position_after_ = reinterpret_cast<const int32_t*>(base + h.col_offset[kPosAfter]);
+    realized_pnl_ = reinterpret_cast<const double*>(base + h.col_offset[kRealized]);
+    return true;
+}
+
+bool FillTable::load(const std::string& csv_path, int threads, bool use_cache, LoadStats* stats) {
+    LoadStats local;
+    LoadStats& st = stats ? *stats : local;
+    st = LoadStats{};
+    if (threads <= 0) threads = default_threads();
+
+    unmap();
+    owned_.reset();
+    rows_ = 0;
+    symbols_.clear();
+
+    struct stat sb {};
+    if (::stat(csv_path.c_str(), &sb) != 0) {
+        std::cerr << "ledger_query: cannot open " << csv_path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    const uint64_t csv_size = (uint64_t)sb.st_size;
+    const int64_t csv_mtime_ns = (int64_t)sb.st_mtim.tv_sec * 1'000'000'000 + sb.st_mtim.tv_nsec;
+    const std::string cache = cache_path(csv_path);
+
+    if (use_cache) {
+        int64_t t0 = mono_ns();
+        if (map_cache(cache, csv_size, csv_mtime_ns)) {
+            st.from_cache = true;
+            st.io_ns = mono_ns() - t0;
+            return true;
+        }
+    }
+
+    if (!parse_csv(csv_path, threads, st)) return false;
+    if (use_cache) {
+        // A failed write only costs the next run a parse
+        int64_t t0 = mono_ns();
+        write_cache(cache, csv_size, csv_mtime_ns);
+        st.io_ns = mono_ns() - t0;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The fills ledger (fills.csv) as columns
+//
+// One array per CSV column, plus realized_pnl: what each fill realized,
+// replayed through PositionTracker per symbol exactly as the OMS books it.
+// Symbols are dictionary-coded (id = index into symbols(), sorted by name)
+// and side is the Side enum as a byte.
+//
+// Loading parses the CSV in parallel once and writes every column to a
+// cache next to it (<csv>.cols). Later loads map that file and use the
+// columns in place, so only the columns a query touches are ever read.
+// The cache is rebuilt when the CSV's size or mtime no longer match.
+class FillTable {
+public:
+    struct LoadStats {
+        bool from_cache = false;
+        size_t skipped = 0;   // Malformed CSV lines
+        int64_t parse_ns = 0; // CSV -> columns (0 when cached)
+        int64_t pnl_ns = 0;   // realized_pnl replay (0 when cached)
+        int64_t io_ns = 0;    // Cache write, or map
+    };
+
+    FillTable();
+    ~FillTable();
+
+    FillTable(const FillTable&) = delete;
+    FillTable& operator=(const FillTable&) = delete;
+
+    // threads <= 0 = one per core. use_cache false parses the CSV and
+    // leaves any cache alone. False (with a message on stderr) on error
+    bool load(const std::string& csv_path, int threads, bool use_cache, LoadStats* stats = nullptr);
+
+    size_t rows() const { return rows_; }
+
+    const int64_t* ts_us() const { return ts_us_; }
+    const int32_t* client_id() const { return client_id_; }
+    const int32_t* venue_id() const { return venue_id_; }
+    const uint16_t* symbol() const { return symbol_; }
+    const uint8_t* side() const { return side_; }
+    const int32_t* qty() const { return qty_; }
+    const double* price() const { return price_; }
+    const int32_t* position_after() const { return position_after_; }
+    const double* realized_pnl() const { return realized_pnl_; }
+
+    const std::vector<std::string>& symbols() const { return symbols_; }
+    // -1 if the symbol never traded
+    int symbol_id(const std::string& name) const;
+
+    static std::string cache_path(const std::string& csv_path) { return csv_path + ".cols"; }
+
+private:
+    struct Owned; // Columns parsed in this process
+
+    void unmap();
+    bool parse_csv(const std::string& path, int threads, LoadStats& st);
+    bool map_cache(const std::string& path, uint64_t csv_size, int64_t csv_mtime_ns);
+    bool write_cache(const std::string& path, uint64_t csv_size, int64_t csv_mtime_ns) const;
+    void point_at_owned();
+
+    size_t rows_ = 0;
+    const int64_t* ts_us_ = nullptr;
+    const int32_t* client_id_ = nullptr;
+    const int32_t* venue_id_ = nullptr;
+    const uint16_t* symbol_ = nullptr;
+    const uint8_t* side_ = nullptr;
+    const int32_t* qty_ = nullptr;
+    const double* price_ = nullptr;
+    const int32_t* position_after_ = nullptr;
+    const double* realized_pnl_ = nullptr;
+    std::vector<std::string> symbols_;
+
+    std::unique_ptr<Owned> owned_;
+    void* map_ = nullptr;
+    size_t map_len_ = 0;
+};
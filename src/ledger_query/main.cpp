@@ -0,0 +1,143 @@
+// ledger_query: aggregations over the fills ledger (fills.csv) without
+// re-parsing it. The first run builds a columnar cache next to the CSV;
+// later runs map it and only read the columns a query needs.
+#include "common/clock.h"
+#include "ledger_query/fill_query.h"
+#include "ledger_query/fill_table.h"
+#include "ledger_query/parallel.h"
+#include "oms/orders.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void usage() {
+    std::cerr << "usage: ledger_query [--ledger=fills.csv] [--threads=N] [--no-cache] [--timing]\n"
+                 "                    [agg|trajectory|info] [--by=symbol,side,bucket] [--bucket-s=N]"
+                 " [--symbol=S]\n";
+}
+
+// --by=symbol,side,bucket in any combination
+static bool parse_by(const std::string& s, AggSpec& spec, bool& by_bucket) {
+    std::istringstream iss(s);
+    std::string tok;
+    spec.by_symbol = spec.by_side = by_bucket = false;
+    while (std::getline(iss, tok, ',')) {
+        if (tok == "symbol") spec.by_symbol = true;
+        else if (tok == "side") spec.by_side = true;
+        else if (tok == "bucket") by_bucket = true;
+        else if (!tok.empty()) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string ledger = "fills.csv";
+    std::string query = "agg";
+    std::string symbol;
+    int threads = 0;
+    bool use_cache = true;
+    bool timing = false;
+    double bucket_s = 60.0;
+    AggSpec spec;
+    spec.by_symbol = true;
+    bool by_bucket = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg.rfind("--ledger=", 0) == 0) ledger = arg.substr(9);
+        else if (arg.rfind("--threads=", 0) == 0) ok = (threads = std::atoi(arg.c_str() + 10)) > 0;
+        else if (arg == "--no-cache") use_cache = false;
+        else if (arg == "--timing") timing = true;
+        else if (arg.rfind("--by=", 0) == 0) ok = parse_by(arg.substr(5), spec, by_bucket);
+        else if (arg.rfind("--bucket-s=", 0) == 0) ok = (bucket_s = std::atof(arg.c_str() + 11)) > 0.0;
+        else if (arg.rfind("--symbol=", 0) == 0) symbol = arg.substr(9);
+        else if (arg == "agg" || arg == "trajectory" || arg == "info") query = arg;
+        else ok = false;
+        if (!ok) {
+            usage();
+            return 1;
+        }
+    }
+    if (threads <= 0) threads = default_threads();
+    const int64_t bucket_us = (int64_t)(bucket_s * 1e6);
+    if (bucket_us <= 0) {
+        usage();
+        return 1;
+    }
+
+    int64_t t0 = mono_ns();
+    FillTable table;
+    FillTable::LoadStats ls;
+    if (!table.load(ledger, threads, use_cache, &ls)) return 1;
+    int64_t t1 = mono_ns();
+    if (ls.skipped > 0) std::cerr << "ledger_query: skipped " << ls.skipped << " malformed line(s)\n";
+
+    int sym_id = -1;
+    if (!symbol.empty()) {
+        sym_id = table.symbol_id(symbol);
+        if (sym_id < 0) {
+            std::cerr << "ledger_query: no fills for " << symbol << "\n";
+            return 1;
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+    std::cout << std::fixed << std::setprecision(4);
+    const std::vector<std::string>& names = table.symbols();
+
+    if (query == "info") {
+        std::cout << "rows=" << table.rows() << " symbols=" << names.size()
+                  << " cache=" << (ls.from_cache ? "hit" : use_cache ? "built" : "off") << "\n";
+        if (table.rows() > 0) {
+            std::cout << "first_ts_us=" << table.ts_us()[0] << " last_ts_us=" << table.ts_us()[table.rows() - 1]
+                      << "\n";
+        }
+    } else if (query == "trajectory") {
+        if (sym_id < 0) {
+            std::cerr << "ledger_query: trajectory needs --symbol=S\n";
+            return 1;
+        }
+        std::vector<TrajectoryPoint> pts;
+        if (!trajectory(table, sym_id, bucket_us, threads, pts)) return 1;
+        std::cout << "bucket_start_us,fills,first,min,max,last\n";
+        for (const TrajectoryPoint& p : pts) {
+            std::cout << p.bucket_start_us << "," << p.fills << "," << p.first << "," << p.min << "," << p.max
+                      << "," << p.last << "\n";
+        }
+    } else {
+        spec.bucket_us = by_bucket ? bucket_us : 0;
+        spec.symbol = sym_id;
+        std::vector<AggRow> rows;
+        if (!aggregate(table, spec, threads, rows)) return 1;
+
+        const bool show_symbol = spec.by_symbol || sym_id >= 0;
+        if (show_symbol) std::cout << "symbol,";
+        if (spec.by_side) std::cout << "side,";
+        if (by_bucket) std::cout << "bucket_start_us,";
+        std::cout << "fills,volume,vwap,notional,realized_pnl\n";
+        for (const AggRow& r : rows) {
+            if (show_symbol) std::cout << names[(size_t)r.symbol] << ",";
+            if (spec.by_side) std::cout << to_string((Side)r.side) << ",";
+            if (by_bucket) std::cout << r.bucket_start_us << ",";
+            std::cout << r.fills << "," << r.volume << "," << r.vwap() << "," << r.notional << ","
+                      << r.realized_pnl << "\n";
+        }
+    }
+    std::cout.flush();
+    int64_t t2 = mono_ns();
+
+    if (timing) {
+        std::cerr << "ledger_query: rows=" << table.rows() << " threads=" << threads
+                  << " load_ms=" << (t1 - t0) / 1e6;
+        if (ls.from_cache) std::cerr << " (cache map_ms=" << ls.io_ns / 1e6 << ")";
+        else std::cerr << " (parse_ms=" << ls.parse_ns / 1e6 << " pnl_ms=" << ls.pnl_ns / 1e6
+                       << " cache_write_ms=" << ls.io_ns / 1e6 << ")";
+        std::cerr << " query_ms=" << (t2 - t1) / 1e6 << "\n";
+    }
+    return 0;
+}
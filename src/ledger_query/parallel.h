@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Runs fn(t) for t in [0, threads) on that many threads (the caller's is
+// one of them) and returns when all are done
+template <class Fn>
+void parallel_for(int threads, Fn&& fn) {
+    if (threads <= 1) {
+        fn(0);
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve((size_t)threads - 1);
+    for (int t = 1; t < threads; t++) pool.emplace_back([&fn, t] { fn(t); });
+    fn(0);
+    for (std::thread& th : pool) th.join();
+}
+
+// Part t of [0, n) split into `parts` near-equal ranges: [begin, end)
+inline void split_range(size_t n, int parts, int t, size_t& begin, size_t& end) {
+    begin = n * (size_t)t / (size_t)parts;
+    end = n * (size_t)(t + 1) / (size_t)parts;
+}
+
+// One per core, at least one
+inline int default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? (int)n : 1;
+}
@@ -0,0 +1,159 @@
+#include "oms/algo.h"
+
+#include <algorithm>
+
+const char* to_string(AlgoKind k) {
+    return (k == AlgoKind::Twap) ? "TWAP" : "ICEBERG";
+}
+
+static bool is_done(OrderState st) {
+    return st == OrderState::Filled || st == OrderState::Cancelled || st == OrderState::Rejected;
+}
+
+// Time between TWAP slices; the first goes out at start
+static int64_t twap_interval_ns(const AlgoParams& p) {
+    return (p.slices > 1) ? p.duration_ns / (p.slices - 1) : 0;
+}
+
+void AlgoEngine::start(int parent_id, const AlgoParams& p, int64_t now_ns, std::vector<SliceRequest>& out) {
+    const Order* parent = store_.get(parent_id);
+    if (!parent) return;
+
+    Algo& a = algos_[parent_id];
+    a.p = p;
+    a.qty = parent->qty;
+    a.start_ns = now_ns;
+
+    if (p.kind == AlgoKind::Twap) {
+        a.ticks = 1;
+        if (a.ticks < p.slices) schedule(parent_id, a, now_ns + twap_interval_ns(p));
+    }
+    release(parent_id, a, out);
+}
+
+void AlgoEngine::stop(int parent_id) {
+    if (algos_.count(parent_id)) finish(parent_id);
+}
+
+int AlgoEngine::stop_all(const std::string& symbol, const Side* side) {
+    // Collect first: finishing a parent erases it from algos_
+    std::vector<int> ids;
+    for (const auto& kv : algos_) {
+        const Order* p = store_.get(kv.first);
+        if (!p) continue;
+        if (!symbol.empty() && p->symbol != symbol) continue;
+        if (side && p->side != *side) continue;
+        ids.push_back(kv.first);
+    }
+    for (int id : ids) finish(id);
+    return (int)ids.size();
+}
+
+void AlgoEngine::schedule(int parent_id, Algo& a, int64_t due_ns) {
+    timers_.schedule(due_ns, parent_id, ++a.gen);
+}
+
+void AlgoEngine::release(int parent_id, Algo& a, std::vector<SliceRequest>& out) {
+    int want = 0;
+    if (a.p.kind == AlgoKind::Twap) {
+        int target = (int)((int64_t)a.qty * a.ticks / a.p.slices);
+        want = target - a.filled - a.working;
+    } else if (a.working == 0) {
+        want = std::min(a.p.display_qty, a.qty - a.filled);
+    }
+    if (want <= 0) return;
+
+    a.working += want;
+    out.push_back({parent_id, want});
+}
+
+void AlgoEngine::on_timer(int64_t now_ns, std::vector<SliceRequest>& out) {
+    TimerQueue::Timer t;
+    while (timers_.pop_due(now_ns, t)) {
+        auto it = algos_.find(t.key);
+        if (it == algos_.end() || it->second.gen != t.gen) continue; // Stale
+        Algo& a = it->second;
+
+        // A TWAP tick moves the schedule on; anything else is a retry
+        if (a.p.kind == AlgoKind::Twap && a.ticks < a.p.slices) {
+            a.ticks++;
+            if (a.ticks < a.p.slices) schedule(t.key, a, a.start_ns + a.ticks * twap_interval_ns(a.p));
+        }
+        release(t.key, a, out);
+    }
+}
+
+void AlgoEngine::on_slice_sent(int parent_id, int child_id, int qty) {
+    auto it = algos_.find(parent_id);
+    if (it != algos_.end()) it->second.open.emplace_back(child_id, qty);
+}
+
+void AlgoEngine::on_slice_refused(int parent_id, int qty, int64_t now_ns) {
+    auto it = algos_.find(parent_id);
+    if (it == algos_.end()) return;
+    Algo& a = it->second;
+    a.working -= qty;
+    retry(parent_id, a, now_ns);
+}
+
+void AlgoEngine::retry(int parent_id, Algo& a, int64_t now_ns) {
+    // A TWAP with ticks left catches up on the next one
+    if (a.p.kind == AlgoKind::Iceberg || a.ticks >= a.p.slices) schedule(parent_id, a, now_ns + kRetryNs);
+}
+
+void AlgoEngine::on_child_update(int child_id, int64_t now_ns, std::vector<SliceRequest>& out) {
+    const Order* c = store_.get(child_id);
+    if (!c || !c->parent_id || !is_done(c->state)) return;
+
+    auto it = algos_.find(c->parent_id);
+    if (it == algos_.end()) return;
+    Algo& a = it->second;
+
+    for (size_t i = 0; i < a.open.size(); i++) {
+        if (a.open[i].first == child_id) {
+            child_done(c->parent_id, a, i, now_ns, out);
+            return;
+        }
+    }
+}
+
+void AlgoEngine::sweep(int64_t now_ns, std::vector<SliceRequest>& out) {
+    // Collect first: finishing a parent erases it from algos_
+    std::vector<int> done;
+    for (const auto& kv : algos_) {
+        for (const auto& child : kv.second.open) {
+            const Order* c = store_.get(child.first);
+            if (c && is_done(c->state)) done.push_back(child.first);
+        }
+    }
+    for (int id : done) on_child_update(id, now_ns, out);
+}
+
+void AlgoEngine::child_done(int parent_id, Algo& a, size_t open_idx, int64_t now_ns,
+                            std::vector<SliceRequest>& out) {
+    const Order* c = store_.get(a.open[open_idx].first);
+    const bool rejected = c && c->state == OrderState::Rejected;
+    a.working -= a.open[open_idx].second;
+    a.filled += c ? c->filled_qty : 0;
+    a.open[open_idx] = a.open.back();
+    a.open.pop_back();
+
+    if (a.filled >= a.qty) {
+        finish(parent_id);
+        return;
+    }
+
+    // Resending straight away would only be rejected again
+    if (rejected) {
+        if (++a.rejects >= kMaxRejects) finish(parent_id);
+        else retry(parent_id, a, now_ns);
+        return;
+    }
+    a.rejects = 0;
+    release(parent_id, a, out);
+}
+
+void AlgoEngine::finish(int parent_id) {
+    algos_.erase(parent_id);
+    store_.set_working(parent_id, false);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/timer_queue.h"
+#include "oms/orders.h"
+
+enum class AlgoKind : uint8_t { Twap, Iceberg };
+
+const char* to_string(AlgoKind k);
+
+struct AlgoParams {
+    AlgoKind kind = AlgoKind::Twap;
+    int64_t duration_ns = 0; // TWAP: first slice at start, last one duration later
+    int slices = 1;          // TWAP: number of equal slices
+    int display_qty = 0;     // Iceberg: qty shown at a time
+};
+
+// A child order the engine wants sent now
+struct SliceRequest {
+    int parent_id = 0;
+    int qty = 0;
+};
+
+// Works algo parent orders (OrderStore parents) by asking for child slices
+//
+// TWAP releases qty on a fixed schedule: after slice k of n, k/n of the
+// parent is working or filled, so qty a child didn't fill is released again.
+// Iceberg keeps one child of display_qty working and refills it when that
+// child is done.
+//
+// The engine never sends anything: it appends SliceRequests, and the caller
+// risk-checks and sends each one and reports back (on_slice_sent/refused).
+// Slice timers share one TimerQueue and child updates are looked up per
+// child, so the cost is per event, however many parents are active.
+class AlgoEngine {
+public:
+    static constexpr int64_t kRetryNs = 1'000'000'000; // After a refused or venue-rejected slice
+    static constexpr int kMaxRejects = 5; // Venue rejects in a row before the algo gives up
+
+    explicit AlgoEngine(OrderStore& store) : store_(store) {}
+
+    // parent_id must already be an add_parent() parent in the store
+    void start(int parent_id, const AlgoParams& p, int64_t now_ns, std::vector<SliceRequest>& out);
+    // No more slices. Open children are the caller's to cancel
+    void stop(int parent_id);
+    // stop() for every parent on symbol (empty = any) and side (null = both)
+    // Returns how many were stopped
+    int stop_all(const std::string& symbol, const Side* side);
+
+    bool active(int parent_id) const { return algos_.count(parent_id) != 0; }
+    size_t active_count() const { return algos_.size(); }
+
+    // Runs every slice timer due by now
+    void on_timer(int64_t now_ns, std::vector<SliceRequest>& out);
+    // ms until the next slice timer, -1 if none
+    int timer_ms(int64_t now_ns) const { return timers_.wait_ms(now_ns); }
+
+    // What became of a requested slice
+    void on_slice_sent(int parent_id, int child_id, int qty);
+    void on_slice_refused(int parent_id, int qty, int64_t now_ns);
+
+    // A child's state changed. Once it is done its fills count, and the
+    // parent refills or finishes. A child the venue rejected is retried
+    // kRetryNs later, like a refused slice; after kMaxRejects in a row the
+    // algo stops and the parent ends with its children (Rejected if none
+    // of them filled)
+    void on_child_update(int child_id, int64_t now_ns, std::vector<SliceRequest>& out);
+    // Re-checks every open child, after a reconcile closed some in bulk
+    void sweep(int64_t now_ns, std::vector<SliceRequest>& out);
+
+private:
+    struct Algo {
+        AlgoParams p;
+        int qty = 0;
+        int filled = 0;  // By children that are done
+        int working = 0; // Requested or open, not done yet
+        std::vector<std::pair<int, int>> open; // (child_id, qty) of open children
+
+        int64_t start_ns = 0;
+        int ticks = 0;    // TWAP slices released so far
+        int rejects = 0;  // Children the venue rejected in a row
+        uint32_t gen = 0; // Current timer; older ones are stale
+    };
+
+    void schedule(int parent_id, Algo& a, int64_t due_ns);
+    // Asks for whatever the parent is behind by
+    void release(int parent_id, Algo& a, std::vector<SliceRequest>& out);
+    // Child done: counts its fills, then refills or finishes the parent
+    void child_done(int parent_id, Algo& a, size_t open_idx, int64_t now_ns, std::vector<SliceRequest>& out);
+    // Refused or rejected qty goes out again kRetryNs later
+    void retry(int parent_id, Algo& a, int64_t now_ns);
+    void finish(int parent_id);
+
+    OrderStore& store_;
+    std::unordered_map<int, Algo> algos_; // By parent client_id
+    TimerQueue timers_;
+};
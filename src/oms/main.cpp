@@ -1,272 +1,319 @@
-#include "common/net.h"
-#include "common/messages.h"
-#include "oms/orders.h"
-#include "oms/positions.h"
-#include "oms/risk.h"
-#include "oms/ledger.h"
-
-#include <poll.h>
-#include <sys/time.h>
+// oms: the OMS as a command-line tool. Everything but the commands lives in
+// OmsCore (oms_core.h); this reads stdin and calls into it.
+#include "oms/oms_core.h"
+
+#include <signal.h>
 #include <unistd.h>
 
-#include <cerrno>
-#include <cstring>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
+
+// BUY/SELL trade this symbol
+static const std::string kSymbol = "ABC";
+
+// Set by SIGHUP: reload the risk config
+static volatile sig_atomic_t g_reload_requested = 0;
+
+static void on_sighup(int) {
+    g_reload_requested = 1;
+}
 
 static void trim_crlf(std::string& s) {
     while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
 }
 
-static long long now_us() {
-    timeval tv;
-    gettimeofday(&tv, nullptr);
-    return (long long)tv.tv_sec * 1000000LL + (long long)tv.tv_usec;
+// --venue=<port> or --venue=<ip>:<port>
+static bool parse_venue(const std::string& s, std::string& ip, int& port) {
+    size_t colon = s.rfind(':');
+    ip = (colon == std::string::npos) ? "127.0.0.1" : s.substr(0, colon);
+    port = std::atoi(s.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+    return !ip.empty() && port > 0 && port < 65536;
 }
 
-static void print_status(const OrderStore& store, const PositionTracker& pos, const RiskConfig& cfg) {
-    std::cout << "oms: STATUS\n";
-    std::cout << "  position(ABC)=" << pos.position() << "\n";
-    std::cout << "  avg_cost(ABC)=" << pos.avg_cost() << "\n";
-    std::cout << "  realized_pnl=" << pos.realized_pnl() << "\n";
-    std::cout << "  open_orders=" << store.open_orders_count() << "\n";
-    std::cout << "  limits: max_order_qty=" << cfg.max_order_qty
-              << " max_notional=" << cfg.max_notional
-              << " max_open_orders=" << cfg.max_open_orders
-              << " max_abs_position=" << cfg.max_abs_position
-              << "\n";
-}
+// One typed command. False to exit
+static bool run_command(OmsCore& oms, const std::string& cmd) {
+    if (cmd == "exit" || cmd == "quit") {
+        std::cout << "oms: exiting\n";
+        return false;
+    }
 
-int main() {
-    const char* ip = "127.0.0.1";
-    const int port = 9001;
+    std::istringstream iss(cmd);
+    std::string kind;
+    iss >> kind;
 
-    int fd = tcp_connect_ipv4(ip, port);
-    if (fd < 0) return 1;
+    if (kind == "STATUS") {
+        std::string extra;
+        if (iss >> extra) std::cout << "oms: invalid. STATUS takes no args\n";
+        else oms.print_status();
+        return true;
+    }
 
-    std::cout << "oms: connected to " << ip << ":" << port << "\n";
-    std::cout << "oms: commands:\n";
-    std::cout << "  BUY <qty> <price>\n";
-    std::cout << "  SELL <qty> <price>\n";
-    std::cout << "  CANCEL <client_id>\n";
-    std::cout << "  STATUS\n";
-    std::cout << "  exit\n";
+    if (kind == "BUY" || kind == "SELL") {
+        int qty = 0;
+        double price = 0.0;
+        if (!(iss >> qty >> price) || qty <= 0 || price <= 0.0) {
+            std::cout << "oms: invalid. expected: BUY 10 101.25\n";
+            return true;
+        }
 
-    RiskConfig risk_cfg;
-    int next_id = 1001;
+        std::string extra;
+        if (iss >> extra) {
+            std::cout << "oms: invalid. unexpected extra token: " << extra << "\n";
+            return true;
+        }
+
+        oms.submit(kSymbol, parse_side(kind), qty, price);
+        return true;
+    }
 
-    OrderStore store;
-    PositionTracker pos;
+    if (kind == "TWAP" || kind == "ICEBERG") {
+        // TWAP <side> <qty> <price> <duration_s> <slices>
+        // ICEBERG <side> <qty> <price> <display_qty>
+        std::string side_tok;
+        int qty = 0;
+        double price = 0.0;
+        AlgoParams ap;
+        bool ok = static_cast<bool>(iss >> side_tok >> qty >> price)
+                  && (side_tok == "BUY" || side_tok == "SELL") && qty > 0 && price > 0.0;
+        if (ok && kind == "TWAP") {
+            double duration_s = 0.0;
+            ap.kind = AlgoKind::Twap;
+            ok = static_cast<bool>(iss >> duration_s >> ap.slices) && duration_s >= 0.0
+                 && ap.slices > 0 && ap.slices <= qty;
+            ap.duration_ns = (int64_t)(duration_s * 1e9);
+        } else if (ok) {
+            ap.kind = AlgoKind::Iceberg;
+            ok = static_cast<bool>(iss >> ap.display_qty) && ap.display_qty > 0 && ap.display_qty <= qty;
+        }
+        std::string extra;
+        if (!ok || (iss >> extra)) {
+            std::cout << "oms: invalid. expected: TWAP BUY 1000 101.25 60 10 or ICEBERG BUY 1000 101.25 100\n";
+            return true;
+        }
 
-    Ledger ledger;
-    if (!ledger.open("fills.csv")) {
-        std::cerr << "oms: cannot continue without ledger\n";
-        ::close(fd);
-        return 1;
+        oms.start_algo(kSymbol, parse_side(side_tok), qty, price, ap);
+        return true;
     }
-    std::cout << "oms: ledger=fills.csv\n";
 
-    pollfd fds[2];
-    fds[0].fd = STDIN_FILENO;
-    fds[0].events = POLLIN;
+    if (kind == "SYNC") {
+        oms.sync();
+        return true;
+    }
 
-    fds[1].fd = fd;
-    fds[1].events = POLLIN;
+    if (kind == "RELOAD") {
+        std::string path = oms.risk_path();
+        iss >> path;
+        if (path.empty()) {
+            std::cout << "oms: invalid. expected: RELOAD risk.conf\n";
+            return true;
+        }
+        if (!oms.reload_risk(path)) std::cout << "oms: reload already in progress\n";
+        return true;
+    }
 
-    while (true) {
-        // Single-threaded: poll stdin + venue socket
-        int rc = ::poll(fds, 2, -1);
-        if (rc < 0) {
-            if (errno == EINTR) continue;
-            std::cerr << "poll() failed: " << std::strerror(errno) << "\n";
-            break;
+    if (kind == "REFPX") {
+        std::string symbol;
+        double px = 0.0;
+        if (!(iss >> symbol >> px) || px <= 0.0) {
+            std::cout << "oms: invalid. expected: REFPX ABC 100\n";
+            return true;
         }
+        oms.set_ref_price(symbol, px);
+        return true;
+    }
 
-        // ---- stdin ----
-        if (fds[0].revents & POLLIN) {
-            std::string cmd;
-            if (!std::getline(std::cin, cmd)) {
-                std::cout << "oms: stdin closed, exiting\n";
+    if (kind == "BASKET") {
+        // Legs are groups of four tokens: <BUY|SELL> <symbol> <qty> <price>
+        std::vector<OrderRequest> legs;
+        std::string side_tok;
+        bool bad = false;
+        while (iss >> side_tok) {
+            OrderRequest r;
+            if ((side_tok != "BUY" && side_tok != "SELL")
+                || !(iss >> r.symbol >> r.qty >> r.price)
+                || r.qty <= 0 || r.price <= 0.0) {
+                bad = true;
                 break;
             }
+            r.side = parse_side(side_tok);
+            legs.push_back(std::move(r));
+        }
+        if (bad || legs.empty()) {
+            std::cout << "oms: invalid. expected: BASKET BUY ABC 10 101.25 SELL XYZ 5 20\n";
+            return true;
+        }
+        oms.submit_basket(legs);
+        return true;
+    }
 
-            trim_crlf(cmd);
-            if (cmd.empty()) continue;
+    if (kind == "CANCEL_ALL") {
+        // Optional filters in any order: a side and/or a symbol
+        std::string symbol, side_str, tok;
+        bool bad = false;
+        while (iss >> tok) {
+            if ((tok == "BUY" || tok == "SELL") && side_str.empty()) side_str = tok;
+            else if (symbol.empty()) symbol = tok;
+            else { bad = true; break; }
+        }
+        if (bad) {
+            std::cout << "oms: invalid. expected: CANCEL_ALL [symbol] [BUY|SELL]\n";
+            return true;
+        }
 
-            if (cmd == "exit" || cmd == "quit") {
-                std::cout << "oms: exiting\n";
-                break;
-            }
+        Side side_enum = Side::Buy;
+        if (!side_str.empty()) side_enum = parse_side(side_str);
+        oms.cancel_all(symbol, side_str.empty() ? nullptr : &side_enum);
+        return true;
+    }
 
-            std::istringstream iss(cmd);
-            std::string kind;
-            iss >> kind;
-
-            if (kind == "STATUS") {
-                std::string extra;
-                if (iss >> extra) {
-                    std::cout << "oms: invalid. STATUS takes no args\n";
-                } else {
-                    print_status(store, pos, risk_cfg);
-                }
-                continue;
-            }
+    if (kind == "REPLACE") {
+        int client_id = 0;
+        int qty = 0;
+        double price = 0.0;
+        if (!(iss >> client_id >> qty >> price) || client_id <= 0 || qty <= 0 || price <= 0.0) {
+            std::cout << "oms: invalid. expected: REPLACE 1001 5 101.5\n";
+            return true;
+        }
 
-            if (kind == "BUY" || kind == "SELL") {
-                int qty = 0;
-                double price = 0.0;
-                if (!(iss >> qty >> price) || qty <= 0 || price <= 0.0) {
-                    std::cout << "oms: invalid. expected: BUY 10 101.25\n";
-                    continue;
-                }
-
-                std::string extra;
-                if (iss >> extra) {
-                    std::cout << "oms: invalid. unexpected extra token: " << extra << "\n";
-                    continue;
-                }
-
-                int client_id = next_id++;
-                Side side_enum = parse_side(kind);
-
-                // Store first so we can print/reject consistently
-                store.add_pending_new(client_id, "ABC", side_enum, qty, price);
-
-                // Participant-side risk gate before sending to the venue
-                std::string reason = check_new_order(risk_cfg, store, pos, side_enum, qty, price);
-                if (!reason.empty()) {
-                    store.mark_rejected(client_id, "RISK_" + reason);
-                    std::cout << "oms: RISK_REJECT client_id=" << client_id
-                              << " reason=" << ("RISK_" + reason) << "\n";
-                    store.print_one(client_id);
-                    continue;
-                }
-
-                // Send NEW
-                NewOrder o;
-                o.client_id = client_id;
-                o.symbol = "ABC";
-                o.side = kind;
-                o.qty = qty;
-                o.price = price;
-
-                std::string wire = format_new(o);
-                if (!write_all(fd, wire)) {
-                    std::cerr << "oms: failed to send NEW\n";
-                    break;
-                }
-                std::cout << "oms: sent: " << wire;
-                continue;
-            }
+        std::string extra;
+        if (iss >> extra) {
+            std::cout << "oms: invalid. unexpected extra token: " << extra << "\n";
+            return true;
+        }
 
-            if (kind == "CANCEL") {
-                int client_id = 0;
-                if (!(iss >> client_id) || client_id <= 0) {
-                    std::cout << "oms: invalid. expected: CANCEL 1001\n";
-                    continue;
-                }
-
-                std::string extra;
-                if (iss >> extra) {
-                    std::cout << "oms: invalid. unexpected extra token: " << extra << "\n";
-                    continue;
-                }
-
-                if (!store.request_cancel(client_id)) {
-                    store.print_one(client_id);
-                    continue;
-                }
-
-                std::string wire = format_cancel(client_id);
-                if (!write_all(fd, wire)) {
-                    std::cerr << "oms: failed to send CANCEL\n";
-                    break;
-                }
-                std::cout << "oms: sent: " << wire;
-                store.print_one(client_id);
-                continue;
-            }
+        oms.replace(client_id, qty, price);
+        return true;
+    }
 
-            std::cout << "oms: unknown command\n";
+    if (kind == "CANCEL") {
+        int client_id = 0;
+        if (!(iss >> client_id) || client_id <= 0) {
+            std::cout << "oms: invalid. expected: CANCEL 1001\n";
+            return true;
         }
 
-        // Venue socket
-        if (fds[1].revents & POLLIN) {
-            std::string line;
-            if (!read_line(fd, line)) {
-                std::cerr << "oms: venue disconnected\n";
-                break;
-            }
+        std::string extra;
+        if (iss >> extra) {
+            std::cout << "oms: invalid. unexpected extra token: " << extra << "\n";
+            return true;
+        }
 
-            Msg m = parse_msg(line);
-
-            switch (m.kind) {
-                case MsgKind::Ack: {
-                    std::cout << "oms: ACK client_id=" << m.client_id
-                              << " venue_id=" << m.venue_id << "\n";
-                    store.on_ack(m.client_id, m.venue_id);
-                    store.print_one(m.client_id);
-                    break;
-                }
-                case MsgKind::Fill: {
-                    std::cout << "oms: FILL client_id=" << m.client_id
-                              << " venue_id=" << m.venue_id
-                              << " qty=" << m.qty
-                              << " price=" << m.price
-                              << " liq=" << m.liquidity << "\n";
-
-                    const Order* o = store.get(m.client_id);
-                    if (!o) {
-                        std::cout << "oms: WARN fill for unknown order, cannot update pnl/ledger\n";
-                    } else {
-                        pos.on_fill(o->side, m.qty, m.price);
-
-                        ledger.on_fill(
-                            now_us(),
-                            m.client_id,
-                            m.venue_id,
-                            o->symbol,
-                            o->side,
-                            m.qty,
-                            m.price,
-                            pos.position()
-                        );
-
-                        std::cout << "oms: position=" << pos.position()
-                                  << " avg_cost=" << pos.avg_cost()
-                                  << " realized_pnl=" << pos.realized_pnl()
-                                  << "\n";
-                    }
-
-                    store.on_fill(m.client_id, m.venue_id, m.qty, m.price);
-                    store.print_one(m.client_id);
-                    break;
-                }
-                case MsgKind::Cancelled: {
-                    std::cout << "oms: CANCELLED client_id=" << m.client_id
-                              << " venue_id=" << m.venue_id << "\n";
-                    store.on_cancelled(m.client_id, m.venue_id);
-                    store.print_one(m.client_id);
-                    break;
-                }
-                case MsgKind::Reject: {
-                    std::cout << "oms: REJECT client_id=" << m.client_id
-                              << " reason=" << m.reason << "\n";
-                    if (m.client_id > 0) {
-                        store.mark_rejected(m.client_id, "VENUE_" + m.reason);
-                        store.print_one(m.client_id);
-                    }
-                    break;
-                }
-                default: {
-                    std::cout << "oms: recv(unparsed): " << line << "\n";
-                    break;
-                }
+        oms.cancel(client_id);
+        return true;
+    }
+
+    std::cout << "oms: unknown command\n";
+    return true;
+}
+
+int main(int argc, char** argv) {
+    OmsOptions opts;
+    opts.log = &std::cout;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg.rfind("--md-port=", 0) == 0) {
+            opts.md_port = std::atoi(arg.c_str() + 10);
+            continue;
+        }
+        if (arg.rfind("--metrics-port=", 0) == 0) {
+            opts.metrics_port = std::atoi(arg.c_str() + 15);
+            continue;
+        }
+        if (arg.rfind("--risk-config=", 0) == 0) {
+            opts.risk_path = arg.substr(14);
+            continue;
+        }
+        if (arg.rfind("--venue=", 0) == 0) {
+            std::string vip;
+            int vport = 0;
+            if (parse_venue(arg.substr(8), vip, vport)) {
+                opts.venues.emplace_back(vip, vport);
+                continue;
             }
+            ok = false;
+        }
+        if (arg.rfind("--max-orders=", 0) == 0) {
+            opts.max_orders = std::atoi(arg.c_str() + 13);
+            if (opts.max_orders >= 0) continue;
+            ok = false;
+        }
+        if (arg == "--state-shm") {
+            opts.state_shm = kDefaultStateShmName;
+            continue;
+        }
+        if (arg.rfind("--state-shm=", 0) == 0) {
+            opts.state_shm = arg.substr(12);
+            if (opts.state_shm.size() > 1 && opts.state_shm[0] == '/') continue;
+            ok = false;
+        }
+        if (arg.rfind("--min-child-qty=", 0) == 0) {
+            opts.route.min_child_qty = std::atoi(arg.c_str() + 16);
+            if (opts.route.min_child_qty > 0) continue;
+            ok = false;
+        }
+        if (!ok || !parse_transport_arg(arg, opts.transport, ok) || !ok) {
+            std::cerr << "usage: oms [--transport=tcp|shm] [--shm-wait=futex|spin] [--shm-name=/name] [--net=poll|uring]"
+                         " [--venue=[ip:]port ...] [--min-child-qty=N] [--max-orders=N]"
+                         " [--md-port=N] [--metrics-port=N] [--risk-config=path] [--state-shm[=/name]]\n";
+            return 1;
+        }
+    }
+
+    // Own buffer for stdin so in_avail() can see lines read ahead
+    std::ios::sync_with_stdio(false);
+
+    OmsCore oms(opts);
+    if (!oms.start()) return 1;
+    oms.arm_symbol(kSymbol);
+
+    std::cout << "oms: commands:\n";
+    std::cout << "  BUY <qty> <price>\n";
+    std::cout << "  SELL <qty> <price>\n";
+    std::cout << "  BASKET <BUY|SELL> <symbol> <qty> <price> [...]\n";
+    std::cout << "  CANCEL <client_id>\n";
+    std::cout << "  CANCEL_ALL [symbol] [BUY|SELL]\n";
+    std::cout << "  REPLACE <client_id> <qty> <price>\n";
+    std::cout << "  REFPX <symbol> <price>\n";
+    std::cout << "  RELOAD [risk_config_path]\n";
+    std::cout << "  TWAP <BUY|SELL> <qty> <price> <duration_s> <slices>\n";
+    std::cout << "  ICEBERG <BUY|SELL> <qty> <price> <display_qty>\n";
+    std::cout << "  SYNC\n";
+    std::cout << "  STATUS\n";
+    std::cout << "  exit\n";
+
+    struct sigaction sa {};
+    sa.sa_handler = on_sighup;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, nullptr); // No SA_RESTART, so poll() wakes up
+
+    // Reused every iteration so its capacity carries over
+    std::string cmd;
+
+    while (true) {
+        // Lines read ahead into std::cin don't show up in poll()
+        bool buffered = std::cin.rdbuf()->in_avail() > 0;
+        bool stdin_ready = false;
+        if (!oms.poll(buffered ? 0 : -1, STDIN_FILENO, stdin_ready)) break;
+
+        if (g_reload_requested) {
+            g_reload_requested = 0;
+            if (oms.risk_path().empty()) std::cout << "oms: SIGHUP ignored, no --risk-config\n";
+            else if (!oms.reload_risk()) std::cout << "oms: reload already in progress\n";
+        }
+
+        if (!buffered && !stdin_ready) continue;
+        if (!std::getline(std::cin, cmd)) {
+            std::cout << "oms: stdin closed, exiting\n";
+            break;
         }
+        trim_crlf(cmd);
+        if (cmd.empty()) continue;
+        if (!run_command(oms, cmd)) break;
     }
 
-    ::close(fd);
     return 0;
 }
@@ -0,0 +1,165 @@
+#include "oms/market_data.h"
+
+#include "common/messages.h"
+#include "common/net.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+static size_t hash_symbol(std::string_view s) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ULL;
+    for (char c : s) {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+}
+
+double TopOfBook::mark() const {
+    if (has_quote()) return (bid_px + ask_px) / 2.0;
+    return last_px;
+}
+
+const BookTable::Slot* BookTable::find(std::string_view symbol) const {
+    if (symbol.size() > kMaxSymbol) return nullptr;
+
+    size_t i = hash_symbol(symbol) & (kCapacity - 1);
+    for (size_t n = 0; n < kCapacity; n++, i = (i + 1) & (kCapacity - 1)) {
+        const Slot& s = slots_[i];
+        if (!s.used.load(std::memory_order_acquire)) return nullptr;
+        if (symbol == std::string_view(s.key)) return &s;
+    }
+    return nullptr;
+}
+
+BookTable::Slot* BookTable::find_or_insert(std::string_view symbol) {
+    if (symbol.size() > kMaxSymbol) return nullptr;
+
+    size_t i = hash_symbol(symbol) & (kCapacity - 1);
+    for (size_t n = 0; n < kCapacity; n++, i = (i + 1) & (kCapacity - 1)) {
+        Slot& s = slots_[i];
+        if (!s.used.load(std::memory_order_relaxed)) {
+            std::memcpy(s.key, symbol.data(), symbol.size());
+            s.key[symbol.size()] = '\0';
+            // Publish the key; readers stop probing at the first unused slot
+            s.used.store(1, std::memory_order_release);
+            return &s;
+        }
+        if (symbol == std::string_view(s.key)) return &s;
+    }
+    return nullptr;
+}
+
+void BookTable::begin_write(Slot& s) {
+    s.version.store(s.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void BookTable::end_write(Slot& s) {
+    s.version.store(s.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool BookTable::apply_bbo(std::string_view symbol, uint64_t seq, double bid_px, int bid_qty, double ask_px, int ask_qty) {
+    Slot* s = find_or_insert(symbol);
+    if (!s) return false;
+    if (seq <= s->seq.load(std::memory_order_relaxed)) return false;
+
+    begin_write(*s);
+    s->bid_px.store(bid_px, std::memory_order_relaxed);
+    s->bid_qty.store(bid_qty, std::memory_order_relaxed);
+    s->ask_px.store(ask_px, std::memory_order_relaxed);
+    s->ask_qty.store(ask_qty, std::memory_order_relaxed);
+    s->seq.store(seq, std::memory_order_relaxed);
+    end_write(*s);
+    return true;
+}
+
+bool BookTable::apply_trade(std::string_view symbol, uint64_t seq, int qty, double price) {
+    Slot* s = find_or_insert(symbol);
+    if (!s) return false;
+    if (seq <= s->seq.load(std::memory_order_relaxed)) return false;
+
+    begin_write(*s);
+    s->last_px.store(price, std::memory_order_relaxed);
+    s->last_qty.store(qty, std::memory_order_relaxed);
+    s->seq.store(seq, std::memory_order_relaxed);
+    end_write(*s);
+    return true;
+}
+
+bool BookTable::read(std::string_view symbol, TopOfBook& out) const {
+    const Slot* s = find(symbol);
+    if (!s) return false;
+
+    while (true) {
+        uint32_t v1 = s->version.load(std::memory_order_acquire);
+        if (v1 & 1) continue; // Writer mid-update
+
+        out.bid_px = s->bid_px.load(std::memory_order_relaxed);
+        out.bid_qty = s->bid_qty.load(std::memory_order_relaxed);
+        out.ask_px = s->ask_px.load(std::memory_order_relaxed);
+        out.ask_qty = s->ask_qty.load(std::memory_order_relaxed);
+        out.last_px = s->last_px.load(std::memory_order_relaxed);
+        out.last_qty = s->last_qty.load(std::memory_order_relaxed);
+        out.seq = s->seq.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->version.load(std::memory_order_relaxed) == v1) return true;
+    }
+}
+
+bool MarketDataHandler::start(int port) {
+    fd_ = udp_bind_loopback(port, 100);
+    if (fd_ < 0) return false;
+
+    stop_.store(false);
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void MarketDataHandler::stop() {
+    stop_.store(true);
+    if (thread_.joinable()) thread_.join();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void MarketDataHandler::run() {
+    char buf[2048];
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            std::cerr << "oms: md recv() failed: " << std::strerror(errno) << "\n";
+            return;
+        }
+
+        // A datagram may carry several lines
+        std::string_view data(buf, (size_t)n);
+        while (!data.empty()) {
+            size_t nl = data.find('\n');
+            std::string_view line = data.substr(0, nl);
+            data.remove_prefix(nl == std::string_view::npos ? data.size() : nl + 1);
+            if (line.empty()) continue;
+
+            Msg m = parse_msg(line);
+            bool ok = false;
+            if (m.kind == MsgKind::Bbo) {
+                ok = books_.apply_bbo(m.symbol, m.seq, m.bid_px, m.bid_qty, m.ask_px, m.ask_qty);
+            } else if (m.kind == MsgKind::Trade) {
+                ok = books_.apply_trade(m.symbol, m.seq, m.qty, m.price);
+            }
+
+            if (ok) applied_.fetch_add(1, std::memory_order_relaxed);
+            else dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+
+// Latest top of book + last trade for one symbol
+struct TopOfBook {
+    double bid_px = 0.0;
+    int bid_qty = 0;
+    double ask_px = 0.0;
+    int ask_qty = 0;
+    double last_px = 0.0;
+    int last_qty = 0;
+    uint64_t seq = 0; // Feed seq of the last applied update
+
+    bool has_quote() const { return bid_px > 0.0 && ask_px > 0.0; }
+    // Mid if quoted, else last trade, else 0
+    double mark() const;
+};
+
+// Per-symbol books written by one feed thread, read lock-free by others
+// Fixed-capacity open-addressed table: symbols are inserted once and never
+// removed, so readers can probe without locks. Each slot is a seqlock.
+class BookTable {
+public:
+    static constexpr size_t kCapacity = 1024; // Power of two
+    static constexpr size_t kMaxSymbol = 15;
+
+    // Writer side (feed thread only). Returns false for stale (seq not newer)
+    // updates, or if the table is full / the symbol is too long
+    bool apply_bbo(std::string_view symbol, uint64_t seq, double bid_px, int bid_qty, double ask_px, int ask_qty);
+    bool apply_trade(std::string_view symbol, uint64_t seq, int qty, double price);
+
+    // Reader side (any thread). False if the symbol has never been seen
+    bool read(std::string_view symbol, TopOfBook& out) const;
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> used{0}; // Set once, after key is written
+        char key[kMaxSymbol + 1] = {};
+
+        std::atomic<uint32_t> version{0}; // Odd while the writer is mid-update
+        std::atomic<double> bid_px{0.0};
+        std::atomic<int> bid_qty{0};
+        std::atomic<double> ask_px{0.0};
+        std::atomic<int> ask_qty{0};
+        std::atomic<double> last_px{0.0};
+        std::atomic<int> last_qty{0};
+        std::atomic<uint64_t> seq{0};
+    };
+
+    const Slot* find(std::string_view symbol) const;
+    Slot* find_or_insert(std::string_view symbol);
+
+    // Seqlock write bracket
+    static void begin_write(Slot& s);
+    static void end_write(Slot& s);
+
+    Slot slots_[kCapacity];
+};
+
+// Receives the venue's UDP feed on its own thread and keeps a BookTable
+// current, so the order thread only ever does lock-free reads
+class MarketDataHandler {
+public:
+    ~MarketDataHandler() { stop(); }
+
+    bool start(int port);
+    void stop();
+
+    const BookTable& books() const { return books_; }
+
+    uint64_t applied() const { return applied_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    BookTable books_;
+    int fd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+
+    std::atomic<uint64_t> applied_{0};
+    std::atomic<uint64_t> dropped_{0}; // Stale or unparseable updates
+};
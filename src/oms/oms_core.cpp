@@ -0,0 +1,1055 @@
+#include "oms/oms_core.h"
+
+#include "common/clock.h"
+#include "common/messages.h"
+#include "common/session.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+// Everything the OMS exports on the stats endpoint, registered once at startup
+struct OmsCore::Metrics {
+    // Venue -> OMS by kind
+    metrics::Counter in_ack = metrics::counter("oms_msgs_in_total", "kind=\"ACK\"");
+    metrics::Counter in_fill = metrics::counter("oms_msgs_in_total", "kind=\"FILL\"");
+    metrics::Counter in_cancelled = metrics::counter("oms_msgs_in_total", "kind=\"CANCELLED\"");
+    metrics::Counter in_replaced = metrics::counter("oms_msgs_in_total", "kind=\"REPLACED\"");
+    metrics::Counter in_reject = metrics::counter("oms_msgs_in_total", "kind=\"REJECT\"");
+    metrics::Counter in_status = metrics::counter("oms_msgs_in_total", "kind=\"ORDER_STATUS\"");
+    metrics::Counter in_other = metrics::counter("oms_msgs_in_total", "kind=\"OTHER\"");
+
+    // OMS -> venue by kind
+    metrics::Counter out_new = metrics::counter("oms_msgs_out_total", "kind=\"NEW\"");
+    metrics::Counter out_cancel = metrics::counter("oms_msgs_out_total", "kind=\"CANCEL\"");
+    metrics::Counter out_mass_cancel = metrics::counter("oms_msgs_out_total", "kind=\"MASS_CANCEL\"");
+    metrics::Counter out_replace = metrics::counter("oms_msgs_out_total", "kind=\"REPLACE\"");
+
+    metrics::Counter risk_rejects[kRejectCodeCount]; // By RejectCode
+    metrics::Counter venue_rejects = metrics::counter("oms_rejects_total", "reason=\"VENUE\"");
+
+    metrics::Gauge open_orders = metrics::gauge("oms_open_orders");
+    metrics::Gauge realized_pnl = metrics::gauge("oms_realized_pnl");
+    std::unordered_map<std::string, metrics::Gauge> position; // By symbol, added on first fill
+
+    metrics::Histogram risk_check_ns = metrics::histogram("oms_risk_check_ns");
+    metrics::Histogram venue_msg_ns = metrics::histogram("oms_venue_msg_handle_ns");
+    metrics::Histogram venue_rx_wait_ns = metrics::histogram("oms_venue_rx_wait_ns"); // Kernel receive -> handled
+    metrics::Histogram submit_to_wire_ns = metrics::histogram("oms_submit_to_wire_ns"); // In-process entry
+
+    Metrics() {
+        for (int i = 1; i < kRejectCodeCount; i++) {
+            std::string labels = std::string("reason=\"RISK_") + to_string((RejectCode)i) + "\"";
+            risk_rejects[i] = metrics::counter("oms_rejects_total", labels.c_str());
+        }
+    }
+
+    void on_position(const std::string& symbol, const PositionTracker& pos, const PositionBook& book) {
+        auto it = position.find(symbol);
+        if (it == position.end()) {
+            std::string labels = "symbol=\"" + symbol + "\"";
+            it = position.emplace(symbol, metrics::gauge("oms_position", labels.c_str())).first;
+        }
+        it->second.set((double)pos.position());
+        realized_pnl.set(book.realized_pnl());
+    }
+};
+
+// Positions and marks in the shared-memory state are refreshed this often;
+// the summary goes out every loop pass, fills right away
+constexpr int64_t kStateRefreshNs = 100'000'000;
+
+// Reconnect schedule: first retry right away, then doubling up to a cap
+struct Backoff {
+    static constexpr int kFirstMs = 100;
+    static constexpr int kMaxMs = 5000;
+
+    int64_t next_ns = 0;
+    int delay_ms = 0;
+    int attempts = 0;
+
+    void reset() {
+        next_ns = 0;
+        delay_ms = 0;
+        attempts = 0;
+    }
+
+    void failed(int64_t now_ns) {
+        attempts++;
+        delay_ms = delay_ms ? std::min(delay_ms * 2, kMaxMs) : kFirstMs;
+        next_ns = now_ns + (int64_t)delay_ms * 1'000'000;
+    }
+
+    // ms until the next attempt, for the poll timeout
+    int wait_ms(int64_t now_ns) const {
+        return (next_ns <= now_ns) ? 0 : (int)((next_ns - now_ns + 999'999) / 1'000'000);
+    }
+};
+
+// One venue: where it is, its session and its share of the metrics
+struct OmsCore::VenueLink {
+    int index = 0;
+    std::string ip;
+    int port = 0;
+    std::string name; // Session log prefix, must outlive the session
+
+    Session session;
+    Backoff backoff;
+
+    // ORDER_STATUS lines collected until ORDER_STATUS_END
+    std::vector<VenueOrderStatus> snapshot;
+    int64_t sync_started_ns = 0;
+    uint64_t sync_mark = 0; // OrderStore::request_mark() when ORDER_STATUS_ALL went out
+
+    metrics::Counter reconnects;
+    metrics::Counter routed_qty;
+    metrics::Gauge up;
+    metrics::Gauge fill_ratio;
+    metrics::Histogram ack_latency_ns;
+
+    VenueLink(int i, const std::string& ip_, int port_)
+        : index(i), ip(ip_), port(port_), name("oms[" + std::to_string(i) + "]"), session(session_opts(name)) {
+        std::string labels = "venue=\"" + std::to_string(i) + "\"";
+        reconnects = metrics::counter("oms_venue_reconnects_total", labels.c_str());
+        routed_qty = metrics::counter("oms_routed_qty_total", labels.c_str());
+        up = metrics::gauge("oms_venue_up", labels.c_str());
+        fill_ratio = metrics::gauge("oms_venue_fill_ratio", labels.c_str());
+        ack_latency_ns = metrics::histogram("oms_new_to_ack_ns", labels.c_str());
+    }
+
+    static Session::Options session_opts(const std::string& name) {
+        Session::Options o;
+        o.name = name.c_str();
+        return o;
+    }
+};
+
+// Waits until user_fd or a venue has input, false on a poll error
+// Socket transports poll every fd. Shared memory has no fd, so the other
+// fds are polled without blocking and the ring is waited on for a short
+// slice. wake_fds (a finished config reload, queued order entry) only
+// interrupt the wait, and timeout_ms (-1 = none) bounds it so session
+// timers keep running. Entries of venues are null while that venue is
+// disconnected. fds is scratch owned by the caller so waiting never allocates.
+static bool wait_for_input(const std::vector<Connection*>& venues, int user_fd, const std::vector<int>& wake_fds,
+                           int timeout_ms, bool& user_ready, std::vector<char>& venue_ready,
+                           std::vector<pollfd>& fds) {
+    // Lines already buffered don't show up in poll(); the caller checks
+    // its own (e.g. std::cin's) and passes timeout_ms 0
+    bool any = false;
+    bool shm = false;
+    venue_ready.assign(venues.size(), 0);
+    for (size_t i = 0; i < venues.size(); i++) {
+        if (!venues[i]) continue;
+        // Held-back writes go out before we sleep (a write error shows up as EOF)
+        venues[i]->flush();
+        venue_ready[i] = venues[i]->has_line();
+        any = any || venue_ready[i];
+        shm = shm || venues[i]->fd() < 0;
+    }
+    if (any) return true;
+
+    // Negative fds are skipped by poll()
+    const size_t first_venue = 1 + wake_fds.size();
+    fds.resize(first_venue + venues.size());
+    fds[0] = {user_fd, POLLIN, 0};
+    for (size_t i = 0; i < wake_fds.size(); i++) fds[1 + i] = {wake_fds[i], POLLIN, 0};
+    for (size_t i = 0; i < venues.size(); i++) {
+        fds[first_venue + i] = {venues[i] ? venues[i]->fd() : -1, POLLIN, 0};
+    }
+
+    int rc = ::poll(fds.data(), fds.size(), shm ? 0 : timeout_ms);
+    if (rc < 0) {
+        if (errno == EINTR) return true;
+        std::cerr << "poll() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // HUP/ERR too, so EOF gets read and handled instead of spinning
+    const short ready_mask = POLLIN | POLLHUP | POLLERR;
+    user_ready = (fds[0].revents & ready_mask) != 0;
+    for (size_t i = 0; i < venues.size(); i++) {
+        if (!venues[i]) continue;
+        if (venues[i]->fd() >= 0) venue_ready[i] = (fds[first_venue + i].revents & ready_mask) != 0;
+        else venue_ready[i] = venues[i]->wait_readable((user_ready || timeout_ms == 0) ? 0 : 1);
+    }
+    return true;
+}
+
+static OmsOptions with_defaults(OmsOptions o) {
+    if (o.venues.empty()) o.venues.emplace_back("127.0.0.1", 9001);
+    return o;
+}
+
+OmsCore::OmsCore(const OmsOptions& opts)
+    : opts_(with_defaults(opts)),
+      log_(opts_.log ? opts_.log : &null_log_),
+      om_(std::make_unique<Metrics>()),
+      risk_path_(opts_.risk_path),
+      router_((int)opts_.venues.size(), opts_.route),
+      algos_(store_) {
+    store_.set_log(opts_.log);
+    store_.reserve((size_t)std::max(opts_.max_orders, 0));
+    for (size_t i = 0; i < opts_.venues.size(); i++) {
+        venues_.push_back(std::make_unique<VenueLink>((int)i, opts_.venues[i].first, opts_.venues[i].second));
+    }
+    conns_.resize(venues_.size());
+    wake_fds_ = {risk_loader_.notify_fd(), entry_.notify_fd()};
+}
+
+OmsCore::~OmsCore() = default;
+
+bool OmsCore::start() {
+    if (opts_.transport.kind == TransportKind::Shm && venues_.size() > 1) {
+        std::cerr << "oms: shm transport supports a single venue\n";
+        return false;
+    }
+
+    // Startup config is loaded synchronously; later reloads go through the loader
+    if (!risk_path_.empty()) {
+        std::string err;
+        if (!load_risk_config(risk_path_, risk_cfg_, err)) {
+            std::cerr << "oms: risk config: " << err << "\n";
+            return false;
+        }
+        log() << "oms: risk config " << risk_path_ << " symbol_overrides=" << risk_cfg_.per_symbol.size() << "\n";
+    }
+
+    // Before any order, so the kill switch of an earlier run holds from the start
+    if (!opts_.state_shm.empty()) {
+        state_ = std::make_unique<StatePublisher>();
+        if (!state_->open(opts_.state_shm)) {
+            std::cerr << "oms: cannot publish state to shm " << opts_.state_shm << "\n";
+            return false;
+        }
+        risk_state_.kill_switch = state_->kill_switch();
+        kill_seen_ = state_->kill_active();
+        log() << "oms: state on shm " << opts_.state_shm
+              << (kill_seen_ ? ", kill switch ON, new orders refused" : "") << "\n";
+    }
+
+    // One sequenced session per venue; LOGON makes a venue replay anything
+    // we haven't seen. A venue that isn't up yet is retried like a lost one
+    int connected = 0;
+    for (auto& vp : venues_) {
+        VenueLink& vl = *vp;
+        std::unique_ptr<Connection> conn = connect_transport(opts_.transport, vl.ip.c_str(), vl.port);
+        if (!conn) {
+            vl.backoff.failed(mono_ns());
+            continue;
+        }
+        vl.session.attach(std::move(conn));
+        vl.session.logon();
+        router_.set_up(vl.index, true);
+        vl.up.set(1.0);
+        connected++;
+
+        if (opts_.transport.kind == TransportKind::Shm) {
+            log() << "oms: connected to shm " << opts_.transport.shm_name << "\n";
+        } else if (venues_.size() == 1) {
+            log() << "oms: connected to " << vl.ip << ":" << vl.port << "\n";
+        } else {
+            log() << "oms: venue " << vl.index << " connected to " << vl.ip << ":" << vl.port << "\n";
+        }
+    }
+    if (connected == 0) {
+        std::cerr << "oms: no venue reachable\n";
+        return false;
+    }
+
+    if (!ledger_.open(opts_.ledger_path)) {
+        std::cerr << "oms: cannot continue without ledger\n";
+        return false;
+    }
+    log() << "oms: ledger=" << opts_.ledger_path << "\n";
+
+    // Feed thread; the order loop only reads its books
+    if (opts_.md_port > 0) {
+        if (md_.start(opts_.md_port)) log() << "oms: market data on udp 127.0.0.1:" << opts_.md_port << "\n";
+        else std::cerr << "oms: market data disabled\n";
+    }
+    if (opts_.metrics_port > 0) {
+        if (stats_.start(opts_.metrics_port)) {
+            log() << "oms: metrics on http://127.0.0.1:" << opts_.metrics_port << "/metrics\n";
+        } else {
+            std::cerr << "oms: metrics endpoint disabled\n";
+        }
+    }
+    return true;
+}
+
+// Venue link recovery: lines sent while down wait in the session buffer,
+// and each reconnect ends with an order status snapshot to reconcile
+void OmsCore::venue_lost(VenueLink& vl, const char* why) {
+    std::cerr << "oms: venue " << vl.index << ": " << why << ", reconnecting\n";
+    vl.session.detach();
+    vl.backoff.reset();
+    router_.set_up(vl.index, false);
+    vl.up.set(0.0);
+}
+
+void OmsCore::request_sync(VenueLink& vl) {
+    WireBuf wire;
+    encode_msg(make_order_status_all(), wire);
+    vl.snapshot.clear();
+    vl.sync_started_ns = mono_ns();
+    vl.sync_mark = store_.request_mark();
+    if (!vl.session.send(wire.view())) venue_lost(vl, "venue write failed");
+}
+
+void OmsCore::send_to(int venue, std::string_view lines, const char* what) {
+    VenueLink& vl = *venues_[(size_t)venue];
+    if (!vl.session.send(lines)) venue_lost(vl, what);
+}
+
+void OmsCore::on_routed(int venue, int qty) {
+    router_.on_routed(venue, qty);
+    venues_[(size_t)venue]->routed_qty.inc((uint64_t)qty);
+}
+
+void OmsCore::watch(int client_id, OrderCallback cb, void* ctx, uint64_t tag) {
+    if (cb) entry_.watch(client_id, cb, ctx, tag);
+    else entry_.watch(client_id, on_event_, on_event_ctx_, 0);
+}
+
+void OmsCore::set_event_handler(OrderCallback cb, void* ctx) {
+    on_event_ = cb;
+    on_event_ctx_ = ctx;
+}
+
+RejectCode OmsCore::submit_order(int client_id, const std::string& symbol, Side side, int qty, double price,
+                                 int64_t submit_ns) {
+    // Store first so we can print/reject consistently
+    store_.add_pending_new(client_id, symbol, side, qty, price);
+
+    // The line is built before the risk gate, so an order that can't go
+    // out spends no tokens. Valid until the next NEW for this symbol and side
+    WireBuf fallback;
+    std::string_view line = templates_.new_line(symbol, side, client_id, qty, price, fallback);
+    if (line.empty()) {
+        store_.mark_rejected(client_id, RejectCode::BadInput);
+        log() << "oms: REJECT client_id=" << client_id << " reason=NEW does not encode\n";
+        store_.print_one(client_id, log());
+        return RejectCode::BadInput;
+    }
+
+    // Route: one slice goes out as the order itself, more
+    // become child orders of it, one NEW per venue
+    router_.route(qty, slices_);
+
+    // Participant-side risk gate before sending to the venue. A split
+    // order is checked as the open orders and tokens of all its children
+    int64_t t0 = mono_ns();
+    RejectCode rc = check_new_order(risk_cfg_, risk_state_, store_, positions_.get(symbol), symbol,
+                                    side, qty, price, t0, (int)slices_.size());
+    om_->risk_check_ns.record((uint64_t)(mono_ns() - t0));
+    if (rc != RejectCode::None) {
+        om_->risk_rejects[(int)rc].inc();
+        store_.mark_rejected(client_id, rc);
+        log() << "oms: RISK_REJECT client_id=" << client_id << " reason=RISK_" << to_string(rc) << "\n";
+        store_.print_one(client_id, log());
+        return rc;
+    }
+
+    if (slices_.size() == 1) {
+        store_.set_venue(client_id, slices_[0].venue);
+        // Stamped before the write: the ACK may be read back while send() is still returning
+        store_.set_sent_ns(client_id, mono_ns());
+        send_to(slices_[0].venue, line, "failed to send NEW");
+        if (submit_ns) om_->submit_to_wire_ns.record((uint64_t)(mono_ns() - submit_ns));
+        on_routed(slices_[0].venue, qty);
+        om_->out_new.inc();
+        log() << "oms: sent: " << line;
+        return rc;
+    }
+
+    int first_child = next_id_;
+    next_id_ += (int)slices_.size();
+    store_.split(client_id, first_child, slices_);
+    log() << "oms: routed client_id=" << client_id << " qty=" << qty << " as";
+    size_t sent = 0;
+    for (size_t i = 0; i < slices_.size(); i++) {
+        int child_id = first_child + (int)i;
+        line = templates_.new_line(symbol, side, child_id, slices_[i].qty, price, fallback);
+        if (line.empty()) {
+            store_.mark_rejected(child_id, RejectCode::BadInput);
+            log() << " " << child_id << "=REJECT(NEW does not encode)";
+            continue;
+        }
+        store_.set_sent_ns(child_id, mono_ns());
+        send_to(slices_[i].venue, line, "failed to send NEW");
+        on_routed(slices_[i].venue, slices_[i].qty);
+        sent++;
+        log() << " " << child_id << "@venue" << slices_[i].venue << "=" << slices_[i].qty;
+    }
+    if (submit_ns) om_->submit_to_wire_ns.record((uint64_t)(mono_ns() - submit_ns));
+    om_->out_new.inc(sent);
+    log() << "\n";
+    return rc;
+}
+
+int OmsCore::submit(const std::string& symbol, Side side, int qty, double price,
+                    OrderCallback cb, void* ctx, uint64_t tag) {
+    int client_id = next_id_++;
+    RejectCode rc = submit_order(client_id, symbol, side, qty, price, 0);
+    if (rc != RejectCode::None) entry_.reject(client_id, rc, cb ? cb : on_event_, cb ? ctx : on_event_ctx_, tag);
+    else watch(client_id, cb, ctx, tag);
+    return client_id;
+}
+
+bool OmsCore::cancel(int client_id) {
+    // The throttle only sees cancels that go out
+    auto throttled = [&] {
+        RejectCode rc = check_cancel(risk_cfg_, risk_state_, mono_ns());
+        if (rc == RejectCode::None) return false;
+        om_->risk_rejects[(int)rc].inc();
+        log() << "oms: RISK_REJECT cancel client_id=" << client_id << " reason=RISK_" << to_string(rc) << "\n";
+        return true;
+    };
+
+    // A parent is cancelled through its open children; an algo
+    // also stops releasing new ones
+    const Order* o = store_.get(client_id);
+    if (o && o->is_parent) {
+        if (store_.has_cancellable_children(client_id) && throttled()) return false;
+        bool was_working = algos_.active(client_id);
+        algos_.stop(client_id);
+        std::vector<int> ids = store_.request_cancel_children(client_id);
+        for (int id : ids) {
+            WireBuf wire;
+            if (!encode_msg(make_cancel(id), wire)) {
+                log() << "oms: WARN CANCEL does not encode client_id=" << id << "\n";
+                continue;
+            }
+            send_to(store_.get(id)->venue, wire.view(), "failed to send CANCEL");
+            om_->out_cancel.inc();
+            log() << "oms: sent: " << wire.view();
+        }
+        if (ids.empty() && !was_working) log() << "oms: WARN no open children to cancel\n";
+        store_.print_one(client_id, log());
+        return !ids.empty() || was_working;
+    }
+
+    // Encoded before the store moves the order to PendingCancel
+    WireBuf wire;
+    if (!encode_msg(make_cancel(client_id), wire)) {
+        log() << "oms: WARN CANCEL does not encode client_id=" << client_id << "\n";
+        return false;
+    }
+    if (!store_.can_cancel(client_id)) {
+        store_.print_one(client_id, log());
+        return false;
+    }
+    if (throttled()) return false;
+    store_.request_cancel(client_id);
+
+    send_to(o->venue, wire.view(), "failed to send CANCEL");
+    om_->out_cancel.inc();
+    log() << "oms: sent: " << wire.view();
+    store_.print_one(client_id, log());
+    return true;
+}
+
+bool OmsCore::replace(int client_id, int qty, double price) {
+    const Order* o = store_.get(client_id);
+    if (!o) {
+        store_.print_one(client_id, log());
+        return false;
+    }
+
+    // Validated before the risk chain, whose rate rule takes a token
+    if (!store_.can_replace(client_id, qty)) {
+        store_.print_one(client_id, log());
+        return false;
+    }
+
+    // A failed amend leaves the live order untouched
+    RejectCode rc = check_replace(risk_cfg_, risk_state_, positions_.get(o->symbol), *o, qty, price, mono_ns());
+    if (rc != RejectCode::None) {
+        om_->risk_rejects[(int)rc].inc();
+        log() << "oms: RISK_REJECT replace client_id=" << client_id << " reason=RISK_" << to_string(rc) << "\n";
+        store_.print_one(client_id, log());
+        return false;
+    }
+
+    WireBuf wire;
+    if (!encode_msg(make_replace(client_id, qty, price), wire)) {
+        log() << "oms: WARN REPLACE does not encode client_id=" << client_id << "\n";
+        return false;
+    }
+    if (!store_.request_replace(client_id, qty, price)) {
+        store_.print_one(client_id, log());
+        return false;
+    }
+
+    send_to(o->venue, wire.view(), "failed to send REPLACE");
+    om_->out_replace.inc();
+    log() << "oms: sent: " << wire.view();
+    store_.print_one(client_id, log());
+    return true;
+}
+
+int OmsCore::cancel_all(const std::string& symbol, const Side* side) {
+    WireBuf wire;
+    if (!encode_msg(make_mass_cancel(symbol, side ? to_string(*side) : ""), wire)) {
+        log() << "oms: WARN MASS_CANCEL does not encode symbol=" << symbol << "\n";
+        return -1;
+    }
+
+    // A token only when a MASS_CANCEL goes out; stopping algos sends nothing
+    if (store_.has_cancellable(symbol, side)) {
+        RejectCode rc = check_cancel(risk_cfg_, risk_state_, mono_ns());
+        if (rc != RejectCode::None) {
+            om_->risk_rejects[(int)rc].inc();
+            log() << "oms: RISK_REJECT cancel_all reason=RISK_" << to_string(rc) << "\n";
+            return -1;
+        }
+    }
+
+    // Matching algos stop first, so nothing refills what is cancelled
+    int stopped = algos_.stop_all(symbol, side);
+    if (stopped > 0) log() << "oms: CANCEL_ALL stopped algos=" << stopped << "\n";
+
+    std::vector<int> ids = store_.request_cancel_all(symbol, side);
+    if (ids.empty()) {
+        if (stopped == 0) log() << "oms: CANCEL_ALL nothing to cancel\n";
+        return 0;
+    }
+
+    // One MASS_CANCEL to each venue holding any of them
+    std::vector<char> hit(venues_.size(), 0);
+    for (int id : ids) hit[(size_t)store_.get(id)->venue] = 1;
+
+    for (size_t v = 0; v < venues_.size(); v++) {
+        if (!hit[v]) continue;
+        send_to((int)v, wire.view(), "failed to send MASS_CANCEL");
+        om_->out_mass_cancel.inc();
+        if (venues_.size() > 1) log() << "oms: sent to venue " << v << ": " << wire.view();
+        else log() << "oms: sent: " << wire.view();
+    }
+    log() << "oms: CANCEL_ALL pending_cancel=" << ids.size() << "\n";
+    return (int)ids.size();
+}
+
+int OmsCore::submit_basket(const std::vector<OrderRequest>& legs) {
+    if (legs.empty()) return 0;
+
+    int first_id = next_id_;
+    next_id_ += (int)legs.size();
+    int last_id = next_id_ - 1;
+
+    store_.add_pending_batch(first_id, legs);
+
+    // Every NEW coalesced into a single write. Encoded ahead of the risk
+    // pass: a basket with a leg that doesn't fit goes nowhere
+    std::string wire(legs.size() * kMaxMsgLen, '\0');
+    size_t used = 0;
+    for (size_t i = 0; i < legs.size(); i++) {
+        const OrderRequest& r = legs[i];
+        Msg m = make_new(first_id + (int)i, r.symbol, to_string(r.side), r.qty, r.price);
+        size_t n = encode_msg(m, &wire[used], kMaxMsgLen);
+        if (n == 0) {
+            for (int id = first_id; id <= last_id; id++) store_.mark_rejected(id, RejectCode::BadInput);
+            log() << "oms: REJECT basket client_ids=" << first_id << ".." << last_id << " leg=" << i
+                  << " reason=NEW does not encode\n";
+            return 0;
+        }
+        used += n;
+    }
+    wire.resize(used);
+
+    // One risk pass for the whole basket
+    BasketRiskResult res = check_basket(risk_cfg_, risk_state_, store_, positions_, legs, mono_ns());
+    if (res.code != RejectCode::None) {
+        om_->risk_rejects[(int)res.code].inc(legs.size());
+        for (int id = first_id; id <= last_id; id++) store_.mark_rejected(id, res.code);
+        log() << "oms: RISK_REJECT basket client_ids=" << first_id << ".." << last_id
+              << " reason=RISK_" << to_string(res.code);
+        if (res.leg >= 0) log() << " leg=" << res.leg;
+        log() << "\n";
+        return 0;
+    }
+
+    // The basket goes whole to the best venue
+    const int bv = router_.best();
+    int64_t sent = mono_ns();
+    send_to(bv, wire, "failed to send BASKET");
+    for (int id = first_id; id <= last_id; id++) {
+        store_.set_venue(id, bv);
+        store_.set_sent_ns(id, sent);
+        watch(id, nullptr, nullptr, 0);
+    }
+    for (const OrderRequest& r : legs) on_routed(bv, r.qty);
+    om_->out_new.inc(legs.size());
+    log() << "oms: sent basket legs=" << legs.size() << " client_ids=" << first_id << ".." << last_id
+          << " bytes=" << wire.size() << "\n";
+    return first_id;
+}
+
+int OmsCore::start_algo(const std::string& symbol, Side side, int qty, double price, const AlgoParams& p) {
+    // Children are risk-checked one by one as they go out
+    int parent_id = next_id_++;
+    store_.add_parent(parent_id, symbol, side, qty, price);
+    watch(parent_id, nullptr, nullptr, 0);
+    algos_.start(parent_id, p, mono_ns(), slice_reqs_);
+    log() << "oms: " << to_string(p.kind) << " client_id=" << parent_id << " " << to_string(side) << " " << qty
+          << " @ " << price;
+    if (p.kind == AlgoKind::Twap) {
+        log() << " slices=" << p.slices << " over " << p.duration_ns / 1'000'000 << "ms";
+    } else {
+        log() << " display=" << p.display_qty;
+    }
+    log() << " active_algos=" << algos_.active_count() << "\n";
+    send_slices();
+    return parent_id;
+}
+
+// Algo parents: the engine asks for child slices, and each one is
+// risk-checked, routed and sent here
+void OmsCore::send_slices() {
+    for (const SliceRequest& r : slice_reqs_) {
+        const Order* p = store_.get(r.parent_id);
+        if (!p) continue;
+        // Copied: adding the child may move the parent
+        const std::string symbol = p->symbol;
+        const Side side = p->side;
+        const double price = p->price;
+
+        int child_id = next_id_++;
+        int v = router_.best();
+        store_.add_child(r.parent_id, child_id, v, r.qty);
+
+        int64_t t0 = mono_ns();
+        RejectCode rc = check_new_order(risk_cfg_, risk_state_, store_, positions_.get(symbol), symbol,
+                                        side, r.qty, price, t0);
+        om_->risk_check_ns.record((uint64_t)(mono_ns() - t0));
+        if (rc != RejectCode::None) {
+            om_->risk_rejects[(int)rc].inc();
+            store_.mark_rejected(child_id, rc);
+            algos_.on_slice_refused(r.parent_id, r.qty, t0);
+            log() << "oms: RISK_REJECT client_id=" << child_id << " parent=" << r.parent_id
+                  << " reason=RISK_" << to_string(rc) << "\n";
+            continue;
+        }
+
+        WireBuf fallback;
+        std::string_view line = templates_.new_line(symbol, side, child_id, r.qty, price, fallback);
+        if (line.empty()) {
+            store_.mark_rejected(child_id, RejectCode::BadInput);
+            algos_.on_slice_refused(r.parent_id, r.qty, t0);
+            log() << "oms: REJECT client_id=" << child_id << " parent=" << r.parent_id
+                  << " reason=NEW does not encode\n";
+            continue;
+        }
+        store_.set_sent_ns(child_id, mono_ns());
+        send_to(v, line, "failed to send NEW");
+        on_routed(v, r.qty);
+        om_->out_new.inc();
+        algos_.on_slice_sent(r.parent_id, child_id, r.qty);
+        log() << "oms: sent: " << line;
+    }
+    slice_reqs_.clear();
+}
+
+bool OmsCore::arm_symbol(const std::string& symbol) {
+    return templates_.arm(symbol);
+}
+
+void OmsCore::set_ref_price(const std::string& symbol, double px) {
+    risk_state_.ref_px[symbol] = px;
+    log() << "oms: reference price " << symbol << "=" << px
+          << " band=+/-" << risk_cfg_.limits(symbol).price_band_pct << "%\n";
+}
+
+bool OmsCore::reload_risk(const std::string& path) {
+    const std::string& p = path.empty() ? risk_path_ : path;
+    if (p.empty() || !risk_loader_.start(p)) return false;
+    log() << "oms: reloading risk config from " << p << "\n";
+    return true;
+}
+
+void OmsCore::sync() {
+    for (auto& vp : venues_) {
+        if (!vp->session.connection()) {
+            log() << "oms: venue " << vp->index << " down, a sync runs after reconnect\n";
+            continue;
+        }
+        request_sync(*vp);
+        log() << "oms: sent to venue " << vp->index << ": ORDER_STATUS_ALL\n";
+    }
+}
+
+void OmsCore::print_order(int client_id) const {
+    store_.print_one(client_id, log());
+}
+
+void OmsCore::print_status() const {
+    std::ostream& out = log();
+    out << "oms: STATUS\n";
+    const PositionTracker& abc = positions_.get("ABC");
+    out << "  position(ABC)=" << abc.position() << "\n";
+    out << "  avg_cost(ABC)=" << abc.avg_cost() << "\n";
+    for (const auto& kv : positions_.all()) {
+        if (kv.first == "ABC") continue;
+        out << "  position(" << kv.first << ")=" << kv.second.position()
+            << " avg_cost=" << kv.second.avg_cost() << "\n";
+    }
+    out << "  realized_pnl=" << positions_.realized_pnl() << "\n";
+
+    // Unrealized needs a mark; symbols with no market data are skipped
+    double unrealized = 0.0;
+    for (const auto& kv : positions_.all()) {
+        TopOfBook tob;
+        if (!md_.books().read(kv.first, tob) || tob.mark() <= 0.0) continue;
+        double u = kv.second.unrealized_pnl(tob.mark());
+        unrealized += u;
+        out << "  mark(" << kv.first << ")=" << tob.mark()
+            << " bid=" << tob.bid_px << " ask=" << tob.ask_px
+            << " unrealized=" << u << "\n";
+    }
+    out << "  unrealized_pnl=" << unrealized << "\n";
+    out << "  md: applied=" << md_.applied() << " dropped=" << md_.dropped() << "\n";
+    out << "  open_orders=" << store_.open_orders_count() << "\n";
+    const RiskConfig& cfg = risk_cfg_;
+    out << "  limits: max_order_qty=" << cfg.defaults.max_order_qty
+        << " max_notional=" << cfg.defaults.max_notional
+        << " max_open_orders=" << cfg.max_open_orders
+        << " max_abs_position=" << cfg.defaults.max_abs_position
+        << " symbol_overrides=" << cfg.per_symbol.size()
+        << "\n";
+    out << "  throttles: price_band_pct=" << cfg.defaults.price_band_pct
+        << " orders_per_sec=" << cfg.max_orders_per_sec << "/" << cfg.order_burst
+        << " cancels_per_sec=" << cfg.max_cancels_per_sec << "/" << cfg.cancel_burst
+        << "\n";
+    for (int v = 0; v < router_.venues(); v++) {
+        const VenueStats& vs = router_.stats(v);
+        out << "  venue " << v << ": " << (vs.up ? "up" : "down")
+            << " ack_us=" << vs.ack_ewma_ns / 1000.0
+            << " fill_ratio=" << vs.fill_ratio()
+            << " score=" << router_.score(v)
+            << "\n";
+    }
+    out << "  algos: active=" << algos_.active_count() << "\n";
+    if (state_) {
+        out << "  state_shm=" << opts_.state_shm << " symbols=" << state_->symbols()
+            << " kill_switch=" << (state_->kill_active() ? "ON" : "off") << "\n";
+    }
+}
+
+void OmsCore::drain_entry() {
+    // Bounded per pass so venue input keeps up under a flood
+    EntryRequest req;
+    for (int n = 0; n < 256 && entry_.pop(req); n++) {
+        if (req.kind == EntryRequest::Kind::Cancel) {
+            if (!cancel(req.client_id)) entry_.cancel_rejected(store_, req.client_id);
+            continue;
+        }
+        int client_id = next_id_++;
+        const std::string symbol(req.symbol_view());
+        RejectCode rc = submit_order(client_id, symbol, req.side, req.qty, req.price, req.submit_ns);
+        if (rc != RejectCode::None) entry_.reject(client_id, rc, req.cb, req.ctx, req.tag);
+        else watch(client_id, req.cb, req.ctx, req.tag);
+    }
+}
+
+void OmsCore::reconnect(VenueLink& vl) {
+    std::unique_ptr<Connection> c = connect_transport(opts_.transport, vl.ip.c_str(), vl.port);
+    if (!c) {
+        vl.backoff.failed(mono_ns());
+        log() << "oms: venue " << vl.index << " reconnect failed, retry in " << vl.backoff.delay_ms << "ms\n";
+        return;
+    }
+    log() << "oms: venue " << vl.index << " reconnected after " << (vl.backoff.attempts + 1) << " attempt(s)\n";
+    vl.reconnects.inc();
+    vl.session.attach(std::move(c));
+    vl.session.logon();
+    router_.set_up(vl.index, true);
+    vl.up.set(1.0);
+    request_sync(vl);
+    vl.backoff.reset();
+}
+
+bool OmsCore::poll(int timeout_ms) {
+    bool user_ready = false;
+    return poll(timeout_ms, -1, user_ready);
+}
+
+bool OmsCore::poll(int timeout_ms, int user_fd, bool& user_ready) {
+    user_ready = false;
+    om_->open_orders.set((double)store_.open_orders_count());
+
+    // Single-threaded: wait on every venue connection, no longer than the
+    // nearest session timer, reconnect attempt or algo slice
+    int64_t now = mono_ns();
+    int wait_ms = timeout_ms;
+    for (size_t i = 0; i < venues_.size(); i++) {
+        VenueLink& vl = *venues_[i];
+        conns_[i] = vl.session.connection();
+        int ms = conns_[i] ? vl.session.timer_ms(now) : vl.backoff.wait_ms(now);
+        if (wait_ms < 0 || ms < wait_ms) wait_ms = ms;
+    }
+    int algo_ms = algos_.timer_ms(now);
+    if (algo_ms >= 0 && (wait_ms < 0 || algo_ms < wait_ms)) wait_ms = algo_ms;
+    if (state_) {
+        int state_ms = (next_state_ns_ <= now) ? 0 : (int)((next_state_ns_ - now + 999'999) / 1'000'000);
+        if (wait_ms < 0 || state_ms < wait_ms) wait_ms = state_ms;
+    }
+    if (!entry_.prepare_wait()) wait_ms = 0;
+    if (!wait_for_input(conns_, user_fd, wake_fds_, wait_ms, user_ready, venue_ready_, poll_fds_)) return false;
+    entry_.drain_wakeup();
+
+    for (size_t i = 0; i < venues_.size(); i++) {
+        VenueLink& vl = *venues_[i];
+
+        // Heartbeats out; a venue that has gone silent counts as disconnected
+        if (vl.session.connection() && !vl.session.on_timer(mono_ns())) {
+            venue_lost(vl, "venue heartbeat timeout");
+            venue_ready_[i] = 0;
+        }
+        if (!vl.session.connection() && mono_ns() >= vl.backoff.next_ns) reconnect(vl);
+    }
+
+    // ---- algo slices due ----
+    algos_.on_timer(mono_ns(), slice_reqs_);
+    send_slices();
+
+    // ---- in-process order entry ----
+    drain_entry();
+
+    // ---- risk config reload ----
+    if (auto res = risk_loader_.take()) {
+        if (res->cfg) {
+            // Swap in whole; throttle buckets and reference prices carry over
+            risk_cfg_ = std::move(*res->cfg);
+            risk_path_ = res->path;
+            log() << "oms: risk config reloaded from " << res->path
+                  << " symbol_overrides=" << risk_cfg_.per_symbol.size() << "\n";
+        } else {
+            log() << "oms: risk config reload failed, keeping current limits: " << res->error << "\n";
+        }
+    }
+
+    // Venue connections, one line from each that has input
+    for (size_t vi = 0; vi < venues_.size(); vi++) {
+        VenueLink& vl = *venues_[vi];
+        if (!venue_ready_[vi] || !vl.session.connection()) continue;
+
+        Session::ReadResult rr = vl.session.read(line_);
+        if (rr == Session::ReadResult::Closed) {
+            venue_lost(vl, "venue disconnected");
+            continue;
+        }
+        if (rr == Session::ReadResult::Reset) {
+            // Anything queued for the old venue went with the reset;
+            // the snapshot shows which of our orders it doesn't have
+            log() << "oms: WARN venue " << vl.index << " restarted, its view of our orders is gone\n";
+            request_sync(vl);
+            continue;
+        }
+        if (rr == Session::ReadResult::Control) continue;
+        on_venue_line(vl, line_, vl.session.connection()->rx_wall_ns());
+    }
+
+    if (state_) publish_state(mono_ns());
+    return true;
+}
+
+// What a bucket would hold at now_ns; it only refills when it's used
+static double tokens_now(const TokenBucket& b, double rate, double burst, int64_t now_ns) {
+    if (rate <= 0.0 || b.last_ns < 0) return burst;
+    return std::min(burst, b.tokens + (double)std::max<int64_t>(now_ns - b.last_ns, 0) * rate * 1e-9);
+}
+
+void OmsCore::publish_state(int64_t now_ns) {
+    bool kill = state_->kill_active();
+    if (kill != kill_seen_) {
+        kill_seen_ = kill;
+        log() << "oms: kill switch " << (kill ? "ON, new orders refused" : "off") << "\n";
+    }
+
+    if (now_ns >= next_state_ns_) {
+        next_state_ns_ = now_ns + kStateRefreshNs;
+        state_realized_ = positions_.realized_pnl();
+        state_unrealized_ = 0.0;
+        for (const auto& kv : positions_.all()) state_unrealized_ += publish_symbol(kv.first, kv.second);
+    }
+
+    FirmSummary s;
+    s.ts_ns = wall_ns();
+    s.open_orders = store_.open_orders_count();
+    s.max_open_orders = risk_cfg_.max_open_orders;
+    s.realized_pnl = state_realized_;
+    s.unrealized_pnl = state_unrealized_;
+    s.orders_per_sec = risk_cfg_.max_orders_per_sec;
+    s.order_burst = risk_cfg_.order_burst;
+    s.order_tokens = tokens_now(risk_state_.orders, s.orders_per_sec, s.order_burst, now_ns);
+    for (int v = 0; v < router_.venues(); v++) s.venues_up += router_.stats(v).up ? 1 : 0;
+    s.venues = router_.venues();
+    s.kill_active = kill ? 1 : 0;
+    s.symbols = state_->symbols();
+    state_->publish_firm(s);
+}
+
+double OmsCore::publish_symbol(const std::string& symbol, const PositionTracker& pos) {
+    SymbolState s;
+    s.position = pos.position();
+    s.max_abs_position = risk_cfg_.limits(symbol).max_abs_position;
+    s.avg_cost = pos.avg_cost();
+    s.realized_pnl = pos.realized_pnl();
+    TopOfBook tob;
+    if (md_.books().read(symbol, tob) && tob.mark() > 0.0) {
+        s.mark = tob.mark();
+        s.unrealized_pnl = pos.unrealized_pnl(s.mark);
+    }
+    // Past kStateMaxSymbols a symbol is only in the firm totals
+    state_->publish_symbol(symbol, s);
+    return s.unrealized_pnl;
+}
+
+void OmsCore::on_venue_line(VenueLink& vl, const std::string& line, int64_t rx_wall_ns) {
+    // Latencies run to when the kernel had the message, not to when the
+    // loop got to it; the clamp covers a wall clock step in between
+    const int64_t t_handle = mono_ns();
+    const int64_t t_recv = rx_wall_ns ? std::min(wall_to_mono_ns(rx_wall_ns), t_handle) : t_handle;
+    if (rx_wall_ns) om_->venue_rx_wait_ns.record((uint64_t)(t_handle - t_recv));
+    Msg m = parse_msg(line);
+
+    switch (m.kind) {
+        case MsgKind::Ack: {
+            om_->in_ack.inc();
+            log() << "oms: ACK client_id=" << m.client_id << " venue_id=" << m.venue_id << "\n";
+            // First ACK only; the venue id is still unknown until then
+            const Order* o = store_.get(m.client_id);
+            // A kernel stamp converted from the wall clock can land a hair
+            // before sent_ns; clamped so it never wraps to a huge sample
+            if (o && o->venue_id == -1 && o->sent_ns > 0) {
+                const int64_t ack_ns = std::max(t_recv, o->sent_ns) - o->sent_ns;
+                vl.ack_latency_ns.record((uint64_t)ack_ns);
+                router_.on_ack(vl.index, ack_ns);
+            }
+            store_.on_ack(m.client_id, m.venue_id);
+            entry_.on_order_event(store_, m.client_id, OrderEventType::Ack);
+            store_.print_one(m.client_id, log());
+            if (o && o->parent_id) store_.print_one(o->parent_id, log());
+            break;
+        }
+        case MsgKind::Fill: {
+            om_->in_fill.inc();
+            log() << "oms: FILL client_id=" << m.client_id
+                  << " venue_id=" << m.venue_id
+                  << " qty=" << m.qty
+                  << " price=" << m.price
+                  << " liq=" << m.liquidity << "\n";
+
+            const Order* o = store_.get(m.client_id);
+            if (!o) {
+                log() << "oms: WARN fill for unknown order, cannot update pnl/ledger\n";
+            } else {
+                PositionTracker& pos = positions_.at(o->symbol);
+                double realized = pos.on_fill(o->side, m.qty, m.price);
+                om_->on_position(o->symbol, pos, positions_);
+                if (state_) {
+                    state_realized_ += realized;
+                    publish_symbol(o->symbol, pos);
+                }
+
+                ledger_.on_fill(rx_wall_ns ? rx_wall_ns / 1000 : wall_us(), m.client_id, m.venue_id, o->symbol, o->side, m.qty, m.price,
+                                pos.position());
+
+                log() << "oms: position=" << pos.position()
+                      << " avg_cost=" << pos.avg_cost()
+                      << " realized_pnl=" << pos.realized_pnl()
+                      << "\n";
+            }
+
+            store_.on_fill(m.client_id, m.venue_id, m.qty, m.price);
+            entry_.on_order_event(store_, m.client_id, OrderEventType::Fill, m.qty, m.price);
+            store_.print_one(m.client_id, log());
+            if (o) {
+                router_.on_fill(vl.index, m.qty);
+                vl.fill_ratio.set(router_.stats(vl.index).fill_ratio());
+                if (o->parent_id) store_.print_one(o->parent_id, log());
+            }
+            break;
+        }
+        case MsgKind::Cancelled: {
+            om_->in_cancelled.inc();
+            log() << "oms: CANCELLED client_id=" << m.client_id << " venue_id=" << m.venue_id << "\n";
+            store_.on_cancelled(m.client_id, m.venue_id);
+            entry_.on_order_event(store_, m.client_id, OrderEventType::Cancelled);
+            store_.print_one(m.client_id, log());
+            const Order* o = store_.get(m.client_id);
+            if (o && o->parent_id) store_.print_one(o->parent_id, log());
+            break;
+        }
+        case MsgKind::Replaced: {
+            om_->in_replaced.inc();
+            log() << "oms: REPLACED client_id=" << m.client_id
+                  << " venue_id=" << m.venue_id
+                  << " qty=" << m.qty
+                  << " price=" << m.price << "\n";
+            store_.on_replaced(m.client_id, m.venue_id, m.qty, m.price);
+            store_.print_one(m.client_id, log());
+            break;
+        }
+        case MsgKind::Reject: {
+            om_->in_reject.inc();
+            om_->venue_rejects.inc();
+            log() << "oms: REJECT client_id=" << m.client_id << " reason=" << m.reason << "\n";
+            if (m.client_id > 0) {
+                store_.on_venue_reject(m.client_id, "VENUE_" + std::string(m.reason));
+                entry_.on_order_event(store_, m.client_id, OrderEventType::Rejected, 0, 0.0, m.reason);
+                store_.print_one(m.client_id, log());
+                const Order* o = store_.get(m.client_id);
+                if (o && o->parent_id) store_.print_one(o->parent_id, log());
+            }
+            break;
+        }
+        case MsgKind::OrderStatus: {
+            om_->in_status.inc();
+            VenueOrderStatus v;
+            v.client_id = m.client_id;
+            v.venue_id = m.venue_id;
+            v.qty = m.qty;
+            v.price = m.price;
+            vl.snapshot.push_back(v);
+            break;
+        }
+        case MsgKind::OrderStatusEnd: {
+            om_->in_status.inc();
+            if (m.count != (int)vl.snapshot.size()) {
+                log() << "oms: WARN snapshot count mismatch expected=" << m.count
+                      << " got=" << vl.snapshot.size() << "\n";
+            }
+            int64_t t0 = mono_ns();
+            ReconcileResult r = store_.reconcile(vl.index, vl.snapshot, vl.sync_mark);
+            int64_t t1 = mono_ns();
+            log() << "oms: venue " << vl.index << " reconciled venue_live=" << vl.snapshot.size()
+                  << " live=" << r.live << " updated=" << r.updated
+                  << " cancelled=" << r.cancelled << " rejected=" << r.rejected
+                  << " unknown=" << r.unknown
+                  << " reconcile_us=" << (t1 - t0) / 1000
+                  << " sync_us=" << (vl.sync_started_ns ? (t1 - vl.sync_started_ns) / 1000 : 0) << "\n";
+            vl.snapshot.clear();
+            vl.sync_started_ns = 0;
+            algos_.sweep(mono_ns(), slice_reqs_); // Children the reconcile closed
+            entry_.sweep(store_);
+            break;
+        }
+        default: {
+            om_->in_other.inc();
+            log() << "oms: recv(unparsed): " << line << "\n";
+            break;
+        }
+    }
+    // A child that is done refills or finishes its algo parent
+    if (m.kind == MsgKind::Fill || m.kind == MsgKind::Cancelled || m.kind == MsgKind::Reject) {
+        algos_.on_child_update(m.client_id, t_handle, slice_reqs_);
+    }
+    om_->venue_msg_ns.record((uint64_t)(mono_ns() - t_handle));
+    send_slices();
+}
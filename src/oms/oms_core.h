@@ -0,0 +1,180 @@
+#pragma once
+
+#include <poll.h>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/metrics.h"
+#include "common/transport.h"
+#include "oms/algo.h"
+#include "oms/ledger.h"
+#include "oms/market_data.h"
+#include "oms/order_entry.h"
+#include "oms/order_templates.h"
+#include "oms/orders.h"
+#include "oms/positions.h"
+#include "oms/risk.h"
+#include "oms/router.h"
+#include "oms/state_shm.h"
+
+struct OmsOptions {
+    std::vector<std::pair<std::string, int>> venues; // Empty = one venue on 127.0.0.1:9001
+    TransportOptions transport;
+    RouterConfig route;
+
+    int md_port = 9002;      // 0 = no market data
+    int metrics_port = 9003; // 0 = no stats endpoint
+    std::string risk_path;   // Empty = built-in limits
+    std::string ledger_path = "fills.csv";
+    int max_orders = 65536;  // Orders the store holds before it touches the heap again
+    std::string state_shm;   // Empty = none; else where oms_monitor finds us (see state_shm.h)
+
+    std::ostream* log = nullptr; // Event log ("oms: ..." lines), null = quiet
+};
+
+// The whole OMS behind a C++ API: venue sessions, risk gate, router, algos,
+// positions, ledger, market data and metrics, driven by poll()
+//
+// Single-threaded: everything here is called from one thread, the one that
+// calls poll(). Other threads submit through entry() (see order_entry.h),
+// which poll() drains. Order events reach the order's own callback, or the
+// event handler for orders submitted without one.
+class OmsCore {
+public:
+    explicit OmsCore(const OmsOptions& opts);
+    ~OmsCore();
+
+    OmsCore(const OmsCore&) = delete;
+    OmsCore& operator=(const OmsCore&) = delete;
+
+    // Loads the risk config, opens the ledger, connects every venue and
+    // starts market data and metrics. False (with a message on stderr) if
+    // it can't run: bad config, no ledger, or no venue reachable
+    bool start();
+
+    // One event loop pass: waits up to timeout_ms (-1 = until something
+    // happens) for venue input, timers or queued entry, then handles it all.
+    // user_fd (-1 = none) is polled along, e.g. stdin for a CLI. False on a
+    // fatal poll error
+    bool poll(int timeout_ms, int user_fd, bool& user_ready);
+    bool poll(int timeout_ms);
+
+    // ---- Orders. Every call prints to the event log like its CLI command
+
+    // New order: store, risk gate, route, send. Returns its client_id (a
+    // risk-rejected order has one too, and cb gets REJECTED at once)
+    int submit(const std::string& symbol, Side side, int qty, double price,
+               OrderCallback cb = nullptr, void* ctx = nullptr, uint64_t tag = 0);
+    // False if nothing went out (risk throttle, unknown or closed order)
+    bool cancel(int client_id);
+    bool replace(int client_id, int qty, double price);
+    // Empty symbol = all, side null = both. Returns how many orders went to
+    // PendingCancel, -1 if the cancel throttle refused it
+    int cancel_all(const std::string& symbol, const Side* side);
+    // All-or-nothing; returns the first leg's client_id (legs are
+    // consecutive), 0 if the basket was risk-rejected
+    int submit_basket(const std::vector<OrderRequest>& legs);
+    // TWAP / iceberg parent; returns its client_id
+    int start_algo(const std::string& symbol, Side side, int qty, double price, const AlgoParams& p);
+
+    // Events of orders submitted without a callback (including typed ones)
+    void set_event_handler(OrderCallback cb, void* ctx);
+    // Thread-safe order entry for other threads
+    OrderEntry& entry() { return entry_; }
+
+    // ---- Control
+
+    // Builds the symbol's NEW templates now rather than on its first order,
+    // for a symbol about to be quoted. False if it's too long to template
+    bool arm_symbol(const std::string& symbol);
+    void set_ref_price(const std::string& symbol, double px);
+    // Background reload; empty path = the current one. False if one is running
+    bool reload_risk(const std::string& path = "");
+    // Order status snapshot from every connected venue
+    void sync();
+
+    void print_status() const;
+    void print_order(int client_id) const;
+
+    const OrderStore& store() const { return store_; }
+    const PositionBook& positions() const { return positions_; }
+    const RiskConfig& risk_config() const { return risk_cfg_; }
+    const std::string& risk_path() const { return risk_path_; }
+    const SmartRouter& router() const { return router_; }
+    size_t active_algos() const { return algos_.active_count(); }
+
+private:
+    struct Metrics;
+    struct VenueLink;
+
+    std::ostream& log() const { return *log_; }
+
+    void venue_lost(VenueLink& vl, const char* why);
+    void request_sync(VenueLink& vl);
+    // Sends one or more lines to the venue an order was routed to
+    void send_to(int venue, std::string_view lines, const char* what);
+    // Qty sent to a venue, the denominator of its fill ratio
+    void on_routed(int venue, int qty);
+    void watch(int client_id, OrderCallback cb, void* ctx, uint64_t tag);
+
+    // submit() without assigning the id; submit_ns (0 = none) stamps
+    // submit -> wire latency for queued entry
+    RejectCode submit_order(int client_id, const std::string& symbol, Side side, int qty, double price,
+                            int64_t submit_ns);
+    void send_slices();
+    void drain_entry();
+    void reconnect(VenueLink& vl);
+    // rx_wall_ns: kernel receive time of the line, 0 = unknown
+    void on_venue_line(VenueLink& vl, const std::string& line, int64_t rx_wall_ns);
+    // Shared-memory state: the summary every pass, every symbol now and then
+    void publish_state(int64_t now_ns);
+    // Returns the symbol's unrealized PnL (0 without a mark)
+    double publish_symbol(const std::string& symbol, const PositionTracker& pos);
+
+    OmsOptions opts_;
+    std::ostream null_log_{nullptr}; // Drops everything (badbit), for a quiet core
+    std::ostream* log_;
+
+    std::vector<std::unique_ptr<VenueLink>> venues_;
+    std::unique_ptr<Metrics> om_;
+
+    RiskConfig risk_cfg_;
+    RiskState risk_state_;
+    RiskConfigLoader risk_loader_;
+    std::string risk_path_;
+
+    OrderStore store_;
+    PositionBook positions_;
+    SmartRouter router_;
+    AlgoEngine algos_;
+    OrderEntry entry_;
+    OrderTemplates templates_;
+    Ledger ledger_;
+    MarketDataHandler md_;
+    metrics::StatsServer stats_;
+
+    std::unique_ptr<StatePublisher> state_; // Null unless opts.state_shm
+    int64_t next_state_ns_ = 0;             // Next full refresh
+    double state_realized_ = 0.0;
+    double state_unrealized_ = 0.0;         // As of the last refresh
+    bool kill_seen_ = false;
+
+    int next_id_ = 1001;
+    OrderCallback on_event_ = nullptr;
+    void* on_event_ctx_ = nullptr;
+
+    // Reused every pass so their capacity carries over
+    std::vector<SliceRequest> slice_reqs_;
+    std::vector<ChildSlice> slices_;
+    std::vector<Connection*> conns_;
+    std::vector<char> venue_ready_;
+    std::vector<int> wake_fds_;
+    std::vector<pollfd> poll_fds_;
+    std::string line_;
+};
@@ -0,0 +1,164 @@
+#include "oms/order_entry.h"
+
+#include "common/clock.h"
+
+#include <cstring>
+#include <vector>
+
+static bool is_done(OrderState st) {
+    return st == OrderState::Filled || st == OrderState::Cancelled || st == OrderState::Rejected;
+}
+
+const char* to_string(OrderEventType t) {
+    switch (t) {
+        case OrderEventType::Ack: return "ACK";
+        case OrderEventType::Fill: return "FILL";
+        case OrderEventType::Cancelled: return "CANCELLED";
+        case OrderEventType::Rejected: return "REJECTED";
+        case OrderEventType::CancelRejected: return "CANCEL_REJECTED";
+    }
+    return "?";
+}
+
+OrderEntry::OrderEntry(size_t capacity) : queue_(capacity) {}
+
+OrderEntry::~OrderEntry() = default;
+
+bool OrderEntry::push(const EntryRequest& r) {
+    if (!queue_.push(r)) return false;
+    wake_.notify();
+    return true;
+}
+
+bool OrderEntry::submit(std::string_view symbol, Side side, int qty, double price,
+                        OrderCallback cb, void* ctx, uint64_t tag) {
+    if (symbol.empty() || symbol.size() > EntryRequest::kMaxSymbol || qty <= 0 || price <= 0.0) return false;
+
+    EntryRequest r;
+    r.kind = EntryRequest::Kind::New;
+    std::memcpy(r.symbol, symbol.data(), symbol.size());
+    r.side = side;
+    r.qty = qty;
+    r.price = price;
+    r.cb = cb;
+    r.ctx = ctx;
+    r.tag = tag;
+    r.submit_ns = mono_ns();
+    return push(r);
+}
+
+bool OrderEntry::cancel(int client_id) {
+    if (client_id <= 0) return false;
+
+    EntryRequest r;
+    r.kind = EntryRequest::Kind::Cancel;
+    r.client_id = client_id;
+    r.submit_ns = mono_ns();
+    return push(r);
+}
+
+bool OrderEntry::prepare_wait() {
+    return wake_.prepare_wait([this] { return !queue_.empty(); });
+}
+
+void OrderEntry::drain_wakeup() {
+    wake_.clear();
+}
+
+void OrderEntry::watch(int client_id, OrderCallback cb, void* ctx, uint64_t tag) {
+    if (!cb) return;
+    Watch& w = watches_[client_id];
+    w.cb = cb;
+    w.ctx = ctx;
+    w.tag = tag;
+}
+
+void OrderEntry::reject(int client_id, RejectCode code, OrderCallback cb, void* ctx, uint64_t tag) {
+    if (!cb) return;
+    OrderEvent ev;
+    ev.type = OrderEventType::Rejected;
+    ev.tag = tag;
+    ev.client_id = client_id;
+    ev.state = OrderState::Rejected;
+    ev.risk_code = code;
+    cb(ctx, ev);
+}
+
+void OrderEntry::cancel_rejected(const OrderStore& store, int client_id) {
+    auto it = watches_.find(client_id);
+    const Order* o = store.get(client_id);
+    if (it == watches_.end() || !o) return;
+
+    OrderEvent ev;
+    ev.type = OrderEventType::CancelRejected;
+    ev.tag = it->second.tag;
+    ev.client_id = client_id;
+    ev.state = o->state;
+    ev.filled_qty = o->filled_qty;
+    it->second.cb(it->second.ctx, ev);
+}
+
+void OrderEntry::on_order_event(const OrderStore& store, int client_id, OrderEventType type,
+                                int qty, double price, std::string_view reason) {
+    if (watches_.empty()) return;
+
+    // Routed orders are watched under the parent id the submitter knows
+    int id = client_id;
+    auto it = watches_.find(id);
+    if (it == watches_.end()) {
+        const Order* c = store.get(client_id);
+        if (!c || !c->parent_id) return;
+        id = c->parent_id;
+        it = watches_.find(id);
+        if (it == watches_.end()) return;
+    }
+    const Order* o = store.get(id);
+    if (!o) return;
+    Watch& w = it->second;
+
+    // A rejected amend leaves the order live, and one child closing says
+    // nothing about its parent until the parent is done
+    if ((type == OrderEventType::Cancelled || type == OrderEventType::Rejected) && !is_done(o->state)) return;
+    if (type == OrderEventType::Rejected && o->state == OrderState::Cancelled) type = OrderEventType::Cancelled;
+    if (type == OrderEventType::Ack) {
+        if (w.acked) return;
+        w.acked = true;
+    }
+
+    OrderEvent ev;
+    ev.type = type;
+    ev.tag = w.tag;
+    ev.client_id = id;
+    ev.state = o->state;
+    ev.qty = qty;
+    ev.price = price;
+    ev.filled_qty = o->filled_qty;
+    ev.risk_code = o->risk_code;
+    ev.reason = reason;
+
+    // Forget a finished order before calling out, in case the callback submits
+    OrderCallback cb = w.cb;
+    void* ctx = w.ctx;
+    if (is_done(o->state)) watches_.erase(it);
+    cb(ctx, ev);
+}
+
+void OrderEntry::sweep(const OrderStore& store) {
+    // Collect first: delivering a final event erases its watch
+    std::vector<int> done;
+    for (const auto& kv : watches_) {
+        const Order* o = store.get(kv.first);
+        if (!o || is_done(o->state)) done.push_back(kv.first);
+    }
+    for (int id : done) {
+        const Order* o = store.get(id);
+        OrderEventType type = (o && o->state == OrderState::Rejected) ? OrderEventType::Rejected
+                            : (o && o->state == OrderState::Filled) ? OrderEventType::Fill
+                            : OrderEventType::Cancelled;
+        if (o) {
+            on_order_event(store, id, type);
+        } else {
+            watches_.erase(id);
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "common/mpsc_queue.h"
+#include "common/wakeup.h"
+#include "common/pool.h"
+#include "oms/orders.h"
+#include "oms/reject.h"
+
+// In-process order entry for strategy threads
+//
+// Any number of threads submit orders and cancels into one lock-free MPSC
+// queue; the OMS thread drains it in its event loop and runs each request
+// through the same risk gate, router and venue path as a typed command.
+// Outcomes come back through a per-order callback, called on the OMS
+// thread, so callbacks must be short and thread-safe on the strategy side.
+
+enum class OrderEventType : uint8_t {
+    Ack,           // First ACK from the venue (first child's, for a routed order)
+    Fill,          // qty/price are this fill, filled_qty the running total
+    Cancelled,     // Done: cancelled, possibly after partial fills
+    Rejected,      // Done: by our risk gate (risk_code) or the venue (reason)
+    CancelRejected // A cancel() was refused; the order is still live
+};
+
+const char* to_string(OrderEventType t);
+
+struct OrderEvent {
+    OrderEventType type = OrderEventType::Ack;
+    uint64_t tag = 0;  // The submitter's, echoed back
+    int client_id = 0; // Assigned by the OMS; first seen in the first event
+    OrderState state = OrderState::PendingNew; // After this event
+
+    int qty = 0;         // Fill only
+    double price = 0.0;  // Fill only
+    int filled_qty = 0;
+
+    RejectCode risk_code = RejectCode::None;
+    std::string_view reason; // Venue reject text, valid during the callback
+};
+
+using OrderCallback = void (*)(void* ctx, const OrderEvent& ev);
+
+// One queued request, as the OMS thread sees it
+struct EntryRequest {
+    static constexpr size_t kMaxSymbol = 15;
+
+    enum class Kind : uint8_t { New, Cancel };
+    Kind kind = Kind::New;
+
+    char symbol[kMaxSymbol + 1] = {};
+    Side side = Side::Buy;
+    int qty = 0;
+    double price = 0.0;
+    int client_id = 0; // Cancel
+
+    OrderCallback cb = nullptr;
+    void* ctx = nullptr;
+    uint64_t tag = 0;
+    int64_t submit_ns = 0; // Monotonic, for submit -> wire latency
+
+    std::string_view symbol_view() const { return std::string_view(symbol); }
+};
+
+class OrderEntry {
+public:
+    explicit OrderEntry(size_t capacity = 4096);
+    ~OrderEntry();
+
+    // ---- Producer side, any thread. False if the queue is full or the
+    // arguments are bad; nothing is queued then
+
+    // cb (may be null) gets every event for the order until it is done
+    bool submit(std::string_view symbol, Side side, int qty, double price,
+                OrderCallback cb, void* ctx, uint64_t tag = 0);
+    // The outcome goes to the order's own callback: Cancelled, or CancelRejected
+    bool cancel(int client_id);
+
+    // ---- OMS thread
+
+    // Readable after a submit while the OMS thread is waiting
+    int notify_fd() const { return wake_.fd(); }
+    // Call right before blocking. False if requests are already queued, so
+    // the caller must not block; otherwise the next submit wakes notify_fd
+    bool prepare_wait();
+    // Clears notify_fd after a wakeup
+    void drain_wakeup();
+
+    bool pop(EntryRequest& out) { return queue_.pop(out); }
+
+    // The order was accepted into the store: route its events to cb
+    void watch(int client_id, OrderCallback cb, void* ctx, uint64_t tag);
+    // The order never made it past our risk gate
+    void reject(int client_id, RejectCode code, OrderCallback cb, void* ctx, uint64_t tag);
+    // A cancel() the OMS refused
+    void cancel_rejected(const OrderStore& store, int client_id);
+
+    // Something happened to client_id at the venue (after the store was
+    // updated). Child orders report to their parent's watcher
+    void on_order_event(const OrderStore& store, int client_id, OrderEventType type,
+                        int qty = 0, double price = 0.0, std::string_view reason = {});
+
+    // Final events for watched orders that closed without a venue message
+    // (e.g. in a reconcile)
+    void sweep(const OrderStore& store);
+
+    size_t watched() const { return watches_.size(); }
+
+private:
+    struct Watch {
+        OrderCallback cb = nullptr;
+        void* ctx = nullptr;
+        uint64_t tag = 0;
+        bool acked = false;
+    };
+
+    bool push(const EntryRequest& r);
+
+    MpscQueue<EntryRequest> queue_;
+    Wakeup wake_;
+
+    PooledMap<int, Watch> watches_; // OMS thread only, by client_id
+};
@@ -0,0 +1,24 @@
+#include "oms/order_templates.h"
+
+OrderTemplates::Sides& OrderTemplates::get(const std::string& symbol) {
+    auto it = by_symbol_.find(symbol);
+    if (it != by_symbol_.end()) return it->second;
+    Sides& s = by_symbol_[symbol];
+    s.buy.arm(symbol, to_string(Side::Buy));
+    s.sell.arm(symbol, to_string(Side::Sell));
+    return s;
+}
+
+bool OrderTemplates::arm(const std::string& symbol) {
+    return get(symbol).buy.armed();
+}
+
+std::string_view OrderTemplates::new_line(const std::string& symbol, Side side, int client_id, int qty,
+                                          double price, WireBuf& fallback) {
+    Sides& s = get(symbol);
+    NewTemplate& t = (side == Side::Buy) ? s.buy : s.sell;
+    if (t.armed()) return t.encode(client_id, qty, price);
+    // Too long to template; an unarmed entry stays as the marker
+    if (!encode_msg(make_new(client_id, symbol, to_string(side), qty, price), fallback)) return {};
+    return fallback.view();
+}
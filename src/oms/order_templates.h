@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "common/messages.h"
+#include "oms/orders.h"
+
+// Pre-armed NEW lines (see NewTemplate in messages.h), one per symbol and
+// side, so sending an order only patches in client_id, qty and price
+// A symbol is armed on its first order, or ahead of it with arm(). One
+// thread: the one that sends.
+class OrderTemplates {
+public:
+    // Both sides; false if the symbol is too long to template
+    bool arm(const std::string& symbol);
+
+    // The NEW line, from the template when there is one, else encoded into
+    // fallback. Valid until the next call for the same symbol and side;
+    // empty if the line doesn't fit even there
+    std::string_view new_line(const std::string& symbol, Side side, int client_id, int qty, double price,
+                              WireBuf& fallback);
+
+    size_t symbols() const { return by_symbol_.size(); }
+
+private:
+    struct Sides {
+        NewTemplate buy;
+        NewTemplate sell;
+    };
+
+    Sides& get(const std::string& symbol);
+
+    std::unordered_map<std::string, Sides> by_symbol_;
+};
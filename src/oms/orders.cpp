@@ -18,6 +18,7 @@ const char* to_string(OrderState st) {
         case OrderState::PendingNew:    return "PendingNew";
         case OrderState::Accepted:      return "Accepted";
         case OrderState::PendingCancel: return "PendingCancel";
+        case OrderState::PendingReplace: return "PendingReplace";
         case OrderState::Cancelled:     return "Cancelled";
         case OrderState::Filled:        return "Filled";
         case OrderState::Rejected:      return "Rejected";
@@ -28,7 +29,77 @@ const char* to_string(OrderState st) {
 bool OrderStore::is_open_state(OrderState st) {
     return st == OrderState::PendingNew
         || st == OrderState::Accepted
-        || st == OrderState::PendingCancel;
+        || st == OrderState::PendingCancel
+        || st == OrderState::PendingReplace;
+}
+
+void OrderStore::set_state(Order& o, OrderState st) {
+    // Parents are never live at a venue, only their children are
+    if (o.is_parent) {
+        o.state = st;
+        return;
+    }
+
+    if (st == OrderState::PendingCancel || st == OrderState::PendingReplace) o.request_mark = ++request_mark_;
+
+    bool was_open = is_open_state(o.state);
+    bool now_open = is_open_state(st);
+    if (was_open && !now_open) {
+        open_count_--;
+        auto it = open_by_symbol_.find(o.symbol);
+        if (it != open_by_symbol_.end()) it->second.erase(o.client_id);
+    } else if (!was_open && now_open) {
+        open_count_++;
+        open_by_symbol_[o.symbol].insert(o.client_id);
+    }
+    if (o.parent_id) {
+        auto it = orders_.find(o.parent_id);
+        if (it != orders_.end()) {
+            count_child(it->second, o.state, -1);
+            count_child(it->second, st, +1);
+        }
+    }
+    o.state = st;
+    if (o.parent_id) roll_up(o.parent_id);
+}
+
+void OrderStore::count_child(Order& p, OrderState st, int delta) {
+    if (is_open_state(st)) p.open_children += delta;
+    if (st == OrderState::PendingNew) p.unacked_children += delta;
+    if (st == OrderState::PendingCancel) p.cancelling_children += delta;
+    if (st == OrderState::Rejected) p.rejected_children += delta;
+}
+
+void OrderStore::roll_up(int parent_id) {
+    auto it = orders_.find(parent_id);
+    if (it == orders_.end()) return;
+    Order& p = it->second;
+
+    // filled_qty is kept up to date by on_fill
+    if (p.filled_qty >= p.qty) {
+        p.state = OrderState::Filled;
+        p.working = false; // Nothing left to release
+    } else if (p.open_children > 0 || p.working) {
+        // A working algo parent was accepted by us, whatever its children do
+        bool acked = p.open_children > p.unacked_children;
+        p.state = (p.cancelling_children > 0) ? OrderState::PendingCancel
+                : (acked || p.working) ? OrderState::Accepted : OrderState::PendingNew;
+    } else if (!p.children.empty() && p.rejected_children == (int)p.children.size()) {
+        p.state = OrderState::Rejected;
+        p.reject_reason = "CHILDREN_REJECTED";
+    } else {
+        p.state = OrderState::Cancelled;
+    }
+}
+
+void OrderStore::reserve(size_t orders) {
+    orders_.reserve(orders);
+
+    // Warm the node pool with placeholders under ids the OMS never hands
+    // out (client ids are positive); erasing them leaves their nodes free
+    int extra = (int)(orders > orders_.size() ? orders - orders_.size() : 0);
+    for (int i = 1; i <= extra; i++) orders_.emplace(-i, Order());
+    for (int i = 1; i <= extra; i++) orders_.erase(-i);
 }
 
 void OrderStore::add_pending_new(int client_id, const std::string& symbol, Side side, int qty, double price) {
@@ -39,14 +110,94 @@ void OrderStore::add_pending_new(int client_id, const std::string& symbol, Side
     o.qty = qty;
     o.price = price;
     o.state = OrderState::PendingNew;
+    o.new_mark = o.request_mark = ++request_mark_;
+
+    // Drop a reused id from the open index before overwriting it
+    auto it = orders_.find(client_id);
+    if (it != orders_.end()) set_state(it->second, OrderState::Rejected);
 
     orders_[client_id] = std::move(o);
+    open_count_++;
+    open_by_symbol_[symbol].insert(client_id);
+}
+
+void OrderStore::add_pending_batch(int first_client_id, const std::vector<OrderRequest>& legs) {
+    // One rehash up front instead of several while inserting
+    orders_.reserve(orders_.size() + legs.size());
+    for (size_t i = 0; i < legs.size(); i++) {
+        const OrderRequest& r = legs[i];
+        add_pending_new(first_client_id + (int)i, r.symbol, r.side, r.qty, r.price);
+    }
+}
+
+void OrderStore::set_venue(int client_id, int venue) {
+    auto it = orders_.find(client_id);
+    if (it != orders_.end()) it->second.venue = venue;
+}
+
+void OrderStore::split(int parent_id, int first_child_id, const std::vector<ChildSlice>& slices) {
+    auto it = orders_.find(parent_id);
+    if (it == orders_.end()) return;
+
+    // The parent leaves the open index; its state only rolls up from here
+    Order& p = it->second;
+    if (is_open_state(p.state)) {
+        open_count_--;
+        open_by_symbol_[p.symbol].erase(parent_id);
+    }
+    p.is_parent = true;
+    p.children.reserve(slices.size());
+
+    orders_.reserve(orders_.size() + slices.size());
+    for (size_t i = 0; i < slices.size(); i++) {
+        add_child(parent_id, first_child_id + (int)i, slices[i].venue, slices[i].qty);
+    }
+}
+
+void OrderStore::add_parent(int parent_id, const std::string& symbol, Side side, int qty, double price) {
+    Order o;
+    o.client_id = parent_id;
+    o.symbol = symbol;
+    o.side = side;
+    o.qty = qty;
+    o.price = price;
+    o.is_parent = true;
+    o.working = true;
+    o.state = OrderState::Accepted;
+    orders_[parent_id] = std::move(o);
+}
+
+void OrderStore::add_child(int parent_id, int child_id, int venue, int qty) {
+    auto it = orders_.find(parent_id);
+    if (it == orders_.end()) return;
+    const Order& p = it->second;
+
+    // Copy out first: inserting the child may rehash
+    const std::string symbol = p.symbol;
+    const Side side = p.side;
+    const double price = p.price;
+    add_pending_new(child_id, symbol, side, qty, price);
+
+    Order& c = orders_.at(child_id);
+    c.venue = venue;
+    c.parent_id = parent_id;
+    Order& parent = orders_.at(parent_id);
+    parent.children.push_back(child_id);
+    count_child(parent, c.state, +1);
+    roll_up(parent_id);
+}
+
+void OrderStore::set_working(int parent_id, bool working) {
+    auto it = orders_.find(parent_id);
+    if (it == orders_.end() || !it->second.is_parent) return;
+    it->second.working = working;
+    roll_up(parent_id);
 }
 
 void OrderStore::on_ack(int client_id, int venue_id) {
     auto it = orders_.find(client_id);
     if (it == orders_.end()) {
-        std::cout << "oms: WARN ack for unknown client_id=" << client_id << "\n";
+        log() << "oms: WARN ack for unknown client_id=" << client_id << "\n";
         return;
     }
 
@@ -55,73 +206,153 @@ void OrderStore::on_ack(int client_id, int venue_id) {
 
     o.venue_id = venue_id;
 
-    // If we already requested cancel before ACK arrived, keep PendingCancel
-    if (o.state == OrderState::PendingCancel) return;
+    // If we already requested cancel/replace before ACK arrived, keep it pending
+    if (o.state == OrderState::PendingCancel || o.state == OrderState::PendingReplace) return;
 
-    o.state = OrderState::Accepted;
+    set_state(o, OrderState::Accepted);
 }
 
 void OrderStore::on_fill(int client_id, int venue_id, int fill_qty, double /*fill_price*/) {
     auto it = orders_.find(client_id);
     if (it == orders_.end()) {
-        std::cout << "oms: WARN fill for unknown client_id=" << client_id << "\n";
+        log() << "oms: WARN fill for unknown client_id=" << client_id << "\n";
         return;
     }
 
     Order& o = it->second;
 
     if (o.state == OrderState::Rejected) {
-        std::cout << "oms: WARN fill for rejected client_id=" << client_id << "\n";
+        log() << "oms: WARN fill for rejected client_id=" << client_id << "\n";
         return;
     }
     if (o.state == OrderState::Cancelled) {
-        std::cout << "oms: WARN fill for cancelled client_id=" << client_id << "\n";
+        log() << "oms: WARN fill for cancelled client_id=" << client_id << "\n";
         return;
     }
 
     if (o.venue_id != -1 && o.venue_id != venue_id) {
-        std::cout << "oms: WARN fill venue_id mismatch client_id=" << client_id
+        log() << "oms: WARN fill venue_id mismatch client_id=" << client_id
                   << " expected=" << o.venue_id << " got=" << venue_id << "\n";
     }
 
     o.venue_id = venue_id;
+    const int before = o.filled_qty;
     o.filled_qty += fill_qty;
+    if (o.filled_qty >= o.qty) o.filled_qty = o.qty;
+    if (o.parent_id) {
+        auto pit = orders_.find(o.parent_id);
+        if (pit != orders_.end()) pit->second.filled_qty += o.filled_qty - before;
+    }
 
     if (o.filled_qty >= o.qty) {
-        o.filled_qty = o.qty;
-        o.state = OrderState::Filled;
-    } else {
-        o.state = OrderState::Accepted;
+        set_state(o, OrderState::Filled);
+    } else if (o.state != OrderState::PendingReplace) {
+        set_state(o, OrderState::Accepted);
+    } else if (o.parent_id) {
+        roll_up(o.parent_id); // set_state does this on the other paths
     }
 }
 
-bool OrderStore::request_cancel(int client_id) {
+bool OrderStore::can_cancel(int client_id) const {
     auto it = orders_.find(client_id);
     if (it == orders_.end()) {
-        std::cout << "oms: WARN cancel unknown client_id=" << client_id << "\n";
+        log() << "oms: WARN cancel unknown client_id=" << client_id << "\n";
         return false;
     }
 
-    Order& o = it->second;
+    const Order& o = it->second;
 
     if (o.state == OrderState::Filled || o.state == OrderState::Cancelled || o.state == OrderState::Rejected) {
-        std::cout << "oms: WARN cancel not allowed in state=" << to_string(o.state) << "\n";
+        log() << "oms: WARN cancel not allowed in state=" << to_string(o.state) << "\n";
         return false;
     }
     if (o.state == OrderState::PendingCancel) {
-        std::cout << "oms: WARN cancel already pending client_id=" << client_id << "\n";
+        log() << "oms: WARN cancel already pending client_id=" << client_id << "\n";
         return false;
     }
+    return true;
+}
+
+bool OrderStore::request_cancel(int client_id) {
+    if (!can_cancel(client_id)) return false;
+
+    // An in-flight replace keeps its pending terms: its REPLACED or REJECT
+    // still comes back, ahead of the cancel's answer
 
     // Allow cancel even before ACK
-    o.state = OrderState::PendingCancel;
+    set_state(orders_.at(client_id), OrderState::PendingCancel);
     return true;
 }
 
+std::vector<int> OrderStore::request_cancel_children(int parent_id) {
+    std::vector<int> ids;
+    auto it = orders_.find(parent_id);
+    if (it == orders_.end()) return ids;
+
+    for (int id : it->second.children) {
+        Order& c = orders_.at(id);
+        if (!is_open_state(c.state) || c.state == OrderState::PendingCancel) continue;
+        set_state(c, OrderState::PendingCancel);
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+bool OrderStore::has_cancellable_children(int parent_id) const {
+    auto it = orders_.find(parent_id);
+    if (it == orders_.end()) return false;
+
+    for (int id : it->second.children) {
+        const Order& c = orders_.at(id);
+        if (is_open_state(c.state) && c.state != OrderState::PendingCancel) return true;
+    }
+    return false;
+}
+
+bool OrderStore::collect_cancellable(const std::string& symbol, const Side* side, std::vector<int>* ids) const {
+    bool found = false;
+    auto collect = [&](const PooledIdSet& open) {
+        for (int client_id : open) {
+            auto it = orders_.find(client_id);
+            if (it == orders_.end()) continue;
+            const Order& o = it->second;
+            if (o.state == OrderState::PendingCancel) continue;
+            if (side && o.side != *side) continue;
+            found = true;
+            if (!ids) return;
+            ids->push_back(client_id);
+        }
+    };
+
+    if (symbol.empty()) {
+        for (const auto& kv : open_by_symbol_) {
+            collect(kv.second);
+            if (found && !ids) break;
+        }
+    } else {
+        auto it = open_by_symbol_.find(symbol);
+        if (it != open_by_symbol_.end()) collect(it->second);
+    }
+    return found;
+}
+
+std::vector<int> OrderStore::request_cancel_all(const std::string& symbol, const Side* side) {
+    std::vector<int> ids;
+    collect_cancellable(symbol, side, &ids);
+
+    // PendingCancel is still open, so the index itself is untouched
+    for (int client_id : ids) set_state(orders_[client_id], OrderState::PendingCancel);
+    return ids;
+}
+
+bool OrderStore::has_cancellable(const std::string& symbol, const Side* side) const {
+    return collect_cancellable(symbol, side, nullptr);
+}
+
 void OrderStore::on_cancelled(int client_id, int venue_id) {
     auto it = orders_.find(client_id);
     if (it == orders_.end()) {
-        std::cout << "oms: WARN cancelled unknown client_id=" << client_id << "\n";
+        log() << "oms: WARN cancelled unknown client_id=" << client_id << "\n";
         return;
     }
 
@@ -129,31 +360,189 @@ void OrderStore::on_cancelled(int client_id, int venue_id) {
     if (o.state == OrderState::Rejected) return;
 
     if (o.venue_id != -1 && o.venue_id != venue_id) {
-        std::cout << "oms: WARN cancelled venue_id mismatch client_id=" << client_id << "\n";
+        log() << "oms: WARN cancelled venue_id mismatch client_id=" << client_id << "\n";
     }
 
     o.venue_id = venue_id;
-    o.state = OrderState::Cancelled;
+    set_state(o, OrderState::Cancelled);
+}
+
+bool OrderStore::can_replace(int client_id, int qty) const {
+    auto it = orders_.find(client_id);
+    if (it == orders_.end()) {
+        log() << "oms: WARN replace unknown client_id=" << client_id << "\n";
+        return false;
+    }
+
+    const Order& o = it->second;
+
+    if (o.is_parent) {
+        log() << "oms: WARN replace a parent's children, not the parent\n";
+        return false;
+    }
+    if (o.state != OrderState::PendingNew && o.state != OrderState::Accepted) {
+        log() << "oms: WARN replace not allowed in state=" << to_string(o.state) << "\n";
+        return false;
+    }
+    if (qty <= o.filled_qty) {
+        log() << "oms: WARN replace qty must exceed filled=" << o.filled_qty << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool OrderStore::request_replace(int client_id, int qty, double price) {
+    if (!can_replace(client_id, qty)) return false;
+
+    Order& o = orders_.at(client_id);
+    o.pending_qty = qty;
+    o.pending_price = price;
+    set_state(o, OrderState::PendingReplace);
+    return true;
+}
+
+void OrderStore::on_replaced(int client_id, int venue_id, int qty, double price) {
+    auto it = orders_.find(client_id);
+    if (it == orders_.end()) {
+        log() << "oms: WARN replaced unknown client_id=" << client_id << "\n";
+        return;
+    }
+
+    Order& o = it->second;
+    // A cancel sent behind the replace leaves the order PendingCancel with
+    // the replace's terms still pending
+    const bool cancelling = o.state == OrderState::PendingCancel && o.pending_qty > 0;
+    if (o.state != OrderState::PendingReplace && !cancelling) {
+        log() << "oms: WARN replaced not pending client_id=" << client_id
+                  << " state=" << to_string(o.state) << "\n";
+        return;
+    }
+
+    // Venue terms win over what we asked for
+    o.venue_id = venue_id;
+    o.qty = qty;
+    o.price = price;
+    o.pending_qty = 0;
+    o.pending_price = 0.0;
+
+    if (o.filled_qty >= o.qty) set_state(o, OrderState::Filled);
+    else if (!cancelling) set_state(o, OrderState::Accepted);
+}
+
+void OrderStore::on_venue_reject(int client_id, const std::string& reason) {
+    auto it = orders_.find(client_id);
+    if (it == orders_.end()) {
+        log() << "oms: WARN reject unknown client_id=" << client_id << "\n";
+        return;
+    }
+    Order& o = it->second;
+
+    // The venue answers in order, so before the ACK a reject is the NEW's
+    // even if a cancel or replace went out behind it
+    if (o.state == OrderState::PendingNew ||
+        (o.venue_id == -1 && (o.state == OrderState::PendingCancel || o.state == OrderState::PendingReplace))) {
+        mark_rejected(client_id, reason);
+        return;
+    }
+
+    // A replace is answered before a cancel sent after it
+    if (o.pending_qty > 0 && (o.state == OrderState::PendingReplace || o.state == OrderState::PendingCancel)) {
+        log() << "oms: replace rejected client_id=" << client_id << " reason=" << reason << "\n";
+        o.pending_qty = 0;
+        o.pending_price = 0.0;
+        if (o.state == OrderState::PendingReplace) set_state(o, OrderState::Accepted);
+        return;
+    }
+    if (o.state == OrderState::PendingCancel) {
+        log() << "oms: cancel rejected client_id=" << client_id << " reason=" << reason << "\n";
+        set_state(o, OrderState::Accepted);
+        return;
+    }
+
+    // E.g. ALREADY_FILLED after a FILL overtook our request: the order's
+    // own state already says how it ended
+    log() << "oms: WARN reject ignored client_id=" << client_id << " state=" << to_string(o.state)
+              << " reason=" << reason << "\n";
 }
 
 void OrderStore::mark_rejected(int client_id, const std::string& reason) {
     auto it = orders_.find(client_id);
     if (it == orders_.end()) {
-        std::cout << "oms: WARN reject unknown client_id=" << client_id << "\n";
+        log() << "oms: WARN reject unknown client_id=" << client_id << "\n";
         return;
     }
 
     Order& o = it->second;
-    o.state = OrderState::Rejected;
+    set_state(o, OrderState::Rejected);
     o.reject_reason = reason;
 }
 
-int OrderStore::open_orders_count() const {
-    int n = 0;
-    for (const auto& kv : orders_) {
-        if (is_open_state(kv.second.state)) n++;
+void OrderStore::mark_rejected(int client_id, RejectCode code) {
+    auto it = orders_.find(client_id);
+    if (it == orders_.end()) {
+        log() << "oms: WARN reject unknown client_id=" << client_id << "\n";
+        return;
     }
-    return n;
+
+    Order& o = it->second;
+    set_state(o, OrderState::Rejected);
+    o.risk_code = code;
+}
+
+ReconcileResult OrderStore::reconcile(int venue, const std::vector<VenueOrderStatus>& snapshot, uint64_t mark) {
+    ReconcileResult res;
+    const uint32_t epoch = ++reconcile_epoch_;
+
+    // Live at the venue: adopt its ids and terms, clear any pending state
+    for (const VenueOrderStatus& v : snapshot) {
+        auto it = orders_.find(v.client_id);
+        if (it == orders_.end() || !is_open_state(it->second.state) || it->second.venue != venue) {
+            res.unknown++;
+            continue;
+        }
+
+        Order& o = it->second;
+        o.seen_epoch = epoch;
+        res.live++;
+        // A CANCEL or REPLACE sent after the snapshot was asked for is still
+        // to be answered; its answer decides the state
+        if (o.request_mark > mark) continue;
+
+        int qty = o.filled_qty + v.qty;
+        if (o.state != OrderState::Accepted || o.venue_id != v.venue_id || o.qty != qty || o.price != v.price) {
+            res.updated++;
+            o.venue_id = v.venue_id;
+            o.qty = qty;
+            o.price = v.price;
+            set_state(o, OrderState::Accepted);
+        }
+    }
+
+    // Open here but not live there. Collect first: set_state edits the index
+    std::vector<int> gone;
+    for (const auto& kv : open_by_symbol_) {
+        for (int id : kv.second) {
+            const Order& o = orders_.at(id);
+            if (o.venue == venue && o.seen_epoch != epoch && o.new_mark <= mark) gone.push_back(id);
+        }
+    }
+    for (int id : gone) {
+        Order& o = orders_.at(id);
+        if (o.state == OrderState::PendingNew) {
+            set_state(o, OrderState::Rejected);
+            o.reject_reason = "VENUE_UNKNOWN";
+            res.rejected++;
+        } else {
+            set_state(o, OrderState::Cancelled);
+            res.cancelled++;
+        }
+    }
+    return res;
+}
+
+void OrderStore::set_sent_ns(int client_id, int64_t ns) {
+    auto it = orders_.find(client_id);
+    if (it != orders_.end()) it->second.sent_ns = ns;
 }
 
 const Order* OrderStore::get(int client_id) const {
@@ -162,15 +551,15 @@ const Order* OrderStore::get(int client_id) const {
     return &it->second;
 }
 
-void OrderStore::print_one(int client_id) const {
+void OrderStore::print_one(int client_id, std::ostream& out) const {
     auto it = orders_.find(client_id);
     if (it == orders_.end()) {
-        std::cout << "oms: (no such order) client_id=" << client_id << "\n";
+        out << "oms: (no such order) client_id=" << client_id << "\n";
         return;
     }
 
     const Order& o = it->second;
-    std::cout << "oms: order " << o.client_id
+    out << "oms: order " << o.client_id
               << " " << o.symbol
               << " " << to_string(o.side)
               << " qty=" << o.qty
@@ -180,8 +569,22 @@ void OrderStore::print_one(int client_id) const {
               << " state=" << to_string(o.state);
 
     if (o.state == OrderState::Rejected) {
-        std::cout << " reason=" << o.reject_reason;
+        if (o.risk_code != RejectCode::None) out << " reason=RISK_" << to_string(o.risk_code);
+        else out << " reason=" << o.reject_reason;
+    }
+    if (o.parent_id) out << " parent=" << o.parent_id << " venue=" << o.venue;
+    if (o.is_parent) {
+        // Algo parents can collect many children; show the latest few
+        const size_t kShown = 8;
+        size_t first = o.children.size() > kShown ? o.children.size() - kShown : 0;
+        out << " children=";
+        if (first > 0) out << "(" << first << " more),";
+        for (size_t i = first; i < o.children.size(); i++) out << (i > first ? "," : "") << o.children[i];
+        if (o.working) out << " working";
+    }
+    if (o.state == OrderState::PendingReplace) {
+        out << " pending_qty=" << o.pending_qty << " pending_px=" << o.pending_price;
     }
 
-    std::cout << "\n";
+    out << "\n";
 }
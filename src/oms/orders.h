@@ -1,7 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <iostream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/pool.h"
+#include "oms/reject.h"
 
 enum class Side { Buy, Sell };
 
@@ -9,6 +16,7 @@ enum class OrderState {
     PendingNew,
     Accepted,
     PendingCancel,
+    PendingReplace,
     Cancelled,
     Filled,
     Rejected
@@ -25,7 +33,64 @@ struct Order {
     int filled_qty = 0;
     OrderState state = OrderState::PendingNew;
 
-    std::string reject_reason; // Set when rejected
+    // Requested amend, valid while PendingReplace
+    int pending_qty = 0;
+    double pending_price = 0.0;
+
+    int venue = 0; // Index of the venue it was routed to
+
+    // Routed and algo orders: the parent is never sent itself. Its fills
+    // and state roll up from the child orders working it at the venues
+    bool is_parent = false;
+    bool working = false;      // Algo parent still releasing children
+    int parent_id = 0;         // Set on child orders
+    std::vector<int> children; // Set on parent orders
+
+    // Parent only: children per state, so a child update rolls up in O(1)
+    int open_children = 0;       // PendingNew + Accepted + PendingCancel + PendingReplace
+    int unacked_children = 0;    // PendingNew
+    int cancelling_children = 0; // PendingCancel
+    int rejected_children = 0;
+
+    int64_t sent_ns = 0; // Just before NEW was written to the venue (monotonic), 0 = not sent
+    // OrderStore::request_mark() right after its NEW, and after its latest
+    // NEW, CANCEL or REPLACE. Tells a reconcile what the snapshot can reflect
+    uint64_t new_mark = 0;
+    uint64_t request_mark = 0;
+    uint32_t seen_epoch = 0; // Last reconcile pass that found it live at the venue
+
+    RejectCode risk_code = RejectCode::None; // Set when our own risk gate rejected it
+    std::string reject_reason;                // Set when the venue rejected it
+};
+
+// One leg of an order entry request (used for baskets)
+struct OrderRequest {
+    std::string symbol;
+    Side side = Side::Buy;
+    int qty = 0;
+    double price = 0.0;
+};
+
+// One child of a routed order: qty to send to one venue
+struct ChildSlice {
+    int venue = 0;
+    int qty = 0;
+};
+
+// One live order as the venue reports it in an ORDER_STATUS snapshot
+struct VenueOrderStatus {
+    int client_id = 0;
+    int venue_id = 0;
+    int qty = 0; // Leaves qty
+    double price = 0.0;
+};
+
+struct ReconcileResult {
+    int live = 0;      // Open here and live at the venue
+    int updated = 0;   // ...of which had a stale state or terms (e.g. lost ACK)
+    int cancelled = 0; // Open here, gone at the venue
+    int rejected = 0;  // PendingNew the venue never saw
+    int unknown = 0;   // Live at the venue, unknown or closed here
 };
 
 Side parse_side(const std::string& s); // "BUY"/"SELL" -> Side
@@ -34,24 +99,116 @@ const char* to_string(OrderState st);
 
 class OrderStore {
 public:
+    OrderStore() = default;
+    OrderStore(const OrderStore&) = delete;
+    OrderStore& operator=(const OrderStore&) = delete;
+
+    // Where WARNs and rejected replaces/cancels are reported, null = quiet
+    // (the default). Written by whichever thread drives the store
+    void set_log(std::ostream* log) { log_ = log ? log : &null_log_; }
+
+    // Makes room for this many orders up front: buckets are sized and the
+    // node pool grown, so inserting up to that many never touches the heap
+    void reserve(size_t orders);
+
     void add_pending_new(int client_id, const std::string& symbol, Side side, int qty, double price);
+    // Bulk insert, leg i gets client_id first_client_id + i
+    void add_pending_batch(int first_client_id, const std::vector<OrderRequest>& legs);
+
+    // Routes a stored order whole to one venue
+    void set_venue(int client_id, int venue);
+    // Turns a stored PendingNew order into a parent worked by one child per
+    // slice; child i gets client_id first_child_id + i. Only the children
+    // count as open orders from here on
+    void split(int parent_id, int first_child_id, const std::vector<ChildSlice>& slices);
+
+    // Algo parents: created working (Accepted with no children), then given
+    // children one at a time. The parent stays open until set_working(false)
+    // and its last child is done
+    void add_parent(int parent_id, const std::string& symbol, Side side, int qty, double price);
+    void add_child(int parent_id, int child_id, int venue, int qty);
+    void set_working(int parent_id, bool working);
 
     void on_ack(int client_id, int venue_id);
     void on_fill(int client_id, int venue_id, int fill_qty, double fill_price);
 
+    // Whether request_cancel would take it, without moving it; the WARN
+    // says why not. Lets the cancel throttle see only cancels that go out
+    bool can_cancel(int client_id) const;
+    // Keeps a replace in flight pending: its answer arrives before the cancel's
     bool request_cancel(int client_id);
+    // Parent: moves every open child to PendingCancel, returns their client_ids
+    std::vector<int> request_cancel_children(int parent_id);
+    bool has_cancellable_children(int parent_id) const;
+    // Moves every open, not yet cancelling order that matches to PendingCancel
+    // Empty symbol = all symbols, side null = both sides. Returns the client_ids
+    std::vector<int> request_cancel_all(const std::string& symbol, const Side* side);
+    bool has_cancellable(const std::string& symbol, const Side* side) const;
     void on_cancelled(int client_id, int venue_id);
 
+    // Whether request_replace would take it, same as can_cancel. Checked
+    // ahead of the risk chain, so an amend that can't go out spends no token
+    bool can_replace(int client_id, int qty) const;
+    bool request_replace(int client_id, int qty, double price);
+    void on_replaced(int client_id, int venue_id, int qty, double price);
+
+    // Venue REJECT. Before the ACK it rejects the order; after it, it answers
+    // the replace or cancel in flight, which is dropped and the order stays
+    // live with its old terms. Ignored once the order is done
+    void on_venue_reject(int client_id, const std::string& reason);
+
     void mark_rejected(int client_id, const std::string& reason);
+    // Risk reject: stores the code only, text is built when printed
+    void mark_rejected(int client_id, RejectCode code);
+
+    // Counts every NEW, CANCEL and REPLACE the store records. Taken when
+    // ORDER_STATUS_ALL goes out, it splits the orders into those the
+    // snapshot reflects and those with a request sent after it
+    uint64_t request_mark() const { return request_mark_; }
+
+    // Applies one venue's full snapshot in one pass. `mark` is request_mark()
+    // when the snapshot was asked for: the venue had processed everything
+    // sent up to there. An order whose NEW went out before it and that the
+    // snapshot doesn't list is no longer live there; one it lists gets the
+    // venue's terms, unless a CANCEL or REPLACE went out after the mark and
+    // its answer is still on the way. Orders whose NEW went out after the
+    // mark, and orders at other venues, are untouched
+    ReconcileResult reconcile(int venue, const std::vector<VenueOrderStatus>& snapshot, uint64_t mark);
 
-    int open_orders_count() const;       // PendingNew + Accepted + PendingCancel
+    // Stamps when NEW went out, for NEW -> ACK latency
+    void set_sent_ns(int client_id, int64_t ns);
+
+    int open_orders_count() const { return open_count_; } // PendingNew + Accepted + PendingCancel + PendingReplace
     const Order* get(int client_id) const;
 
-    void print_one(int client_id) const;
+    void print_one(int client_id, std::ostream& out = std::cout) const;
 
 private:
     static bool is_open_state(OrderState st);
+    // Open, not yet cancelling orders that match, as request_cancel_all takes
+    // them. ids null: stops at the first. True if there was any
+    bool collect_cancellable(const std::string& symbol, const Side* side, std::vector<int>* ids) const;
+    // All state transitions go through here to keep open_count_ exact
+    void set_state(Order& o, OrderState st);
+    // Moves a child in or out of its parent's counters
+    static void count_child(Order& p, OrderState st, int delta);
+    // Recomputes a parent's state from its child counters
+    void roll_up(int parent_id);
+
+    // Nodes come from per-thread pools and freed ones are reused, so the
+    // order path stays off the heap once the pools have warmed up
+    using PooledIdSet = PooledSet<int>;
 
     // Keyed by client_id (OMS-assigned
-    std::unordered_map<int, Order> orders_;
+    PooledMap<int, Order> orders_;
+    int open_count_ = 0;
+    uint32_t reconcile_epoch_ = 0;
+    uint64_t request_mark_ = 0;
+
+    std::ostream& log() const { return *log_; }
+    std::ostream null_log_{nullptr}; // Drops everything (badbit)
+    std::ostream* log_ = &null_log_;
+
+    // Open orders only, so mass cancel never walks finished ones
+    std::unordered_map<std::string, PooledIdSet> open_by_symbol_;
 };
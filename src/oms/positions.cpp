@@ -2,8 +2,8 @@
 
 #include <algorithm>
 
-void PositionTracker::on_fill(Side side, int qty, double price) {
-    if (qty <= 0) return;
+double PositionTracker::on_fill(Side side, int qty, double price) {
+    if (qty <= 0) return 0.0;
 
     // No fees/slippage modeled, PnL uses raw fill price
     int pos = position_;
@@ -13,7 +13,7 @@ void PositionTracker::on_fill(Side side, int qty, double price) {
         if (side == Side::Buy) position_ = qty;
         else position_ = -qty;
         avg_cost_ = price;
-        return;
+        return 0.0;
     }
 
     // LONG case
@@ -23,18 +23,19 @@ void PositionTracker::on_fill(Side side, int qty, double price) {
             int new_pos = pos + qty;
             avg_cost_ = (avg_cost_ * pos + price * qty) / (double)new_pos;
             position_ = new_pos;
-            return;
+            return 0.0;
         } else {
             // Sell reduces or flips
             int close_qty = std::min(qty, pos);
-            realized_pnl_ += (price - avg_cost_) * (double)close_qty;
+            double realized = (price - avg_cost_) * (double)close_qty;
+            realized_pnl_ += realized;
 
             int remaining_long = pos - close_qty;
             int leftover_sell = qty - close_qty;
 
             if (remaining_long > 0) {
                 position_ = remaining_long; // Still long
-                return;
+                return realized;
             }
 
             // Now flat
@@ -46,7 +47,7 @@ void PositionTracker::on_fill(Side side, int qty, double price) {
                 position_ = -leftover_sell;
                 avg_cost_ = price;
             }
-            return;
+            return realized;
         }
     }
 
@@ -58,18 +59,19 @@ void PositionTracker::on_fill(Side side, int qty, double price) {
         int new_abs = abs_pos + qty;
         avg_cost_ = (avg_cost_ * abs_pos + price * qty) / (double)new_abs;
         position_ = -new_abs;
-        return;
+        return 0.0;
     } else {
         // Buy reduces or flips
         int close_qty = std::min(qty, abs_pos);
-        realized_pnl_ += (avg_cost_ - price) * (double)close_qty;
+        double realized = (avg_cost_ - price) * (double)close_qty;
+        realized_pnl_ += realized;
 
         int remaining_short = abs_pos - close_qty;
         int leftover_buy = qty - close_qty;
 
         if (remaining_short > 0) {
             position_ = -remaining_short; // Still short
-            return;
+            return realized;
         }
 
         // Now flat
@@ -81,6 +83,19 @@ void PositionTracker::on_fill(Side side, int qty, double price) {
             position_ = leftover_buy;
             avg_cost_ = price;
         }
-        return;
+        return realized;
     }
 }
+
+const PositionTracker& PositionBook::get(const std::string& symbol) const {
+    static const PositionTracker flat;
+    auto it = by_symbol_.find(symbol);
+    if (it == by_symbol_.end()) return flat;
+    return it->second;
+}
+
+double PositionBook::realized_pnl() const {
+    double total = 0.0;
+    for (const auto& kv : by_symbol_) total += kv.second.realized_pnl();
+    return total;
+}
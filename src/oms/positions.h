@@ -1,19 +1,40 @@
 #pragma once
 
+#include <string>
+#include <unordered_map>
+
 #include "oms/orders.h"
 
-// Tracks net position + average cost + realized pnl (one symbol ABC)
+// Tracks net position + average cost + realized pnl for one symbol
 class PositionTracker {
 public:
-    void on_fill(Side side, int qty, double price);
+    // Returns the PnL this fill realized (0 unless it reduced the position)
+    double on_fill(Side side, int qty, double price);
 
     int position() const { return position_; }
     double avg_cost() const { return avg_cost_; }
-    // Realized PnL only (unrealized is intentionally omitted)
     double realized_pnl() const { return realized_pnl_; }
+    // Open position marked at `mark` (same sign convention for long and short)
+    double unrealized_pnl(double mark) const { return (double)position_ * (mark - avg_cost_); }
 
 private:
     int position_ = 0;         // >0 long, <0 short
     double avg_cost_ = 0.0;    // Avg entry of current net position
     double realized_pnl_ = 0.0;
 };
+
+// One PositionTracker per symbol, created on first fill
+class PositionBook {
+public:
+    PositionTracker& at(const std::string& symbol) { return by_symbol_[symbol]; }
+
+    // Flat tracker if the symbol has never traded
+    const PositionTracker& get(const std::string& symbol) const;
+
+    double realized_pnl() const; // Sum over all symbols
+
+    const std::unordered_map<std::string, PositionTracker>& all() const { return by_symbol_; }
+
+private:
+    std::unordered_map<std::string, PositionTracker> by_symbol_;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Why the OMS's own risk gate refused a message
+// Kept as a code on the hot path; turned into text only when displayed
+enum class RejectCode : uint8_t {
+    None,
+    BadInput,
+    MaxOrderQty,
+    MaxNotional,
+    MaxOpenOrders,
+    MaxPosition,
+    PriceBand,
+    OrderRate,
+    CancelRate,
+    KillSwitch
+};
+
+constexpr int kRejectCodeCount = (int)RejectCode::KillSwitch + 1;
+
+// "MAX_NOTIONAL" etc. (shown to users as "RISK_<name>")
+const char* to_string(RejectCode c);
@@ -1,30 +1,335 @@
 #include "oms/risk.h"
+#include "oms/risk_rules.h"
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <fstream>
+#include <system_error>
+#include <unordered_map>
+
+using namespace risk;
+
+const char* to_string(RejectCode c) {
+    switch (c) {
+        case RejectCode::None:          return "NONE";
+        case RejectCode::BadInput:      return "BAD_INPUT";
+        case RejectCode::MaxOrderQty:   return "MAX_ORDER_QTY";
+        case RejectCode::MaxNotional:   return "MAX_NOTIONAL";
+        case RejectCode::MaxOpenOrders: return "MAX_OPEN_ORDERS";
+        case RejectCode::MaxPosition:   return "MAX_POSITION";
+        case RejectCode::PriceBand:     return "PRICE_BAND";
+        case RejectCode::OrderRate:     return "ORDER_RATE";
+        case RejectCode::CancelRate:    return "CANCEL_RATE";
+        case RejectCode::KillSwitch:    return "KILL_SWITCH";
+    }
+    return "UNKNOWN";
+}
+
+bool TokenBucket::try_take(double rate, double burst, double n, int64_t now_ns) {
+    if (rate <= 0.0) return true;
+
+    if (last_ns < 0) {
+        tokens = burst;
+    } else if (now_ns > last_ns) {
+        tokens += (double)(now_ns - last_ns) * rate * 1e-9;
+        if (tokens > burst) tokens = burst;
+    }
+    last_ns = now_ns;
+
+    if (tokens < n) return false;
+    tokens -= n;
+    return true;
+}
+
+bool SharedTokenBucket::try_take(double rate, double burst, int64_t now_ns) {
+    if (rate <= 0.0) return true;
 
-std::string check_new_order(
+    const int64_t per_token = (int64_t)(1e9 / rate);
+    const int64_t depth = (int64_t)(burst * 1e9 / rate);
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    while (true) {
+        int64_t next = std::max(full_at, now_ns) + per_token;
+        if (next - now_ns > depth) return false;
+        if (full_at_ns_.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) return true;
+    }
+}
+
+RejectCode check_new_order(
     const RiskConfig& cfg,
+    RiskState& state,
     const OrderStore& store,
     const PositionTracker& pos,
+    const std::string& symbol,
     Side side,
     int qty,
-    double price
+    double price,
+    int64_t now_ns,
+    int messages
 ) {
-    if (qty <= 0 || price <= 0.0) return "BAD_INPUT";
+    // In our OMS flow we already inserted the order as PendingNew; split, it
+    // is replaced by its children
+    OrderCheck c{cfg, cfg.limits(symbol), state, symbol, qty, price,
+                 store.open_orders_count() + messages - 1, pos.position(), (side == Side::Buy) ? qty : -qty, now_ns,
+                 (double)messages};
+    return NewOrderRules::check(c);
+}
+
+RejectCode check_replace(
+    const RiskConfig& cfg,
+    RiskState& state,
+    const PositionTracker& pos,
+    const Order& o,
+    int new_qty,
+    double new_price,
+    int64_t now_ns
+) {
+    int remaining = new_qty - o.filled_qty;
+    OrderCheck c{cfg, cfg.limits(o.symbol), state, o.symbol, new_qty, new_price,
+                 0, pos.position(), (o.side == Side::Buy) ? remaining : -remaining, now_ns};
+    return ReplaceRules::check(c);
+}
+
+RejectCode check_cancel(const RiskConfig& cfg, RiskState& state, int64_t now_ns) {
+    if (!state.cancels.try_take(cfg.max_cancels_per_sec, cfg.cancel_burst, 1.0, now_ns)) return RejectCode::CancelRate;
+    return RejectCode::None;
+}
+
+RejectCode check_new_order_shard(
+    const RiskConfig& cfg,
+    RiskState& state,
+    FirmRisk& firm,
+    const PositionTracker& pos,
+    const std::string& symbol,
+    Side side,
+    int qty,
+    double price,
+    int64_t now_ns
+) {
+    OrderCheck c{cfg, cfg.limits(symbol), state, symbol, qty, price,
+                 0, pos.position(), (side == Side::Buy) ? qty : -qty, now_ns};
+    RejectCode rc = ShardOrderRules::check(c);
+    if (rc != RejectCode::None) return rc;
+
+    // Claim a slot first; a throttled order gives it straight back
+    if (firm.open_orders.fetch_add(1, std::memory_order_relaxed) >= cfg.max_open_orders) {
+        firm.open_orders.fetch_sub(1, std::memory_order_relaxed);
+        return RejectCode::MaxOpenOrders;
+    }
+    if (!firm.orders.try_take(cfg.max_orders_per_sec, cfg.order_burst, now_ns)) {
+        firm.open_orders.fetch_sub(1, std::memory_order_relaxed);
+        return RejectCode::OrderRate;
+    }
+    return RejectCode::None;
+}
+
+RejectCode check_cancel_shard(const RiskConfig& cfg, FirmRisk& firm, int64_t now_ns) {
+    if (!firm.cancels.try_take(cfg.max_cancels_per_sec, cfg.cancel_burst, now_ns)) return RejectCode::CancelRate;
+    return RejectCode::None;
+}
+
+BasketRiskResult check_basket(
+    const RiskConfig& cfg,
+    RiskState& state,
+    const OrderStore& store,
+    const PositionBook& positions,
+    const std::vector<OrderRequest>& legs,
+    int64_t now_ns
+) {
+    BasketRiskResult res;
+
+    if (legs.empty()) {
+        res.code = RejectCode::BadInput;
+        return res;
+    }
+
+    // Net signed qty per symbol across the basket
+    std::unordered_map<std::string, int> delta;
+    delta.reserve(legs.size());
 
-    if (qty > cfg.max_order_qty) return "MAX_ORDER_QTY";
+    // Legs are already in the store as PendingNew
+    const int open_now = store.open_orders_count();
 
-    double notional = (double)qty * price;
-    if (notional > cfg.max_notional) return "MAX_NOTIONAL";
+    for (size_t i = 0; i < legs.size(); i++) {
+        const OrderRequest& r = legs[i];
+        int d = (r.side == Side::Buy) ? r.qty : -r.qty;
 
-    // In our OMS flow we already inserted the order as PendingNew
-    int open_now = store.open_orders_count();
-    if (open_now > cfg.max_open_orders) return "MAX_OPEN_ORDERS";
+        OrderCheck c{cfg, cfg.limits(r.symbol), state, r.symbol, r.qty, r.price, open_now, 0, d, now_ns};
+        res.code = BasketLegRules::check(c);
+        if (res.code != RejectCode::None) {
+            res.leg = (int)i;
+            return res;
+        }
 
-    int current_pos = pos.position();
-    // Simple check: only current position, not outstanding open orders
-    int new_pos = current_pos + ((side == Side::Buy) ? qty : -qty);
-    if (std::abs(new_pos) > cfg.max_abs_position) return "MAX_POSITION";
+        delta[r.symbol] += d;
+    }
+
+    if (open_now > cfg.max_open_orders) {
+        res.code = RejectCode::MaxOpenOrders;
+        return res;
+    }
+
+    for (const auto& kv : delta) {
+        const RiskLimits& lim = cfg.limits(kv.first);
+        int new_pos = positions.get(kv.first).position() + kv.second;
+        if (std::abs(new_pos) > lim.max_abs_position) {
+            res.code = RejectCode::MaxPosition;
+            return res;
+        }
+    }
+
+    if (!state.orders.try_take(cfg.max_orders_per_sec, cfg.order_burst, (double)legs.size(), now_ns)) {
+        res.code = RejectCode::OrderRate;
+    }
+    return res;
+}
+
+// ---- Config file
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+static bool parse_number(std::string_view v, double& out) {
+    auto r = std::from_chars(v.data(), v.data() + v.size(), out);
+    return !v.empty() && r.ec == std::errc() && r.ptr == v.data() + v.size() && out >= 0.0;
+}
+
+static bool parse_number(std::string_view v, int& out) {
+    auto r = std::from_chars(v.data(), v.data() + v.size(), out);
+    return !v.empty() && r.ec == std::errc() && r.ptr == v.data() + v.size() && out >= 0;
+}
+
+// Sets one per-symbol limit. False if key isn't a limit
+static bool set_limit(RiskLimits& lim, std::string_view key, std::string_view val, bool& ok) {
+    if (key == "max_order_qty") ok = parse_number(val, lim.max_order_qty);
+    else if (key == "max_notional") ok = parse_number(val, lim.max_notional);
+    else if (key == "max_abs_position") ok = parse_number(val, lim.max_abs_position);
+    else if (key == "price_band_pct") ok = parse_number(val, lim.price_band_pct);
+    else return false;
+    return true;
+}
+
+// Sets one firm-wide setting. False if key isn't one
+static bool set_firm(RiskConfig& cfg, std::string_view key, std::string_view val, bool& ok) {
+    if (key == "max_open_orders") ok = parse_number(val, cfg.max_open_orders);
+    else if (key == "max_orders_per_sec") ok = parse_number(val, cfg.max_orders_per_sec);
+    else if (key == "order_burst") ok = parse_number(val, cfg.order_burst);
+    else if (key == "max_cancels_per_sec") ok = parse_number(val, cfg.max_cancels_per_sec);
+    else if (key == "cancel_burst") ok = parse_number(val, cfg.cancel_burst);
+    else return false;
+    return true;
+}
+
+bool load_risk_config(const std::string& path, RiskConfig& out, std::string& err) {
+    std::ifstream in(path);
+    if (!in) {
+        err = "cannot open " + path;
+        return false;
+    }
+
+    // Symbol sections start from the defaults as they stand at that point,
+    // so put the default limits first
+    RiskConfig cfg;
+    RiskLimits* section = nullptr;
+
+    std::string raw;
+    int lineno = 0;
+    while (std::getline(in, raw)) {
+        lineno++;
+        std::string_view line(raw);
+        size_t hash = line.find('#');
+        if (hash != std::string_view::npos) line = line.substr(0, hash);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        const std::string where = path + ":" + std::to_string(lineno) + ": ";
+
+        if (line.front() == '[') {
+            std::string_view sym = (line.back() == ']') ? trim(line.substr(1, line.size() - 2)) : "";
+            if (sym.empty()) {
+                err = where + "bad section";
+                return false;
+            }
+            auto ins = cfg.per_symbol.emplace(std::string(sym), cfg.defaults);
+            section = &ins.first->second;
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string_view::npos) {
+            err = where + "expected key = value";
+            return false;
+        }
+        std::string_view key = trim(line.substr(0, eq));
+        std::string_view val = trim(line.substr(eq + 1));
+
+        bool ok = true;
+        bool known = set_limit(section ? *section : cfg.defaults, key, val, ok);
+        if (!known && !section) known = set_firm(cfg, key, val, ok);
+        if (!known) {
+            err = where + "unknown key '" + std::string(key) + "'" + (section ? " in symbol section" : "");
+            return false;
+        }
+        if (!ok) {
+            err = where + "bad value for " + std::string(key);
+            return false;
+        }
+    }
+
+    out = std::move(cfg);
+    return true;
+}
+
+RiskConfigLoader::RiskConfigLoader() {
+    efd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+RiskConfigLoader::~RiskConfigLoader() {
+    if (worker_.joinable()) worker_.join();
+    delete ready_.exchange(nullptr);
+    if (efd_ >= 0) ::close(efd_);
+}
+
+bool RiskConfigLoader::start(const std::string& path) {
+    if (busy_.exchange(true)) return false;
+
+    // The previous worker has published and is about to exit
+    if (worker_.joinable()) worker_.join();
+
+    worker_ = std::thread([this, path] {
+        auto res = std::make_unique<Result>();
+        res->path = path;
+        auto cfg = std::make_unique<RiskConfig>();
+        if (load_risk_config(path, *cfg, res->error)) res->cfg = std::move(cfg);
+
+        // An earlier result nobody took is superseded
+        delete ready_.exchange(res.release(), std::memory_order_acq_rel);
+        busy_.store(false);
+
+        if (efd_ >= 0) {
+            uint64_t one = 1;
+            (void)!::write(efd_, &one, sizeof(one));
+            woken_.store(true, std::memory_order_release);
+        }
+    });
+    return true;
+}
 
-    return "";
+std::unique_ptr<RiskConfigLoader::Result> RiskConfigLoader::take() {
+    // Drained whether or not a result waits: the worker publishes before it
+    // writes, so an earlier take() can have had the result and left the
+    // wakeup behind, and the fd would poll readable forever. The flag keeps
+    // the read off the loop's every pass
+    if (efd_ >= 0 && woken_.load(std::memory_order_relaxed) && woken_.exchange(false, std::memory_order_acquire)) {
+        uint64_t n;
+        (void)!::read(efd_, &n, sizeof(n));
+    }
+    if (!ready_.load(std::memory_order_relaxed)) return nullptr;
+    return std::unique_ptr<Result>(ready_.exchange(nullptr, std::memory_order_acq_rel));
 }
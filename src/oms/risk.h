@@ -1,24 +1,199 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "oms/orders.h"
 #include "oms/positions.h"
+#include "oms/reject.h"
 
-struct RiskConfig {
+// Limits that can differ per symbol
+struct RiskLimits {
     int max_order_qty = 100;
     double max_notional = 50'000.0;
-    int max_open_orders = 50;
     int max_abs_position = 200;
+
+    // Fat-finger band around the user's reference price (0 = off)
+    // Symbols without a reference price are not banded
+    double price_band_pct = 10.0;
+};
+
+struct RiskConfig {
+    RiskLimits defaults;
+    std::unordered_map<std::string, RiskLimits> per_symbol; // Overrides
+
+    // Firm-wide
+    int max_open_orders = 50;
+
+    // Message-rate throttles (rate 0 = off). Replaces count as orders
+    double max_orders_per_sec = 500.0;
+    double order_burst = 1000.0;
+    double max_cancels_per_sec = 500.0;
+    double cancel_burst = 1000.0;
+
+    const RiskLimits& limits(const std::string& symbol) const {
+        if (per_symbol.empty()) return defaults;
+        auto it = per_symbol.find(symbol);
+        return (it == per_symbol.end()) ? defaults : it->second;
+    }
+};
+
+// Token bucket: refills at `rate` per second up to `burst`, O(1) per check
+struct TokenBucket {
+    double tokens = 0.0;
+    int64_t last_ns = -1; // -1 = never used, starts full
+
+    // Takes n tokens if available. rate <= 0 means unlimited
+    bool try_take(double rate, double burst, double n, int64_t now_ns);
+};
+
+// Mutable state behind the checks: user reference prices and rate buckets
+struct RiskState {
+    std::unordered_map<std::string, double> ref_px; // Set with REFPX
+    TokenBucket orders;
+    TokenBucket cancels;
+    // Non-zero refuses every new order and replace; null = no kill switch.
+    // Set from outside the process, see state_shm.h
+    const std::atomic<uint32_t>* kill_switch = nullptr;
+};
+
+// Token bucket shared between threads, on one atomic (GCRA: the state is
+// when the bucket is full again; each token moves that 1/rate later)
+class SharedTokenBucket {
+public:
+    // One token, same rate and burst as TokenBucket::try_take
+    bool try_take(double rate, double burst, int64_t now_ns);
+
+private:
+    std::atomic<int64_t> full_at_ns_{0};
 };
 
-// Return "" if OK, otherwise a reason like "MAX_NOTIONAL"
-// Simple point-in-time checks only (no market data or fee modeling)
-std::string check_new_order(
+// Firm-wide limits of a symbol-sharded OMS (see sharded_core.h): shared by
+// every shard and updated by each directly, without locks
+struct FirmRisk {
+    std::atomic<int> open_orders{0};
+    SharedTokenBucket orders;
+    SharedTokenBucket cancels;
+};
+
+// All checks are compile-time rule chains (see risk_rules.h): no allocation,
+// no scans. The order throttle runs last so a rejected order doesn't use up
+// a token. Simple point-in-time checks only (no fee modeling).
+
+// messages: how many NEWs the order goes out as (its routed child orders).
+// Each one is an open order and takes an order token
+RejectCode check_new_order(
     const RiskConfig& cfg,
+    RiskState& state,
     const OrderStore& store,
     const PositionTracker& pos,
+    const std::string& symbol,
+    Side side,
+    int qty,
+    double price,
+    int64_t now_ns,
+    int messages = 1
+);
+
+// Amend of a live order: checks the new terms, and position against the
+// order's new remaining qty. Open order count is unchanged by an amend
+RejectCode check_replace(
+    const RiskConfig& cfg,
+    RiskState& state,
+    const PositionTracker& pos,
+    const Order& o,
+    int new_qty,
+    double new_price,
+    int64_t now_ns
+);
+
+// One cancel message (CANCEL, or one MASS_CANCEL) against the cancel throttle
+// Run once the store has said the cancel will go out, so a cancel of an
+// unknown or finished order spends no token
+RejectCode check_cancel(const RiskConfig& cfg, RiskState& state, int64_t now_ns);
+
+// A shard's new order: the per-symbol rules against the shard's own state
+// (ref prices, position), then the firm-wide open order count and order
+// rate. An accepted order holds an open_orders slot; the shard hands it
+// back once the order is done. Runs with the order already in the shard's
+// store as PendingNew, so the slot it claims is what counts it firm-wide
+RejectCode check_new_order_shard(
+    const RiskConfig& cfg,
+    RiskState& state,
+    FirmRisk& firm,
+    const PositionTracker& pos,
+    const std::string& symbol,
     Side side,
     int qty,
-    double price
+    double price,
+    int64_t now_ns
+);
+
+RejectCode check_cancel_shard(const RiskConfig& cfg, FirmRisk& firm, int64_t now_ns);
+
+// Whole-basket check, run after the legs are inserted as PendingNew
+// Per-leg rules, open orders once for the basket, position per symbol
+// against the net basket delta, then one order token per leg. All-or-nothing.
+struct BasketRiskResult {
+    RejectCode code = RejectCode::None;
+    int leg = -1; // Index of the offending leg, -1 if basket-wide
+};
+
+BasketRiskResult check_basket(
+    const RiskConfig& cfg,
+    RiskState& state,
+    const OrderStore& store,
+    const PositionBook& positions,
+    const std::vector<OrderRequest>& legs,
+    int64_t now_ns
 );
+
+// ---- Config file
+//
+//   # firm-wide keys and default limits
+//   max_open_orders = 50
+//   max_order_qty = 100
+//   [XYZ]              # per-symbol overrides of the default limits
+//   max_order_qty = 500
+//
+// Firm-wide: max_open_orders, max_orders_per_sec, order_burst,
+// max_cancels_per_sec, cancel_burst. Limits (default or per symbol):
+// max_order_qty, max_notional, max_abs_position, price_band_pct.
+
+// Returns false and sets err on a bad file; out is untouched then
+bool load_risk_config(const std::string& path, RiskConfig& out, std::string& err);
+
+// Parses a config file on a background thread; the event loop picks up
+// the result with take() and swaps it in, so a reload never blocks the loop
+class RiskConfigLoader {
+public:
+    struct Result {
+        std::string path;
+        std::unique_ptr<RiskConfig> cfg; // Null if the load failed
+        std::string error;
+    };
+
+    RiskConfigLoader();
+    ~RiskConfigLoader();
+
+    // False if a load is already in flight
+    bool start(const std::string& path);
+
+    // Non-blocking: the finished load, once, or null. Also clears notify_fd()
+    std::unique_ptr<Result> take();
+
+    // Readable once a load has finished, for the event loop's poll set
+    int notify_fd() const { return efd_; }
+
+private:
+    std::thread worker_;
+    std::atomic<bool> busy_{false};
+    std::atomic<Result*> ready_{nullptr};
+    int efd_ = -1; // eventfd
+    std::atomic<bool> woken_{false}; // Set once efd_ is written, until take() reads it
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "oms/reject.h"
+#include "oms/risk.h"
+
+// Pre-trade risk as a chain of rules put together at compile time
+// Each rule is a type with a static check(); RuleChain runs them in order
+// and stops at the first reject. No virtual calls, no allocation.
+namespace risk {
+
+// Everything a rule may look at for one order (or one basket leg)
+struct OrderCheck {
+    const RiskConfig& cfg;
+    const RiskLimits& lim; // cfg.limits(symbol), looked up once
+    RiskState& state;
+    const std::string& symbol;
+    int qty;
+    double price;
+    int open_orders; // Already counting this order
+    int position;    // Current position in symbol
+    int pos_delta;   // Signed qty this order would add to position
+    int64_t now_ns;
+    double tokens = 1.0; // Order-rate tokens the message uses
+};
+
+// First in every chain: one relaxed load, and nothing else runs once it's on
+struct KillSwitch {
+    static RejectCode check(const OrderCheck& c) {
+        const std::atomic<uint32_t>* k = c.state.kill_switch;
+        return (k && k->load(std::memory_order_relaxed)) ? RejectCode::KillSwitch : RejectCode::None;
+    }
+};
+
+struct ValidInput {
+    static RejectCode check(const OrderCheck& c) {
+        return (c.qty <= 0 || c.price <= 0.0) ? RejectCode::BadInput : RejectCode::None;
+    }
+};
+
+struct MaxOrderQty {
+    static RejectCode check(const OrderCheck& c) {
+        return (c.qty > c.lim.max_order_qty) ? RejectCode::MaxOrderQty : RejectCode::None;
+    }
+};
+
+struct MaxNotional {
+    static RejectCode check(const OrderCheck& c) {
+        return ((double)c.qty * c.price > c.lim.max_notional) ? RejectCode::MaxNotional : RejectCode::None;
+    }
+};
+
+struct MaxOpenOrders {
+    static RejectCode check(const OrderCheck& c) {
+        return (c.open_orders > c.cfg.max_open_orders) ? RejectCode::MaxOpenOrders : RejectCode::None;
+    }
+};
+
+// Simple check: only current position, not outstanding open orders
+struct MaxPosition {
+    static RejectCode check(const OrderCheck& c) {
+        return (std::abs(c.position + c.pos_delta) > c.lim.max_abs_position) ? RejectCode::MaxPosition
+                                                                               : RejectCode::None;
+    }
+};
+
+// Symbols without a reference price are not banded
+struct PriceBand {
+    static RejectCode check(const OrderCheck& c) {
+        if (c.lim.price_band_pct <= 0.0) return RejectCode::None;
+        auto it = c.state.ref_px.find(c.symbol);
+        if (it == c.state.ref_px.end()) return RejectCode::None;
+        double ref = it->second;
+        return (std::abs(c.price - ref) > ref * c.lim.price_band_pct * 0.01) ? RejectCode::PriceBand
+                                                                             : RejectCode::None;
+    }
+};
+
+// Takes tokens, so it has to be the last rule in a chain
+struct OrderRate {
+    static RejectCode check(OrderCheck& c) {
+        bool ok = c.state.orders.try_take(c.cfg.max_orders_per_sec, c.cfg.order_burst, c.tokens, c.now_ns);
+        return ok ? RejectCode::None : RejectCode::OrderRate;
+    }
+};
+
+template <class... Rules>
+struct RuleChain {
+    static RejectCode check(OrderCheck& c) {
+        RejectCode r = RejectCode::None;
+        (void)(((r = Rules::check(c)) == RejectCode::None) && ...);
+        return r;
+    }
+};
+
+using NewOrderRules = RuleChain<KillSwitch, ValidInput, MaxOrderQty, MaxNotional, MaxOpenOrders, MaxPosition,
+                                PriceBand, OrderRate>;
+
+// Open order count is unchanged by an amend
+using ReplaceRules =
+    RuleChain<KillSwitch, ValidInput, MaxOrderQty, MaxNotional, MaxPosition, PriceBand, OrderRate>;
+
+// A shard's share of NewOrderRules; the firm-wide ones run on FirmRisk
+using ShardOrderRules = RuleChain<KillSwitch, ValidInput, MaxOrderQty, MaxNotional, MaxPosition, PriceBand>;
+
+// Per-leg part of a basket; the basket-wide rules run once in check_basket
+using BasketLegRules = RuleChain<KillSwitch, ValidInput, MaxOrderQty, MaxNotional, PriceBand>;
+
+} // namespace risk
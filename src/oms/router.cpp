@@ -0,0 +1,115 @@
+#include "oms/router.h"
+
+#include <algorithm>
+
+void SmartRouter::on_ack(int venue, int64_t latency_ns) {
+    if (latency_ns < 0) return; // A bad clock pair, not a fast venue
+    VenueStats& s = stats_[(size_t)venue];
+    if (s.acks++ == 0) s.ack_ewma_ns = (double)latency_ns;
+    else s.ack_ewma_ns += kAckAlpha * ((double)latency_ns - s.ack_ewma_ns);
+}
+
+void SmartRouter::on_routed(int venue, int qty) {
+    // Every venue decays, so one that gets no flow drifts back towards the
+    // prior and is eventually tried again
+    for (VenueStats& s : stats_) {
+        s.routed_qty *= kDecay;
+        s.filled_qty *= kDecay;
+        // Long idle venues would otherwise decay into (slow) denormals
+        if (s.routed_qty < 1e-6) s.routed_qty = 0.0;
+        if (s.filled_qty < 1e-6) s.filled_qty = 0.0;
+    }
+    stats_[(size_t)venue].routed_qty += (double)qty;
+}
+
+void SmartRouter::on_fill(int venue, int qty) {
+    VenueStats& s = stats_[(size_t)venue];
+    // Fills of flow routed before the decay can't push the ratio past 1
+    s.filled_qty = std::min(s.filled_qty + (double)qty, s.routed_qty);
+}
+
+double SmartRouter::mean_ack_ns() const {
+    double sum = 0.0;
+    int n = 0;
+    for (const VenueStats& s : stats_) {
+        if (s.acks == 0) continue;
+        sum += s.ack_ewma_ns;
+        n++;
+    }
+    return n ? sum / n : 1e6;
+}
+
+double SmartRouter::score(int venue, double mean_ack_ns) const {
+    const VenueStats& s = stats_[(size_t)venue];
+    double ack_ns = s.acks ? s.ack_ewma_ns : mean_ack_ns;
+    // Fill ratio per ms of ACK latency. Floored at 1us so a venue on the
+    // same box doesn't swamp the fill ratio
+    return s.fill_ratio() / (std::max(ack_ns, 1000.0) / 1e6);
+}
+
+double SmartRouter::score(int venue) const {
+    return score(venue, mean_ack_ns());
+}
+
+void SmartRouter::ranked(std::vector<Ranked>& out) const {
+    const double mean = mean_ack_ns();
+    out.clear();
+    for (int v = 0; v < venues(); v++) {
+        if (stats_[(size_t)v].up) out.push_back({v, score(v, mean)});
+    }
+    if (out.empty()) {
+        for (int v = 0; v < venues(); v++) out.push_back({v, score(v, mean)});
+    }
+    // Insertion sort: a handful of venues, no temp buffer, and stable so
+    // ties keep venue order and routing is deterministic
+    for (size_t i = 1; i < out.size(); i++) {
+        Ranked r = out[i];
+        size_t j = i;
+        for (; j > 0 && out[j - 1].score < r.score; j--) out[j] = out[j - 1];
+        out[j] = r;
+    }
+}
+
+int SmartRouter::best() const {
+    const double mean = mean_ack_ns();
+    int best = -1, any = 0;
+    double best_score = 0.0, any_score = -1.0;
+    for (int v = 0; v < venues(); v++) {
+        double sc = score(v, mean);
+        if (sc > any_score) {
+            any = v;
+            any_score = sc;
+        }
+        if (stats_[(size_t)v].up && (best < 0 || sc > best_score)) {
+            best = v;
+            best_score = sc;
+        }
+    }
+    return best >= 0 ? best : any;
+}
+
+void SmartRouter::route(int qty, std::vector<ChildSlice>& slices) const {
+    std::vector<Ranked>& order = scratch_;
+    ranked(order);
+    slices.clear();
+    if (order.empty()) return;
+
+    // Drop the worst venue while its share would be under the minimum
+    double total = 0.0;
+    for (const Ranked& r : order) total += r.score;
+    while (order.size() > 1 && (double)qty * order.back().score / total < (double)cfg_.min_child_qty) {
+        total -= order.back().score;
+        order.pop_back();
+    }
+
+    // Proportional shares, rounded down; the best venue takes the remainder
+    slices.resize(order.size());
+    int rest = qty;
+    for (size_t i = 1; i < order.size(); i++) {
+        slices[i].venue = order[i].venue;
+        slices[i].qty = (int)((double)qty * order[i].score / total);
+        rest -= slices[i].qty;
+    }
+    slices[0].venue = order[0].venue;
+    slices[0].qty = rest;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "oms/orders.h"
+
+// Live execution quality of one venue, fed from our own order flow
+struct VenueStats {
+    bool up = false;          // Connected; down venues get no new flow
+    double ack_ewma_ns = 0.0; // NEW -> ACK, smoothed; 0 until the first ACK
+    uint64_t acks = 0;
+
+    // Decayed qty totals for the fill ratio, so it follows recent flow
+    double routed_qty = 0.0;
+    double filled_qty = 0.0;
+
+    // Filled / routed, pulled towards 1/2 while there is little flow
+    double fill_ratio() const { return (filled_qty + 1.0) / (routed_qty + 2.0); }
+};
+
+struct RouterConfig {
+    // No child is smaller than this: a venue whose share would be goes
+    // without, and small orders go whole to the best venue
+    int min_child_qty = 100;
+};
+
+// Smart order router
+// Scores every venue as fill ratio per unit of ACK latency and splits each
+// order over the venues that are up, in proportion to their scores. A venue
+// with no ACK yet is scored at the average latency of the others, so new
+// venues get a share of the flow and start being measured.
+class SmartRouter {
+public:
+    static constexpr double kAckAlpha = 0.125; // EWMA weight of a new ACK sample
+    static constexpr double kDecay = 0.99;     // Fill totals decay per routed child
+
+    SmartRouter(int venues, const RouterConfig& cfg) : cfg_(cfg), stats_((size_t)venues) {}
+
+    int venues() const { return (int)stats_.size(); }
+    const VenueStats& stats(int venue) const { return stats_[(size_t)venue]; }
+    const RouterConfig& config() const { return cfg_; }
+
+    void set_up(int venue, bool up) { stats_[(size_t)venue].up = up; }
+    void on_ack(int venue, int64_t latency_ns);
+    void on_routed(int venue, int qty);
+    void on_fill(int venue, int qty);
+
+    // Higher is better
+    double score(int venue) const;
+    // Best venue that is up (any venue if none is)
+    int best() const;
+
+    // Child slices for qty, best venue first. Every slice is at least
+    // min_child_qty except when the whole order goes to one venue. If no
+    // venue is up, all venues are candidates, and their sessions queue the
+    // lines until they reconnect. The contents of out are replaced; pass the
+    // same vector each time so routing stays off the heap
+    void route(int qty, std::vector<ChildSlice>& out) const;
+
+private:
+    struct Ranked {
+        int venue;
+        double score;
+    };
+
+    double mean_ack_ns() const;
+    double score(int venue, double mean_ack_ns) const;
+    // Candidate venues with their scores, best first
+    void ranked(std::vector<Ranked>& out) const;
+
+    RouterConfig cfg_;
+    std::vector<VenueStats> stats_;
+    mutable std::vector<Ranked> scratch_; // Reused by route(), no allocation per order
+};
@@ -0,0 +1,471 @@
+#include "oms/sharded_core.h"
+
+#include "common/clock.h"
+#include "common/mpsc_queue.h"
+
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+static constexpr int kFirstId = 1001;
+static constexpr int kBatch = 256;           // Queue items a shard takes per pass
+static constexpr int kIdleSpins = 2000;      // Passes a shard spins before sleeping
+static constexpr size_t kSendBatch = 16384;  // Bytes the dispatcher sends at once
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// FNV-1a: the same symbol lands on the same shard in every run
+static uint64_t symbol_hash(std::string_view s) {
+    uint64_t h = 14695981039346656037ull;
+    for (char c : s) {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static void pin_to(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) std::cerr << "oms: cannot pin shard to cpu " << cpu << ": " << std::strerror(rc) << "\n";
+}
+
+// A shard's input besides order entry: a venue message for one of its
+// orders, or a reference price for one of its symbols
+struct ShardedCore::ShardEvent {
+    enum class Kind : uint8_t { Venue, RefPrice };
+    static constexpr size_t kMaxText = 31;
+
+    Kind kind = Kind::Venue;
+    MsgKind msg = MsgKind::Unknown;
+    int client_id = 0;
+    int venue_id = 0;
+    int qty = 0;
+    double price = 0.0;
+    char text[kMaxText + 1] = {}; // Reject reason, or the RefPrice symbol
+};
+
+// One encoded line on its way from a shard to the dispatcher
+struct ShardedCore::OutLine {
+    static constexpr size_t kMaxLen = 126;
+
+    uint16_t len = 0;
+    char data[kMaxLen];
+};
+
+struct ShardedCore::Shard {
+    int index = 0;
+    int cpu = -1;
+    int next_id = 0; // Steps by the shard count
+
+    OrderStore store; // No log: shard threads would interleave on it
+    PositionBook positions;
+    RiskState risk; // Reference prices; the rate buckets are firm-wide
+    OrderEntry entry;
+    OrderTemplates templates; // NEW lines of this shard's symbols
+
+    MpscQueue<ShardEvent> inbox; // From the dispatcher and set_ref_price()
+    Wakeup inbox_wake;
+    MpscQueue<OutLine> outbox;   // To the dispatcher
+
+    int counted_open = 0; // This shard's share of FirmRisk::open_orders
+    double realized_pnl = 0.0;
+
+    // Published for stats(), written by the shard only
+    alignas(64) std::atomic<uint64_t> orders{0};
+    std::atomic<uint64_t> rejects{0};
+    std::atomic<uint64_t> fills{0};
+    std::atomic<uint64_t> venue_msgs{0};
+    std::atomic<int> open_orders{0};
+    std::atomic<double> pnl{0.0};
+
+    Shard(int i, size_t capacity) : index(i), entry(capacity), inbox(capacity), outbox(capacity) {}
+};
+
+static Session::Options session_opts() {
+    Session::Options o;
+    o.name = "oms_sharded";
+    return o;
+}
+
+ShardedCore::ShardedCore(const ShardedOptions& opts)
+    : opts_(opts), log_(opts_.log ? opts_.log : &null_log_), session_(session_opts()) {
+    const int n = std::max(opts_.shards, 1);
+    const int cores = (int)std::thread::hardware_concurrency();
+    for (int i = 0; i < n; i++) {
+        auto s = std::make_unique<Shard>(i, opts_.queue_capacity);
+        s->next_id = kFirstId + ((i - kFirstId % n) % n + n) % n;
+        if (!opts_.cpus.empty()) s->cpu = opts_.cpus[(size_t)i % opts_.cpus.size()];
+        else if (cores > n) s->cpu = i + 1;
+        shards_.push_back(std::move(s));
+    }
+}
+
+ShardedCore::~ShardedCore() {
+    stop_.store(true);
+    for (auto& s : shards_) s->inbox_wake.notify();
+    for (std::thread& t : threads_) t.join();
+}
+
+bool ShardedCore::start() {
+    if (!opts_.risk_path.empty()) {
+        std::string err;
+        if (!load_risk_config(opts_.risk_path, risk_cfg_, err)) {
+            std::cerr << "oms: risk config: " << err << "\n";
+            return false;
+        }
+        log() << "oms: risk config " << opts_.risk_path << " symbol_overrides=" << risk_cfg_.per_symbol.size()
+              << "\n";
+    }
+
+    std::unique_ptr<Connection> conn = connect_transport(opts_.transport, opts_.venue_ip.c_str(), opts_.venue_port);
+    if (!conn) {
+        std::cerr << "oms: venue not reachable\n";
+        return false;
+    }
+    session_.attach(std::move(conn));
+    session_.logon();
+    log() << "oms: connected to " << opts_.venue_ip << ":" << opts_.venue_port << "\n";
+
+    for (auto& sp : shards_) {
+        Shard* s = sp.get();
+        threads_.emplace_back([this, s] { run_shard(*s); });
+    }
+    log() << "oms: " << shards_.size() << " shard(s)";
+    for (const auto& s : shards_) {
+        if (s->cpu >= 0) log() << " " << s->index << "@cpu" << s->cpu;
+    }
+    log() << "\n";
+    return true;
+}
+
+int ShardedCore::shard_of(std::string_view symbol) const {
+    return (int)(symbol_hash(symbol) % shards_.size());
+}
+
+int ShardedCore::shard_of_id(int client_id) const {
+    return client_id % (int)shards_.size();
+}
+
+bool ShardedCore::submit(std::string_view symbol, Side side, int qty, double price,
+                         OrderCallback cb, void* ctx, uint64_t tag) {
+    return shards_[(size_t)shard_of(symbol)]->entry.submit(symbol, side, qty, price, cb, ctx, tag);
+}
+
+bool ShardedCore::cancel(int client_id) {
+    if (client_id < kFirstId) return false;
+    return shards_[(size_t)shard_of_id(client_id)]->entry.cancel(client_id);
+}
+
+bool ShardedCore::set_ref_price(std::string_view symbol, double px) {
+    if (symbol.empty() || symbol.size() > ShardEvent::kMaxText || px <= 0.0) return false;
+    ShardEvent ev;
+    ev.kind = ShardEvent::Kind::RefPrice;
+    ev.price = px;
+    std::memcpy(ev.text, symbol.data(), symbol.size());
+    Shard& s = *shards_[(size_t)shard_of(symbol)];
+    if (!s.inbox.push(ev)) return false;
+    s.inbox_wake.notify();
+    return true;
+}
+
+ShardedCore::ShardStats ShardedCore::stats(int shard) const {
+    const Shard& s = *shards_[(size_t)shard];
+    ShardStats st;
+    st.orders = s.orders.load(std::memory_order_relaxed);
+    st.rejects = s.rejects.load(std::memory_order_relaxed);
+    st.fills = s.fills.load(std::memory_order_relaxed);
+    st.venue_msgs = s.venue_msgs.load(std::memory_order_relaxed);
+    st.open_orders = s.open_orders.load(std::memory_order_relaxed);
+    st.realized_pnl = s.pnl.load(std::memory_order_relaxed);
+    return st;
+}
+
+void ShardedCore::print_status(std::ostream& out) const {
+    out << "oms: STATUS shards=" << shards_.size()
+        << " firm_open_orders=" << firm_.open_orders.load(std::memory_order_relaxed) << "\n";
+    double pnl = 0.0;
+    for (int i = 0; i < shards(); i++) {
+        ShardStats st = stats(i);
+        pnl += st.realized_pnl;
+        out << "  shard " << i << ": orders=" << st.orders << " rejects=" << st.rejects << " fills=" << st.fills
+            << " open=" << st.open_orders << " realized_pnl=" << st.realized_pnl << "\n";
+    }
+    out << "  realized_pnl=" << pnl << "\n";
+}
+
+// ---- Shard threads
+
+void ShardedCore::run_shard(Shard& s) {
+    if (s.cpu >= 0) pin_to(s.cpu);
+    // Here, not in the constructor: the node pools are per thread, and the
+    // ones to warm are this thread's, on its own CPU
+    s.store.reserve((size_t)std::max(opts_.max_orders, 0));
+
+    // Spinning on one core only keeps the producers off it
+    static const int spins = (std::thread::hardware_concurrency() > 1) ? kIdleSpins : 0;
+    int idle = 0;
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (drain_shard(s)) {
+            idle = 0;
+            continue;
+        }
+        if (idle++ < spins) {
+            cpu_relax();
+            continue;
+        }
+        idle = 0;
+
+        bool sleep = s.inbox_wake.prepare_wait([&] { return !s.inbox.empty() || stop_.load(); });
+        sleep = sleep && s.entry.prepare_wait();
+        if (sleep) {
+            pollfd fds[2] = {{s.inbox_wake.fd(), POLLIN, 0}, {s.entry.notify_fd(), POLLIN, 0}};
+            ::poll(fds, 2, -1);
+        }
+        s.inbox_wake.clear();
+        s.entry.drain_wakeup();
+    }
+}
+
+bool ShardedCore::drain_shard(Shard& s) {
+    bool any = false;
+
+    // Venue messages first: fills and cancels free up firm-wide limits
+    ShardEvent ev;
+    for (int n = 0; n < kBatch && s.inbox.pop(ev); n++) {
+        on_event(s, ev);
+        any = true;
+    }
+    EntryRequest req;
+    for (int n = 0; n < kBatch && s.entry.pop(req); n++) {
+        if (req.kind == EntryRequest::Kind::Cancel) on_cancel(s, req.client_id);
+        else on_new(s, req);
+        any = true;
+    }
+    if (!any) return false;
+
+    // Closed orders hand their slots back in one update per pass
+    const int open = s.store.open_orders_count();
+    if (open != s.counted_open) {
+        firm_.open_orders.fetch_add(open - s.counted_open, std::memory_order_relaxed);
+        s.counted_open = open;
+    }
+    s.open_orders.store(open, std::memory_order_relaxed);
+    s.pnl.store(s.realized_pnl, std::memory_order_relaxed);
+    out_wake_.notify();
+    return true;
+}
+
+void ShardedCore::emit(Shard& s, std::string_view line) {
+    OutLine l;
+    std::memcpy(l.data, line.data(), line.size());
+    l.len = (uint16_t)line.size();
+    // Never dropped: the order is already accepted. The dispatcher
+    // empties outboxes even while it waits on a full inbox
+    while (!s.outbox.push(l)) {
+        out_wake_.notify();
+        std::this_thread::yield();
+    }
+}
+
+void ShardedCore::on_new(Shard& s, const EntryRequest& req) {
+    const int client_id = s.next_id;
+    s.next_id += shards();
+    const std::string symbol(req.symbol_view());
+    s.store.add_pending_new(client_id, symbol, req.side, req.qty, req.price);
+
+    // Built before the risk gate, so an order that can't go out takes no
+    // slot; that includes a line too long for the outbox
+    WireBuf fallback;
+    std::string_view line = s.templates.new_line(symbol, req.side, client_id, req.qty, req.price, fallback);
+    RejectCode rc = RejectCode::BadInput;
+    if (!line.empty() && line.size() <= OutLine::kMaxLen) {
+        rc = check_new_order_shard(risk_cfg_, s.risk, firm_, s.positions.get(symbol), symbol, req.side, req.qty,
+                                   req.price, mono_ns());
+    }
+    if (rc != RejectCode::None) {
+        s.store.mark_rejected(client_id, rc);
+        s.entry.reject(client_id, rc, req.cb, req.ctx, req.tag);
+        s.rejects.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // The slot check_new_order_shard took
+    s.counted_open++;
+
+    s.store.set_venue(client_id, 0);
+    s.store.set_sent_ns(client_id, mono_ns());
+    emit(s, line);
+    s.entry.watch(client_id, req.cb, req.ctx, req.tag);
+    s.orders.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ShardedCore::on_cancel(Shard& s, int client_id) {
+    // Validated before the throttle, which only sees cancels that go out
+    WireBuf wire;
+    if (!encode_msg(make_cancel(client_id), wire) || wire.len > OutLine::kMaxLen || !s.store.can_cancel(client_id) ||
+        check_cancel_shard(risk_cfg_, firm_, mono_ns()) != RejectCode::None) {
+        s.entry.cancel_rejected(s.store, client_id);
+        return;
+    }
+    s.store.request_cancel(client_id);
+    emit(s, wire.view());
+}
+
+void ShardedCore::on_event(Shard& s, const ShardEvent& ev) {
+    if (ev.kind == ShardEvent::Kind::RefPrice) {
+        s.risk.ref_px[ev.text] = ev.price;
+        return;
+    }
+
+    s.venue_msgs.fetch_add(1, std::memory_order_relaxed);
+    switch (ev.msg) {
+        case MsgKind::Ack:
+            s.store.on_ack(ev.client_id, ev.venue_id);
+            s.entry.on_order_event(s.store, ev.client_id, OrderEventType::Ack);
+            break;
+        case MsgKind::Fill: {
+            const Order* o = s.store.get(ev.client_id);
+            if (o) s.realized_pnl += s.positions.at(o->symbol).on_fill(o->side, ev.qty, ev.price);
+            s.store.on_fill(ev.client_id, ev.venue_id, ev.qty, ev.price);
+            s.entry.on_order_event(s.store, ev.client_id, OrderEventType::Fill, ev.qty, ev.price);
+            s.fills.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case MsgKind::Cancelled:
+            s.store.on_cancelled(ev.client_id, ev.venue_id);
+            s.entry.on_order_event(s.store, ev.client_id, OrderEventType::Cancelled);
+            break;
+        case MsgKind::Reject:
+            s.store.on_venue_reject(ev.client_id, "VENUE_" + std::string(ev.text));
+            s.entry.on_order_event(s.store, ev.client_id, OrderEventType::Rejected, 0, 0.0, ev.text);
+            break;
+        default:
+            break;
+    }
+}
+
+// ---- Dispatcher
+
+void ShardedCore::push_event(Shard& s, const ShardEvent& ev) {
+    // The shard may itself be waiting for its outbox to drain
+    while (!s.inbox.push(ev)) {
+        flush_out();
+        std::this_thread::yield();
+    }
+    s.inbox_wake.notify();
+}
+
+void ShardedCore::flush_out() {
+    // A failed send still leaves the lines in the session's replay ring.
+    // Outboxes keep draining so no shard blocks in emit(); poll() reports
+    // the connection lost
+    auto send = [&] {
+        if (!session_.send(batch_) && !write_failed_) {
+            std::cerr << "oms: venue write failed\n";
+            write_failed_ = true;
+        }
+        batch_.clear();
+    };
+    OutLine l;
+    for (auto& sp : shards_) {
+        while (sp->outbox.pop(l)) {
+            batch_.append(l.data, l.len);
+            if (batch_.size() >= kSendBatch) send();
+        }
+    }
+    if (!batch_.empty()) send();
+}
+
+void ShardedCore::dispatch(const std::string& line) {
+    Msg m = parse_msg(line);
+    switch (m.kind) {
+        case MsgKind::Ack:
+        case MsgKind::Fill:
+        case MsgKind::Cancelled:
+        case MsgKind::Reject:
+            break;
+        default:
+            return; // Nothing else is for a shard
+    }
+    if (m.client_id < kFirstId) {
+        log() << "oms: venue: " << line << "\n";
+        return;
+    }
+
+    ShardEvent ev;
+    ev.msg = m.kind;
+    ev.client_id = m.client_id;
+    ev.venue_id = m.venue_id;
+    ev.qty = m.qty;
+    ev.price = m.price;
+    size_t n = std::min(m.reason.size(), ShardEvent::kMaxText);
+    std::memcpy(ev.text, m.reason.data(), n);
+    push_event(*shards_[(size_t)shard_of_id(m.client_id)], ev);
+}
+
+bool ShardedCore::poll(int timeout_ms) {
+    Connection* conn = session_.connection();
+    if (!conn) return false;
+    flush_out();
+    if (write_failed_) return false;
+
+    int wait_ms = session_.timer_ms(mono_ns());
+    if (timeout_ms >= 0 && (wait_ms < 0 || timeout_ms < wait_ms)) wait_ms = timeout_ms;
+
+    bool readable = conn->has_line();
+    if (!readable) {
+        auto queued = [&] {
+            for (const auto& s : shards_) {
+                if (!s->outbox.empty()) return true;
+            }
+            return false;
+        };
+        if (out_wake_.prepare_wait(queued)) {
+            conn->flush();
+            pollfd fds[2] = {{out_wake_.fd(), POLLIN, 0}, {conn->fd(), POLLIN, 0}};
+            // Shared memory has no fd: check the lines, then wait on the ring briefly
+            const bool shm = conn->fd() < 0;
+            int rc = ::poll(fds, 2, shm ? 0 : wait_ms);
+            if (rc < 0 && errno != EINTR) {
+                std::cerr << "poll() failed: " << std::strerror(errno) << "\n";
+                return false;
+            }
+            const short ready_mask = POLLIN | POLLHUP | POLLERR;
+            if (shm) readable = conn->wait_readable((rc > 0 || wait_ms == 0) ? 0 : 1);
+            else readable = rc > 0 && (fds[1].revents & ready_mask) != 0;
+        }
+        out_wake_.clear();
+    }
+
+    if (!session_.on_timer(mono_ns())) {
+        std::cerr << "oms: venue heartbeat timeout\n";
+        return false;
+    }
+    flush_out();
+    if (write_failed_) return false;
+
+    // Everything the venue has buffered, not one line per pass
+    while (readable) {
+        Session::ReadResult rr = session_.read(line_);
+        if (rr == Session::ReadResult::Closed) {
+            std::cerr << "oms: venue disconnected\n";
+            return false;
+        }
+        if (rr == Session::ReadResult::Reset) log() << "oms: WARN venue restarted, its view of our orders is gone\n";
+        if (rr == Session::ReadResult::Data) dispatch(line_);
+        readable = session_.connection()->has_line();
+    }
+    flush_out();
+    return !write_failed_;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/messages.h"
+#include "common/session.h"
+#include "common/transport.h"
+#include "common/wakeup.h"
+#include "oms/order_entry.h"
+#include "oms/order_templates.h"
+#include "oms/risk.h"
+
+struct ShardedOptions {
+    std::string venue_ip = "127.0.0.1";
+    int venue_port = 9001;
+    TransportOptions transport;
+
+    int shards = 2;
+    // Shard i runs on cpus[i % size]. Empty = shard i on core i + 1 (core 0
+    // is left to the dispatcher), unpinned when there aren't enough cores
+    std::vector<int> cpus;
+
+    std::string risk_path;        // Empty = built-in limits
+    int max_orders = 65536;       // Per shard, like OmsOptions::max_orders
+    size_t queue_capacity = 4096; // Each of a shard's queues
+
+    std::ostream* log = nullptr; // Startup and venue lines only, null = quiet
+};
+
+// The order path split by symbol over worker threads
+//
+// Each shard owns the order store, positions and per-symbol risk state of
+// the symbols that hash to it, on a thread of its own (pinned to a core),
+// and is the only thread that touches them. Nothing is locked:
+//   * submit() and cancel() go straight into the owning shard's order
+//     entry queue from the caller's thread
+//   * the dispatcher (the thread calling poll()) owns the venue session;
+//     it hands each venue message to the shard in its client_id, since a
+//     shard only hands out ids with its own remainder mod shards
+//   * shards queue their NEW/CANCEL lines back to the dispatcher, which
+//     sends them in batches
+//   * firm-wide limits (open orders, order and cancel rates) are atomics
+//     in FirmRisk that every shard checks and updates itself
+//
+// Order events are called on the owning shard's thread. A subset of
+// OmsCore: one venue, no routing, algos, baskets, replace or ledger, and
+// the risk config is fixed once started.
+class ShardedCore {
+public:
+    explicit ShardedCore(const ShardedOptions& opts);
+    // Stops and joins the shards
+    ~ShardedCore();
+
+    ShardedCore(const ShardedCore&) = delete;
+    ShardedCore& operator=(const ShardedCore&) = delete;
+
+    // Loads the risk config, connects the venue and starts the shards.
+    // False (with a message on stderr) if it can't run
+    bool start();
+
+    // One dispatcher pass: waits up to timeout_ms (-1 = until something
+    // happens) for venue input or queued lines, then handles them. False
+    // once the venue connection is lost or poll fails
+    bool poll(int timeout_ms);
+
+    // ---- Any thread. False if the shard's queue is full or the arguments
+    // are bad; the order's events go to cb as with OrderEntry
+    bool submit(std::string_view symbol, Side side, int qty, double price,
+                OrderCallback cb, void* ctx, uint64_t tag = 0);
+    bool cancel(int client_id);
+    bool set_ref_price(std::string_view symbol, double px);
+
+    int shards() const { return (int)shards_.size(); }
+    int shard_of(std::string_view symbol) const;
+    int shard_of_id(int client_id) const;
+
+    // Counters a shard publishes as it goes; read from any thread
+    struct ShardStats {
+        uint64_t orders = 0;  // Accepted by risk and sent
+        uint64_t rejects = 0; // By risk
+        uint64_t fills = 0;
+        uint64_t venue_msgs = 0;
+        int open_orders = 0;
+        double realized_pnl = 0.0;
+    };
+    ShardStats stats(int shard) const;
+    const FirmRisk& firm() const { return firm_; }
+
+    void print_status(std::ostream& out) const;
+
+private:
+    struct Shard;
+    struct ShardEvent;
+    struct OutLine;
+
+    std::ostream& log() const { return *log_; }
+
+    void run_shard(Shard& s);
+    bool drain_shard(Shard& s);
+    void on_new(Shard& s, const EntryRequest& req);
+    void on_cancel(Shard& s, int client_id);
+    void on_event(Shard& s, const ShardEvent& ev);
+    // Queues one encoded line for the dispatcher. The caller has checked
+    // that it fits an OutLine, before the order or cancel was taken
+    void emit(Shard& s, std::string_view line);
+    void push_event(Shard& s, const ShardEvent& ev);
+
+    // Sends what the shards queued; a failed send sets write_failed_
+    void flush_out();
+    void dispatch(const std::string& line);
+
+    ShardedOptions opts_;
+    std::ostream null_log_{nullptr};
+    std::ostream* log_;
+
+    RiskConfig risk_cfg_;
+    FirmRisk firm_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> stop_{false};
+    bool write_failed_ = false; // Dispatcher thread; poll() returns false from then on
+
+    Session session_;
+    Wakeup out_wake_; // Shards -> dispatcher: lines queued
+    std::string line_;
+    std::string batch_;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,190 @@
+#include "oms/state_shm.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace {
+
+constexpr uint32_t kStateMagic = 0x4f4d5301; // "OMS" + layout version; a new layout gets a new number
+
+// One symbol per cache line, so a reader copying one never slows another's publish
+struct alignas(64) SymbolSlot {
+    Seqlock<SymbolState> lock;
+};
+
+static_assert(sizeof(SymbolSlot) == 64, "a symbol record should fit one cache line");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm state needs address-free atomics");
+static_assert(std::atomic<int32_t>::is_always_lock_free, "shm state needs address-free atomics");
+
+} // namespace
+
+struct StateSegment {
+    std::atomic<uint32_t> magic{0};
+    std::atomic<int32_t> pid{0}; // Publishing OMS, 0 = none
+    // Written by monitors, so away from what the OMS writes
+    alignas(64) std::atomic<uint32_t> kill_switch{0};
+    alignas(64) std::atomic<int32_t> symbol_count{0};
+    Seqlock<FirmSummary> firm;
+    SymbolSlot symbols[kStateMaxSymbols];
+};
+
+namespace {
+
+// Maps the segment at its full size; resized = it was new or another size
+// and is still to be initialized. False with a message on stderr
+bool map_segment(const std::string& name, int flags, bool& resized, void*& mem) {
+    int fd = ::shm_open(name.c_str(), flags, 0600);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) < 0) {
+        std::cerr << "fstat() failed: " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    resized = false;
+    if ((size_t)st.st_size != sizeof(StateSegment)) {
+        if (!(flags & O_CREAT)) {
+            std::cerr << "shm " << name << " is not an OMS state segment\n";
+            ::close(fd);
+            return false;
+        }
+        if (::ftruncate(fd, sizeof(StateSegment)) < 0) {
+            std::cerr << "ftruncate() failed: " << std::strerror(errno) << "\n";
+            ::close(fd);
+            return false;
+        }
+        resized = true;
+    }
+
+    mem = ::mmap(nullptr, sizeof(StateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "mmap() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ---- Publisher
+
+StatePublisher::~StatePublisher() {
+    if (!seg_) return;
+    seg_->pid.store(0, std::memory_order_release);
+    ::munmap(seg_, sizeof(StateSegment));
+}
+
+bool StatePublisher::open(const std::string& name) {
+    bool resized = false;
+    void* mem = nullptr;
+    if (!map_segment(name, O_CREAT | O_RDWR, resized, mem)) return false;
+    StateSegment* seg = static_cast<StateSegment*>(mem);
+
+    if (resized || seg->magic.load(std::memory_order_acquire) != kStateMagic) {
+        seg = new (mem) StateSegment();
+        seg->magic.store(kStateMagic, std::memory_order_release);
+    } else {
+        // Seqlocks have one writer; a second live OMS would tear them
+        int other = seg->pid.load(std::memory_order_acquire);
+        if (other != 0 && other != (int)::getpid() && (::kill(other, 0) == 0 || errno == EPERM)) {
+            std::cerr << "shm " << name << " is published by pid " << other << "\n";
+            ::munmap(mem, sizeof(StateSegment));
+            return false;
+        }
+        // Everything but the kill switch starts over with this run. A writer
+        // that died mid-store left its sequence odd, which no reader would
+        // ever get past; count first, so readers stop looking at the slots
+        seg->symbol_count.store(0, std::memory_order_release);
+        new (&seg->firm) Seqlock<FirmSummary>();
+        for (SymbolSlot& slot : seg->symbols) new (&slot) SymbolSlot();
+    }
+    seg->pid.store((int32_t)::getpid(), std::memory_order_release);
+    seg_ = seg;
+    slots_.clear();
+    return true;
+}
+
+const std::atomic<uint32_t>* StatePublisher::kill_switch() const {
+    return &seg_->kill_switch;
+}
+
+void StatePublisher::publish_firm(const FirmSummary& s) {
+    seg_->firm.store(s);
+}
+
+bool StatePublisher::publish_symbol(const std::string& symbol, SymbolState s) {
+    std::strncpy(s.symbol, symbol.c_str(), sizeof(s.symbol) - 1);
+    s.symbol[sizeof(s.symbol) - 1] = '\0';
+
+    auto it = slots_.find(symbol);
+    if (it != slots_.end()) {
+        seg_->symbols[it->second].lock.store(s);
+        return true;
+    }
+    if ((int)slots_.size() >= kStateMaxSymbols) return false;
+
+    // Record first, then the count that makes readers look at it
+    int slot = (int)slots_.size();
+    slots_.emplace(symbol, slot);
+    seg_->symbols[slot].lock.store(s);
+    seg_->symbol_count.store(slot + 1, std::memory_order_release);
+    return true;
+}
+
+// ---- Reader
+
+StateReader::~StateReader() {
+    if (seg_) ::munmap(seg_, sizeof(StateSegment));
+}
+
+bool StateReader::open(const std::string& name) {
+    bool resized = false;
+    void* mem = nullptr;
+    if (!map_segment(name, O_RDWR, resized, mem)) return false;
+    StateSegment* seg = static_cast<StateSegment*>(mem);
+    if (seg->magic.load(std::memory_order_acquire) != kStateMagic) {
+        std::cerr << "shm " << name << " is not an OMS state segment (or another layout version)\n";
+        ::munmap(mem, sizeof(StateSegment));
+        return false;
+    }
+    seg_ = seg;
+    return true;
+}
+
+int StateReader::pid() const {
+    return seg_->pid.load(std::memory_order_acquire);
+}
+
+bool StateReader::firm(FirmSummary& out) const {
+    return seg_->firm.load(out);
+}
+
+int StateReader::symbols() const {
+    return std::min(seg_->symbol_count.load(std::memory_order_acquire), kStateMaxSymbols);
+}
+
+bool StateReader::symbol(int i, SymbolState& out) const {
+    if (i < 0 || i >= symbols()) return false;
+    return seg_->symbols[i].lock.load(out);
+}
+
+bool StateReader::kill_switch() const {
+    return seg_->kill_switch.load(std::memory_order_acquire) != 0;
+}
+
+void StateReader::set_kill_switch(bool on) {
+    seg_->kill_switch.store(on ? 1 : 0, std::memory_order_release);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "common/seqlock.h"
+
+// Live OMS state in a /dev/shm segment, for tools outside the process
+//
+// The OMS publishes a firm-wide summary and one record per traded symbol,
+// each under its own seqlock: publishing is a handful of plain stores and
+// never waits on a reader. oms_monitor maps the same segment read-mostly.
+// The one thing a reader writes is the kill switch, which the OMS's risk
+// gate loads on every new order (see risk::KillSwitch).
+//
+// The segment outlives the OMS, so a kill switch that is on stays on
+// across an OMS restart until somebody turns it off.
+
+constexpr const char* kDefaultStateShmName = "/mini_oms_state";
+constexpr int kStateMaxSymbols = 1024;
+
+struct FirmSummary {
+    int64_t ts_ns = 0; // Wall clock of this publish
+    int32_t open_orders = 0;
+    int32_t max_open_orders = 0;
+    double realized_pnl = 0.0;
+    double unrealized_pnl = 0.0; // Symbols with a market data mark only
+    double order_tokens = 0.0;   // Left in the order throttle
+    double order_burst = 0.0;
+    double orders_per_sec = 0.0; // 0 = unthrottled
+    int32_t venues_up = 0;
+    int32_t venues = 0;
+    int32_t kill_active = 0; // Kill switch as the risk gate last saw it
+    int32_t symbols = 0;
+};
+
+struct SymbolState {
+    char symbol[16] = {}; // NUL-terminated, cut to 15 chars
+    int32_t position = 0;
+    int32_t max_abs_position = 0;
+    double avg_cost = 0.0;
+    double realized_pnl = 0.0;
+    double mark = 0.0; // 0 = no market data
+    double unrealized_pnl = 0.0;
+};
+
+struct StateSegment;
+
+// OMS side: maps (creating if needed) the segment and publishes into it
+// Single writer: call everything from the OMS thread.
+class StatePublisher {
+public:
+    StatePublisher() = default;
+    ~StatePublisher();
+
+    StatePublisher(const StatePublisher&) = delete;
+    StatePublisher& operator=(const StatePublisher&) = delete;
+
+    // Keeps the kill switch of a segment left by an earlier run and resets
+    // the rest, seqlocks included. False (with a message on stderr) if it
+    // can't be created or mapped
+    bool open(const std::string& name);
+
+    // Never null once open; what the risk gate reads
+    const std::atomic<uint32_t>* kill_switch() const;
+    bool kill_active() const { return kill_switch()->load(std::memory_order_relaxed) != 0; }
+
+    void publish_firm(const FirmSummary& s);
+    // First publish of a symbol takes the next slot; false once they're gone
+    bool publish_symbol(const std::string& symbol, SymbolState s);
+
+    int symbols() const { return (int)slots_.size(); }
+
+private:
+    StateSegment* seg_ = nullptr;
+    std::unordered_map<std::string, int> slots_;
+};
+
+// Monitor side: maps an existing segment
+class StateReader {
+public:
+    StateReader() = default;
+    ~StateReader();
+
+    StateReader(const StateReader&) = delete;
+    StateReader& operator=(const StateReader&) = delete;
+
+    // False (with a message on stderr) if there is no segment or it's not ours
+    bool open(const std::string& name);
+
+    // Pid of the publishing OMS, 0 once it has exited
+    int pid() const;
+    // False if the copy kept tearing (a writer died mid-publish)
+    bool firm(FirmSummary& out) const;
+    int symbols() const;
+    bool symbol(int i, SymbolState& out) const;
+
+    bool kill_switch() const;
+    void set_kill_switch(bool on);
+
+private:
+    StateSegment* seg_ = nullptr;
+};
@@ -1,79 +1,236 @@
+#include "common/clock.h"
 #include "common/net.h"
+#include "common/transport.h"
 #include "common/messages.h"
+#include "common/session.h"
 
-#include <poll.h>
-#include <sys/time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
+#include <random>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-static long long now_us() {
-    timeval tv;
-    gettimeofday(&tv, nullptr);
-    return (long long)tv.tv_sec * 1000000LL + (long long)tv.tv_usec;
-}
-
 struct LiveOrder {
     int client_id = 0;
     int venue_id = 0;
+    std::string symbol;
+    std::string side;
     int qty = 0;
     double price = 0.0;
 
     bool cancelled = false;
     bool filled = false;
+    bool rests = false; // Never fills (see --fill-pct), only cancels
+
+    // Bumped when an amend loses queue priority; older fills are stale
+    int generation = 0;
 };
 
 struct ScheduledFill {
     long long due_us = 0;
     int client_id = 0;
+    int generation = 0;
 };
 
-static void send_reject(int fd, int client_id, const std::string& reason) {
-    std::ostringstream oss;
-    oss << "REJECT " << client_id << " " << reason << "\n";
-    write_all(fd, oss.str());
-    std::cout << "venue_sim: sent: " << oss.str();
+static void send_msg(Session& conn, const Msg& m) {
+    WireBuf wire;
+    if (!encode_msg(m, wire)) return;
+    conn.send(wire.view());
+    std::cout << "venue_sim: sent: " << wire.view();
 }
 
-int main() {
-    const int port = 9001;
+static void send_reject(Session& conn, int client_id, std::string_view reason) {
+    Msg m;
+    m.kind = MsgKind::Reject;
+    m.client_id = client_id;
+    m.reason = reason;
+    send_msg(conn, m);
+}
+
+// ACK / CANCELLED / REPLACED / FILL all echo the order's ids
+static Msg order_msg(MsgKind kind, const LiveOrder& o) {
+    Msg m;
+    m.kind = kind;
+    m.client_id = o.client_id;
+    m.venue_id = o.venue_id;
+    m.qty = o.qty;
+    m.price = o.price;
+    return m;
+}
+
+// Live (not filled, not cancelled) client_ids per symbol for MASS_CANCEL
+using LiveIndex = std::unordered_map<std::string, std::unordered_set<int>>;
+
+static void index_remove(LiveIndex& live, const LiveOrder& o) {
+    auto it = live.find(o.symbol);
+    if (it != live.end()) it->second.erase(o.client_id);
+}
+
+// Top-of-book + trade publisher on UDP loopback. Quotes are synthetic: a
+// two-tick-wide market around a mid that follows fills and drifts a tick
+// at a time between them.
+class MdPublisher {
+public:
+    bool open(int port) {
+        fd_ = udp_socket();
+        port_ = port;
+        return fd_ >= 0;
+    }
+
+    // First order in a symbol seeds its mid
+    void on_new(const std::string& symbol, double price) {
+        if (fd_ < 0) return;
+        if (mids_.emplace(symbol, price).second) publish_bbo(symbol, price);
+    }
+
+    void on_fill(const std::string& symbol, int qty, double price) {
+        if (fd_ < 0) return;
+        Msg m;
+        m.kind = MsgKind::Trade;
+        m.symbol = symbol;
+        m.seq = ++seq_;
+        m.qty = qty;
+        m.price = price;
+        send(m);
+
+        mids_[symbol] = price;
+        publish_bbo(symbol, price);
+    }
+
+    // Random walk every symbol by at most a tick and republish
+    void tick() {
+        if (fd_ < 0) return;
+        std::uniform_int_distribution<int> step(-1, 1);
+        for (auto& kv : mids_) {
+            kv.second = std::max(kTick, kv.second + kTick * step(rng_));
+            publish_bbo(kv.first, kv.second);
+        }
+    }
+
+private:
+    static constexpr double kTick = 0.01;
+    static constexpr int kQuoteQty = 100;
+
+    void publish_bbo(const std::string& symbol, double mid) {
+        Msg m;
+        m.kind = MsgKind::Bbo;
+        m.symbol = symbol;
+        m.seq = ++seq_;
+        m.bid_px = mid - kTick;
+        m.bid_qty = kQuoteQty;
+        m.ask_px = mid + kTick;
+        m.ask_qty = kQuoteQty;
+        send(m);
+    }
+
+    void send(const Msg& m) {
+        WireBuf wire;
+        if (encode_msg(m, wire)) udp_send_loopback(fd_, port_, wire.view());
+    }
+
+    int fd_ = -1;
+    int port_ = 0;
+    uint64_t seq_ = 0;
+    std::unordered_map<std::string, double> mids_;
+    std::mt19937 rng_{42};
+};
+
+int main(int argc, char** argv) {
+    int port = 9001;
     // Fixed delay to keep fills predictable for the demo
     const long long FILL_DELAY_US = 500000; // 0.5s
 
-    int lfd = tcp_listen_loopback(port);
-    if (lfd < 0) return 1;
+    const long long MD_TICK_US = 250000; // Quote drift interval
+
+    TransportOptions topts;
+    int md_port = 9002; // 0 = no market data
+
+    // Execution quality knobs, so several instances look like different venues
+    int ack_delay_us = 0; // Added before every ACK
+    int fill_pct = 100;   // Share of orders that fill; the rest rest until cancelled
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg.rfind("--md-port=", 0) == 0) {
+            md_port = std::atoi(arg.c_str() + 10);
+            continue;
+        }
+        if (arg.rfind("--port=", 0) == 0) {
+            port = std::atoi(arg.c_str() + 7);
+            continue;
+        }
+        if (arg.rfind("--ack-delay-us=", 0) == 0) {
+            ack_delay_us = std::atoi(arg.c_str() + 15);
+            continue;
+        }
+        if (arg.rfind("--fill-pct=", 0) == 0) {
+            fill_pct = std::atoi(arg.c_str() + 11);
+            continue;
+        }
+        if (!parse_transport_arg(arg, topts, ok) || !ok) {
+            std::cerr << "usage: venue_sim [--transport=tcp|shm] [--shm-wait=futex|spin] [--shm-name=/name] [--net=poll|uring]"
+                         " [--port=N] [--md-port=N] [--ack-delay-us=N] [--fill-pct=0..100]\n";
+            return 1;
+        }
+    }
+    std::mt19937 fill_rng(7);
 
-    std::cout << "venue_sim: listening on 127.0.0.1:" << port << "\n";
+    MdPublisher md;
+    if (md_port > 0 && md.open(md_port)) {
+        std::cout << "venue_sim: market data on udp 127.0.0.1:" << md_port << "\n";
+    }
 
-    int cfd = tcp_accept(lfd);
-    if (cfd < 0) {
-        ::close(lfd);
-        return 1;
+    // The listener stays open so the OMS can reconnect
+    int lfd = -1;
+    if (topts.kind == TransportKind::Shm) {
+        std::cout << "venue_sim: waiting on shm " << topts.shm_name << "\n";
+    } else {
+        lfd = tcp_listen_loopback(port);
+        if (lfd < 0) return 1;
+        std::cout << "venue_sim: listening on 127.0.0.1:" << port << "\n";
     }
 
+    // Blocks until the OMS (re)connects
+    auto accept_client = [&]() -> std::unique_ptr<Connection> {
+        if (topts.kind == TransportKind::Shm) return shm_accept(topts.shm_name.c_str(), topts.shm_wait);
+        int cfd = tcp_accept(lfd);
+        if (cfd < 0) return nullptr;
+        return tcp_connection(cfd, topts.net);
+    };
+
+    // Sequenced session; it outlives connections so a reconnecting OMS
+    // gets only what it missed
+    Session::Options sopts;
+    sopts.name = "venue_sim";
+    Session conn(sopts);
+
+    std::unique_ptr<Connection> first = accept_client();
+    if (!first) return 1;
+    conn.attach(std::move(first));
+
     std::cout << "venue_sim: client connected\n";
 
     int next_venue_id = 90001;
 
     std::unordered_map<int, LiveOrder> orders; // client_id -> order
+    LiveIndex live;
     std::vector<ScheduledFill> schedule; // Due times for scheduled full fills
-
-    pollfd pfd;
-    pfd.fd = cfd;
-    pfd.events = POLLIN;
-    pfd.revents = 0;
+    long long next_md_us = mono_ns() / 1000 + MD_TICK_US;
 
     while (true) {
-        // Compute poll timeout based on next scheduled fill (wall clock)
+        // Compute poll timeout based on next scheduled fill / md tick
         int timeout_ms = -1;
-        if (!schedule.empty()) {
-            long long tnow = now_us();
-            long long next_due = schedule[0].due_us;
-            for (size_t i = 1; i < schedule.size(); i++) {
+        if (!schedule.empty() || md_port > 0) {
+            long long tnow = mono_ns() / 1000;
+            long long next_due = (md_port > 0) ? next_md_us : schedule[0].due_us;
+            for (size_t i = 0; i < schedule.size(); i++) {
                 if (schedule[i].due_us < next_due) next_due = schedule[i].due_us;
             }
 
@@ -81,100 +238,202 @@ int main() {
             if (delta_us < 0) delta_us = 0;
             timeout_ms = (int)(delta_us / 1000);
         }
+        int session_ms = conn.timer_ms(mono_ns());
+        if (timeout_ms < 0 || session_ms < timeout_ms) timeout_ms = session_ms;
+
+        // Connection readable: handle one inbound line
+        bool readable = conn.connection()->wait_readable(timeout_ms);
+        std::string line;
+        Session::ReadResult rr = readable ? conn.read(line) : Session::ReadResult::Control;
+        if (!conn.on_timer(mono_ns())) {
+            std::cout << "venue_sim: client heartbeat timeout\n";
+            rr = Session::ReadResult::Closed;
+        }
 
-        int rc = ::poll(&pfd, 1, timeout_ms);
-        if (rc < 0) {
-            if (errno == EINTR) continue;
-            std::cerr << "venue_sim: poll failed\n";
-            break;
+        if (rr == Session::ReadResult::Closed) {
+            // Keep orders and the resend buffer; fills resume after reconnect
+            std::cout << "venue_sim: client disconnected, waiting for reconnect\n";
+            conn.detach();
+            std::unique_ptr<Connection> next = accept_client();
+            if (!next) break;
+            conn.attach(std::move(next));
+            std::cout << "venue_sim: client connected\n";
+            continue;
         }
 
-        // Socket readable: handle one inbound line
-        if (rc > 0 && (pfd.revents & POLLIN)) {
-            std::string line;
-            if (!read_line(cfd, line)) {
-                std::cout << "venue_sim: client disconnected\n";
-                break;
-            }
+        if (rr == Session::ReadResult::Reset) {
+            // A new OMS process: the old one's orders are nobody's now
+            std::cout << "venue_sim: new session, dropping " << orders.size() << " order(s)\n";
+            orders.clear();
+            live.clear();
+            schedule.clear();
+        }
 
-            std::cout << "venue_sim: recv: " << line << "\n";
+        if (rr == Session::ReadResult::Data) {
 
-            std::istringstream iss(line);
-            std::string kind;
-            iss >> kind;
+            std::cout << "venue_sim: recv: " << line << "\n";
 
-            if (kind == "NEW") {
-                int client_id = 0;
-                std::string symbol, side;
-                int qty = 0;
-                double price = 0.0;
+            Msg in = parse_msg(line);
 
-                if (!(iss >> client_id >> symbol >> side >> qty >> price)) {
-                    send_reject(cfd, 0, "BAD_FORMAT");
-                    continue;
-                }
+            if (in.kind == MsgKind::Malformed) {
+                send_reject(conn, 0, "BAD_FORMAT");
+                continue;
+            }
 
+            if (in.kind == MsgKind::New) {
+                int client_id = in.client_id;
                 int venue_id = next_venue_id++;
 
                 LiveOrder o;
                 o.client_id = client_id;
                 o.venue_id = venue_id;
-                o.qty = qty;
-                o.price = price;
-                orders[client_id] = o;
-
-                // ACK immediately
-                {
-                    std::ostringstream ack;
-                    ack << "ACK " << client_id << " " << venue_id << "\n";
-                    write_all(cfd, ack.str());
-                    std::cout << "venue_sim: sent: " << ack.str();
-                }
+                o.symbol = std::string(in.symbol);
+                o.side = std::string(in.side);
+                o.qty = in.qty;
+                o.price = in.price;
+                o.rests = (int)(fill_rng() % 100) >= fill_pct;
+                live[o.symbol].insert(client_id);
+                md.on_new(o.symbol, o.price);
+                orders[client_id] = std::move(o);
+
+                // ACK immediately (or after the simulated venue latency)
+                if (ack_delay_us > 0) ::usleep((useconds_t)ack_delay_us);
+                send_msg(conn, order_msg(MsgKind::Ack, orders[client_id]));
 
                 // Schedule a single full fill after a short delay
-                ScheduledFill sf;
-                sf.due_us = now_us() + FILL_DELAY_US;
-                sf.client_id = client_id;
-                schedule.push_back(sf);
+                if (!orders[client_id].rests) {
+                    ScheduledFill sf;
+                    sf.due_us = mono_ns() / 1000 + FILL_DELAY_US;
+                    sf.client_id = client_id;
+                    schedule.push_back(sf);
+                }
             }
-            else if (kind == "CANCEL") {
-                int client_id = 0;
-                if (!(iss >> client_id)) {
-                    send_reject(cfd, 0, "BAD_FORMAT");
+            else if (in.kind == MsgKind::Cancel) {
+                int client_id = in.client_id;
+
+                auto it = orders.find(client_id);
+                if (it == orders.end()) {
+                    send_reject(conn, client_id, "UNKNOWN_ORDER");
+                    continue;
+                }
+
+                LiveOrder& o = it->second;
+
+                if (o.filled) {
+                    send_reject(conn, client_id, "ALREADY_FILLED");
+                    continue;
+                }
+                if (o.cancelled) {
+                    send_reject(conn, client_id, "ALREADY_CANCELLED");
+                    continue;
+                }
+
+                o.cancelled = true;
+                index_remove(live, o);
+
+                send_msg(conn, order_msg(MsgKind::Cancelled, o));
+            }
+            else if (in.kind == MsgKind::Replace) {
+                int client_id = in.client_id;
+                int qty = in.qty;
+                double price = in.price;
+                if (qty <= 0 || price <= 0.0) {
+                    send_reject(conn, client_id, "BAD_FORMAT");
                     continue;
                 }
 
                 auto it = orders.find(client_id);
                 if (it == orders.end()) {
-                    send_reject(cfd, client_id, "UNKNOWN_ORDER");
+                    send_reject(conn, client_id, "UNKNOWN_ORDER");
                     continue;
                 }
 
                 LiveOrder& o = it->second;
 
                 if (o.filled) {
-                    send_reject(cfd, client_id, "ALREADY_FILLED");
+                    send_reject(conn, client_id, "ALREADY_FILLED");
                     continue;
                 }
                 if (o.cancelled) {
-                    send_reject(cfd, client_id, "ALREADY_CANCELLED");
+                    send_reject(conn, client_id, "ALREADY_CANCELLED");
                     continue;
                 }
 
-                o.cancelled = true;
+                // Amend in place. Only a pure size decrease keeps queue
+                // priority; anything else goes to the back of the queue
+                bool keeps_priority = (price == o.price && qty <= o.qty);
+                o.qty = qty;
+                o.price = price;
 
-                std::ostringstream msg;
-                msg << "CANCELLED " << o.client_id << " " << o.venue_id << "\n";
-                write_all(cfd, msg.str());
-                std::cout << "venue_sim: sent: " << msg.str();
+                if (!keeps_priority && !o.rests) {
+                    o.generation++;
+                    ScheduledFill sf;
+                    sf.due_us = mono_ns() / 1000 + FILL_DELAY_US;
+                    sf.client_id = client_id;
+                    sf.generation = o.generation;
+                    schedule.push_back(sf);
+                }
+
+                send_msg(conn, order_msg(MsgKind::Replaced, o));
+            }
+            else if (in.kind == MsgKind::MassCancel) {
+                std::string_view symbol = in.symbol;
+                std::string_view side = in.side;
+
+                // Collect first: cancelling mutates the index we walk
+                std::vector<int> hits;
+                auto match = [&](const std::unordered_set<int>& ids) {
+                    for (int client_id : ids) {
+                        const LiveOrder& o = orders[client_id];
+                        if (side == "*" || o.side == side) hits.push_back(client_id);
+                    }
+                };
+                if (symbol == "*") {
+                    for (const auto& kv : live) match(kv.second);
+                } else {
+                    auto it = live.find(std::string(symbol));
+                    if (it != live.end()) match(it->second);
+                }
+
+                // All CANCELLED lines go out in one write
+                std::string batch(hits.size() * kMaxMsgLen, '\0');
+                size_t used = 0;
+                for (int client_id : hits) {
+                    LiveOrder& o = orders[client_id];
+                    o.cancelled = true;
+                    index_remove(live, o);
+                    used += encode_msg(order_msg(MsgKind::Cancelled, o), &batch[used], batch.size() - used);
+                }
+                if (used > 0) conn.send(std::string_view(batch.data(), used));
+                std::cout << "venue_sim: mass cancel symbol=" << symbol << " side=" << side
+                          << " cancelled=" << hits.size() << "\n";
+            }
+            else if (in.kind == MsgKind::OrderStatusAll) {
+                // Every live order, then the count, all in one write
+                size_t n = 0;
+                for (const auto& kv : live) n += kv.second.size();
+                std::string batch((n + 1) * kMaxMsgLen, '\0');
+                size_t used = 0;
+                for (const auto& kv : live) {
+                    for (int client_id : kv.second) {
+                        used += encode_msg(order_msg(MsgKind::OrderStatus, orders[client_id]),
+                                           &batch[used], batch.size() - used);
+                    }
+                }
+                Msg end;
+                end.kind = MsgKind::OrderStatusEnd;
+                end.count = (int)n;
+                used += encode_msg(end, &batch[used], batch.size() - used);
+                conn.send(std::string_view(batch.data(), used));
+                std::cout << "venue_sim: order status snapshot live=" << n << " bytes=" << used << "\n";
             }
             else {
-                send_reject(cfd, 0, "UNKNOWN_MSG");
+                send_reject(conn, 0, "UNKNOWN_MSG");
             }
         }
 
         // After poll process due fills (no partials)
-        long long tnow = now_us();
+        long long tnow = mono_ns() / 1000;
 
         std::vector<ScheduledFill> remaining;
         remaining.reserve(schedule.size());
@@ -192,24 +451,26 @@ int main() {
             }
 
             LiveOrder& o = it->second;
-            if (o.cancelled || o.filled) {
+            if (o.cancelled || o.filled || o.generation != s.generation) {
                 continue;
             }
 
-            std::ostringstream fill;
-            fill << "FILL " << o.client_id << " " << o.venue_id
-                 << " " << o.qty << " " << o.price << " A\n";
-            write_all(cfd, fill.str());
-            std::cout << "venue_sim: sent: " << fill.str();
+            Msg fill = order_msg(MsgKind::Fill, o);
+            fill.liquidity = 'A';
+            send_msg(conn, fill);
+            md.on_fill(o.symbol, o.qty, o.price);
 
             o.filled = true;
+            index_remove(live, o);
         }
 
         schedule.swap(remaining);
-        pfd.revents = 0;
+
+        if (md_port > 0 && tnow >= next_md_us) {
+            md.tick();
+            next_md_us = tnow + MD_TICK_US;
+        }
     }
 
-    ::close(cfd);
-    ::close(lfd);
     return 0;
 }